@@ -16,6 +16,35 @@
 #include <chrono>
 #include <sys/stat.h>
 #include <algorithm>
+#include <random>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+//worker threads for the history pipeline
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+//Unix socket for the chain service
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+//low level file access for the append engine
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+//waiting for appends in follow mode
+#include <poll.h>
+#include <sys/inotify.h>
+//in-memory item index for read-only commands
+#include <sys/mman.h>
+//SIMD intrinsics for the scan kernel
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 //library supporting hashes & encryption
 #include <openssl/md5.h>
 #include <openssl/sha.h>
@@ -70,16 +99,85 @@ union
 	Byte 140-143= Data Length
 	--variable length data field--
 */
-const int BLOCK_PREV_HASH_OFFSET = 0;
-const int BLOCK_TIMESTAMP_OFFSET = BLOCK_PREV_HASH_OFFSET + BLOCK_PREV_HASH_SIZE;
-const int BLOCK_CASE_ID_OFFSET = BLOCK_TIMESTAMP_OFFSET + BLOCK_TIMESTAMP_SIZE;
-const int BLOCK_ITEM_ID_OFFSET = BLOCK_CASE_ID_OFFSET + BLOCK_CASE_ID_SIZE;
-const int BLOCK_STATE_OFFSET = BLOCK_ITEM_ID_OFFSET + BLOCK_ITEM_ID_SIZE;
-const int BLOCK_CREATOR_OFFSET = BLOCK_STATE_OFFSET + BLOCK_STATE_SIZE;
-const int BLOCK_OWNER_OFFSET = BLOCK_CREATOR_OFFSET + BLOCK_CREATOR_SIZE;
-const int BLOCK_DATA_LEN_OFFSET = BLOCK_OWNER_OFFSET + BLOCK_OWNER_SIZE;
-const int BLOCK_DATA_OFFSET = BLOCK_DATA_LEN_OFFSET + BLOCK_DATA_LEN_SIZE;
+/**
+ * @dev One fixed size field of a block at a compile time offset. Fields are read
+ *		and written in place, so parsing a block never copies it.
+ */
+template <int OFFSET, int SIZE>
+struct BlockField
+{
+	static const int offset = OFFSET;
+	static const int size = SIZE;
+	static const int end = OFFSET + SIZE;
+	
+	static const unsigned char* at( const unsigned char* block )
+	{
+		return block + OFFSET;
+	}
+	static unsigned char* at( unsigned char* block )
+	{
+		return block + OFFSET;
+	}
+	//read or write the field as an integer of the same width
+	template <typename T>
+	static T load( const unsigned char* block )
+	{
+		static_assert( sizeof(T) == SIZE, "Value type does not match the field width" );
+		T value;
+		memcpy( &value, block + OFFSET, SIZE );
+		return value;
+	}
+	template <typename T>
+	static void store( unsigned char* block, T value )
+	{
+		static_assert( sizeof(T) == SIZE, "Value type does not match the field width" );
+		memcpy( block + OFFSET, &value, SIZE );
+	}
+	//copy the field from "src" (which must hold SIZE bytes)
+	static void fill( unsigned char* block, const unsigned char* src )
+	{
+		memcpy( block + OFFSET, src, SIZE );
+	}
+};
+
+//a field placed directly after another one
+template <typename PREV, int SIZE>
+struct NextField : BlockField<PREV::end, SIZE> {};
+
+/**
+ * @dev Version 1 of the block layout (see Data Layout above). A format variant
+ *		only needs its own list of fields to reuse the accessors and serializer.
+ */
+struct BlockLayoutV1
+{
+	typedef BlockField<0, BLOCK_PREV_HASH_SIZE> PrevHash;
+	typedef NextField<PrevHash, BLOCK_TIMESTAMP_SIZE> Timestamp;
+	typedef NextField<Timestamp, BLOCK_CASE_ID_SIZE> CaseId;
+	typedef NextField<CaseId, BLOCK_ITEM_ID_SIZE> ItemId;
+	typedef NextField<ItemId, BLOCK_STATE_SIZE> State;
+	typedef NextField<State, BLOCK_CREATOR_SIZE> Creator;
+	typedef NextField<Creator, BLOCK_OWNER_SIZE> Owner;
+	typedef NextField<Owner, BLOCK_DATA_LEN_SIZE> DataLen;
+	static const int headerSize = DataLen::end;
+};
+//the layout every command reads and writes
+typedef BlockLayoutV1 BlockLayout;
+
+const int BLOCK_PREV_HASH_OFFSET = BlockLayout::PrevHash::offset;
+const int BLOCK_TIMESTAMP_OFFSET = BlockLayout::Timestamp::offset;
+const int BLOCK_CASE_ID_OFFSET = BlockLayout::CaseId::offset;
+const int BLOCK_ITEM_ID_OFFSET = BlockLayout::ItemId::offset;
+const int BLOCK_STATE_OFFSET = BlockLayout::State::offset;
+const int BLOCK_CREATOR_OFFSET = BlockLayout::Creator::offset;
+const int BLOCK_OWNER_OFFSET = BlockLayout::Owner::offset;
+const int BLOCK_DATA_LEN_OFFSET = BlockLayout::DataLen::offset;
+const int BLOCK_DATA_OFFSET = BlockLayout::headerSize;
 const int BLOCK_MIN_SIZE = BLOCK_DATA_OFFSET;
+//the generated offsets must match the documented Data Layout
+static_assert( (0 == BLOCK_PREV_HASH_OFFSET) && (32 == BLOCK_TIMESTAMP_OFFSET) && (40 == BLOCK_CASE_ID_OFFSET) &&
+				(72 == BLOCK_ITEM_ID_OFFSET) && (104 == BLOCK_STATE_OFFSET) && (116 == BLOCK_CREATOR_OFFSET) &&
+				(128 == BLOCK_OWNER_OFFSET) && (140 == BLOCK_DATA_LEN_OFFSET) && (144 == BLOCK_MIN_SIZE),
+				"Block layout does not match the documented byte offsets" );
 
 //to simplify state checking, create an enumeration
 enum evidenceState { INITIAL, CHECKEDIN, CHECKEDOUT, DISPOSED, DESTROYED, RELEASED };
@@ -93,8 +191,11 @@ const string BCHOC_PASSWORD_CREATOR = "C67C";
 //data encryption key (per guidance)
 const string AES_KEY = "R0chLi4uLi4uLi4=";
 
-//declare a global filename to use (set during main)
-string COC_FILE;
+//declare a global filename to use (set during main, and per request by "serve")
+thread_local string COC_FILE;
+//set by commands that only read the chain: the caches kept next to it (item
+//index, state checkpoints) are then read but never created or written
+thread_local bool COC_READ_ONLY = false;
 
 /*
  * =============
@@ -117,55 +218,441 @@ bool fileExists()
 		exists = true;
 		fclose(fPtr);
 	}
+	//a segmented chain exists once its manifest does
+	if( !exists )
+	{
+		string manifestFile = COC_FILE + ".manifest";
+		fPtr = fopen( manifestFile.c_str(), "r" );
+		if( fPtr )
+		{
+			exists = true;
+			fclose(fPtr);
+		}
+	}
 	return exists;
 }
  
 /**
- * @dev method that writes the argument string to the end of the file
+ * @dev Single method to get time
  */
-void writeToFile(string writeText)
+uint64_t unixTimestamp()
 {
-	//append the passed text to the end of the file
-	ofstream outFile;
-	outFile.open( COC_FILE, std::ios::app );
-	outFile << writeText;
-	outFile.close();
+	auto curTime = chrono::system_clock::now().time_since_epoch();
+	auto curTimeMs = chrono::duration_cast<chrono::microseconds>(curTime);
+	uint64_t micro = curTimeMs.count();
+	return micro;
 }
 
 /**
- * @dev Compute and return a SHA-256 hash
+ * @dev Read exactly "len" bytes at "offset" from a file descriptor
+ *		(returns false if the file ends or errors before all bytes are read)
  */
-string computeHash( string &contents )
+bool preadFull( int fd, void* buf, size_t len, uint64_t offset )
 {
-	string hashResult = "";
-	//use OpenSSL to compute the SHA256 hash
-	unsigned char hash[SHA256_DIGEST_LENGTH];
-	SHA256_CTX sha256;
-	SHA256_Init(&sha256);
-	SHA256_Update(&sha256, contents.c_str(), contents.size());
-	SHA256_Final(hash, &sha256);
-	stringstream ss;
-	for(int i = 0; i < SHA256_DIGEST_LENGTH; i++)
+	unsigned char* dst = (unsigned char*)buf;
+	while( len > 0 )
+	{
+		ssize_t got = pread( fd, dst, len, offset );
+		if( got < 0 && EINTR == errno )
+		{
+			continue;
+		}
+		if( got <= 0 )
+		{
+			return false;
+		}
+		dst += got;
+		len -= got;
+		offset += got;
+	}
+	return true;
+}
+
+/**
+ * @dev Write exactly "len" bytes to a file descriptor
+ *		(returns false if any of them could not be written)
+ */
+bool writeFull( int fd, const void* buf, size_t len )
+{
+	const unsigned char* src = (const unsigned char*)buf;
+	while( len > 0 )
+	{
+		ssize_t put = write( fd, src, len );
+		if( put < 0 && EINTR == errno )
+		{
+			continue;
+		}
+		if( put <= 0 )
+		{
+			return false;
+		}
+		src += put;
+		len -= put;
+	}
+	return true;
+}
+
+/**
+ * @dev fsync the folder holding the blockchain so a newly created file
+ *		(or a rename within the folder) survives a power loss
+ * @return false when the folder could not be opened or synced
+ */
+bool syncParentFolder( string path )
+{
+	string folderPath = ".";
+	size_t idxOfNameStart = path.find_last_of('/');
+	if( string::npos != idxOfNameStart )
+	{
+		folderPath = path.substr( 0, idxOfNameStart + 1 );
+	}
+	int dirFd = open( folderPath.c_str(), O_RDONLY );
+	if( dirFd < 0 )
+	{
+		return false;
+	}
+	bool synced = ( 0 == fsync( dirFd ) );
+	close( dirFd );
+	return synced;
+}
+
+/*
+ * =============
+ * Append engine
+ * =============
+ * The blockchain file is held open for the life of the command and every
+ * block is handed to the kernel as one contiguous buffer in a single write().
+ * When the data reaches the disk is controlled by the durability policy read
+ * from the environment in main():
+ *	BCHOC_SYNC=none		never fsync (previous behavior)
+ *	BCHOC_SYNC=op		fsync after every appended block (default)
+ *	BCHOC_SYNC=group	fsync once BCHOC_SYNC_GROUP_BLOCKS blocks are queued or
+ *						BCHOC_SYNC_GROUP_MS milliseconds have passed since the
+ *						last fsync, whichever comes first. Anything still queued
+ *						is synced when the chain is closed.
+ */
+enum syncPolicy { SYNC_NONE, SYNC_PER_OP, SYNC_GROUP };
+
+struct ChainAppender
+{
+	int fd;					//open descriptor on the chain (-1 when closed)
+	int policy;				//one of syncPolicy
+	int groupBlocks;		//group commit: max blocks queued before a sync
+	uint64_t groupMicros;	//group commit: max time queued before a sync
+	int pendingBlocks;		//blocks written but not yet synced
+	uint64_t lastSync;		//time of last sync (microseconds since Epoch)
+};
+ChainAppender COC_APPENDER = { -1, SYNC_PER_OP, 32, 10000, 0, 0 };
+
+/**
+ * @dev Read the durability policy from the environment
+ */
+void loadSyncPolicy()
+{
+	const char* policy = getenv("BCHOC_SYNC");
+	if( NULL != policy )
+	{
+		if( 0 == strcmp(policy, "none") )
+		{
+			COC_APPENDER.policy = SYNC_NONE;
+		}
+		else if( 0 == strcmp(policy, "group") )
+		{
+			COC_APPENDER.policy = SYNC_GROUP;
+		}
+		else
+		{
+			COC_APPENDER.policy = SYNC_PER_OP;
+		}
+	}
+	const char* groupMs = getenv("BCHOC_SYNC_GROUP_MS");
+	if( (NULL != groupMs) && (atoi(groupMs) >= 0) )
+	{
+		COC_APPENDER.groupMicros = (uint64_t)atoi(groupMs) * 1000;
+	}
+	const char* groupBlocks = getenv("BCHOC_SYNC_GROUP_BLOCKS");
+	if( (NULL != groupBlocks) && (atoi(groupBlocks) > 0) )
+	{
+		COC_APPENDER.groupBlocks = atoi(groupBlocks);
+	}
+}
+
+void hashBlock( const unsigned char* block, size_t blockLen, unsigned char* digest );
+int decodeState( const unsigned char* readState );
+
+/**
+ * @dev Detect a torn (partially written) block at the end of the chain and cut
+ *		it off so the next append lands on a block boundary. The torn bytes are
+ *		preserved in "<chain>.torn" before truncating. A crash can only tear the
+ *		last block, so the tail is cut only when it is shorter than a block
+ *		header, or when every block up to it links to its parent and no block
+ *		linked to it follows in the tail. Anything else is damage for verify
+ *		to report, and nothing is appended after it.
+ * @param fd is a descriptor open for writing on the chain
+ * @return false if the chain must not be appended to
+ */
+bool recoverTornTail( int fd )
+{
+	struct stat info;
+	if( 0 != fstat(fd, &info) )
+	{
+		return false;
+	}
+	uint64_t fileSize = info.st_size;
+	//step block to block using only the Data Length fields
+	uint64_t blockHead = 0;
+	while( (blockHead + BLOCK_MIN_SIZE) <= fileSize )
+	{
+		unsigned int dataLen = 0;
+		preadFull( fd, &dataLen, BLOCK_DATA_LEN_SIZE, blockHead + BLOCK_DATA_LEN_OFFSET );
+		uint64_t nextHead = blockHead + BLOCK_MIN_SIZE + dataLen;
+		if( nextHead > fileSize )
+		{
+			//data field runs past the end of file
+			break;
+		}
+		blockHead = nextHead;
+	}
+	if( blockHead == fileSize )
+	{
+		return true;
+	}
+	uint64_t tornLen = fileSize - blockHead;
+	
+	//a tail holding a whole header has to be the chain's last block:
+	//re-walk the blocks checking that each one links to its parent (the first
+	//block of an active segment links to the sealed segment, which verify checks)
+	vector<unsigned char> wholeBlock( BLOCK_MIN_SIZE );
+	unsigned char parentHash[BLOCK_PREV_HASH_SIZE];
+	bool intact = true;
+	for( uint64_t head = 0; intact && (tornLen >= BLOCK_MIN_SIZE) && (head <= blockHead); )
+	{
+		intact = preadFull( fd, &wholeBlock[0], BLOCK_MIN_SIZE, head ) &&
+				((0 == head) || (0 == memcmp( &wholeBlock[BLOCK_PREV_HASH_OFFSET], parentHash, BLOCK_PREV_HASH_SIZE )));
+		if( head == blockHead )
+		{
+			break;
+		}
+		unsigned int dataLen = 0;
+		memcpy( &dataLen, &wholeBlock[BLOCK_DATA_LEN_OFFSET], BLOCK_DATA_LEN_SIZE );
+		wholeBlock.resize( BLOCK_MIN_SIZE + dataLen );
+		intact = intact && ((0 == dataLen) || preadFull( fd, &wholeBlock[BLOCK_MIN_SIZE], dataLen, head + BLOCK_MIN_SIZE ));
+		hashBlock( &wholeBlock[0], BLOCK_MIN_SIZE + dataLen, parentHash );
+		head += BLOCK_MIN_SIZE + dataLen;
+	}
+	vector<unsigned char> tornBytes( tornLen );
+	intact = intact && preadFull( fd, &tornBytes[0], tornLen, blockHead );
+	//a damaged Data Length makes a whole block look torn; the block that really
+	//follows it would hold its hash (with the true length) as its Previous Hash
+	for( uint64_t next = BLOCK_MIN_SIZE; intact && (next + BLOCK_MIN_SIZE <= tornLen); next++ )
+	{
+		if( -1 == decodeState( &tornBytes[next + BLOCK_STATE_OFFSET] ) )
+		{
+			continue;
+		}
+		vector<unsigned char> candidate( tornBytes.begin(), tornBytes.begin() + next );
+		unsigned int dataLen = next - BLOCK_MIN_SIZE;
+		memcpy( &candidate[BLOCK_DATA_LEN_OFFSET], &dataLen, BLOCK_DATA_LEN_SIZE );
+		unsigned char candidateHash[BLOCK_PREV_HASH_SIZE];
+		hashBlock( &candidate[0], candidate.size(), candidateHash );
+		intact = (0 != memcmp( &tornBytes[next + BLOCK_PREV_HASH_OFFSET], candidateHash, BLOCK_PREV_HASH_SIZE ));
+	}
+	if( !intact )
+	{
+		printf("Blockchain is damaged at offset %llu, not appending (run verify)\n", (unsigned long long)blockHead);
+		return false;
+	}
+	
+	//keep a copy of the torn bytes for later inspection, and only cut the
+	//chain once the copy is safely stored
+	string tornFile = COC_FILE + ".torn";
+	int tornFd = open( tornFile.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644 );
+	bool saved = (tornFd >= 0) && writeFull( tornFd, &tornBytes[0], tornLen ) && (0 == fsync( tornFd ));
+	if( tornFd >= 0 )
+	{
+		close( tornFd );
+	}
+	if( !saved )
+	{
+		printf("Unable to save incomplete block to %s, not truncating\n", tornFile.c_str());
+		return false;
+	}
+	if( (0 != ftruncate( fd, blockHead )) || (0 != fsync( fd )) )
+	{
+		printf("Unable to truncate incomplete block at end of file\n");
+		return false;
+	}
+	printf("Truncated incomplete block at end of file (%llu bytes)\n", (unsigned long long)tornLen);
+	return true;
+}
+
+/**
+ * @dev Open the blockchain for appending (creating it if needed). Any torn
+ *		block left by a crash is cut off before the first new block is written.
+ */
+bool openChainForAppend()
+{
+	if( COC_APPENDER.fd >= 0 )
+	{
+		return true;
+	}
+	struct stat existence;
+	bool created = ( 0 != stat( COC_FILE.c_str(), &existence ) );
+	COC_APPENDER.fd = open( COC_FILE.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644 );
+	if( COC_APPENDER.fd < 0 )
+	{
+		printf("Unable to open blockchain file for writing\n");
+		return false;
+	}
+	if( created )
+	{
+		//make sure the new directory entry itself is durable
+		if( !syncParentFolder( COC_FILE ) )
+		{
+			printf("Failed to sync blockchain folder to disk\n");
+			close( COC_APPENDER.fd );
+			COC_APPENDER.fd = -1;
+			return false;
+		}
+	}
+	else if( !recoverTornTail( COC_APPENDER.fd ) )
+	{
+		close( COC_APPENDER.fd );
+		COC_APPENDER.fd = -1;
+		return false;
+	}
+	COC_APPENDER.pendingBlocks = 0;
+	COC_APPENDER.lastSync = unixTimestamp();
+	return true;
+}
+
+/**
+ * @dev Flush queued blocks to disk
+ * @param force syncs regardless of the group commit thresholds
+ * @return false if the blocks could not be made durable
+ */
+bool syncChain( bool force )
+{
+	if( (COC_APPENDER.fd < 0) || (0 == COC_APPENDER.pendingBlocks) )
+	{
+		return true;
+	}
+	bool due = force;
+	if( SYNC_PER_OP == COC_APPENDER.policy )
+	{
+		due = true;
+	}
+	else if( SYNC_GROUP == COC_APPENDER.policy )
+	{
+		if( (COC_APPENDER.pendingBlocks >= COC_APPENDER.groupBlocks) ||
+			((unixTimestamp() - COC_APPENDER.lastSync) >= COC_APPENDER.groupMicros) )
+		{
+			due = true;
+		}
+	}
+	else
+	{
+		//SYNC_NONE leaves it to the kernel
+		due = false;
+	}
+	if( due )
+	{
+		if( 0 != fdatasync( COC_APPENDER.fd ) )
+		{
+			printf("Failed to sync blockchain to disk\n");
+			return false;
+		}
+		COC_APPENDER.pendingBlocks = 0;
+		COC_APPENDER.lastSync = unixTimestamp();
+	}
+	return true;
+}
+
+/**
+ * @dev Sync anything still queued and release the chain descriptor
+ * @return false if queued blocks could not be made durable
+ */
+bool closeChain()
+{
+	bool synced = true;
+	if( COC_APPENDER.fd >= 0 )
+	{
+		synced = syncChain( true );
+		close( COC_APPENDER.fd );
+		COC_APPENDER.fd = -1;
+	}
+	return synced;
+}
+
+bool sealSegmentIfFull();
+bool merkleSync();
+bool itemIndexSync();
+
+/**
+ * @dev Append one complete block to the end of the blockchain with a single write
+ * @param block points to the serialized block
+ * @param blockLen is the total size of the block in bytes
+ * @return 0 on success, 1 on failure
+ */
+int appendBlock( const unsigned char* block, size_t blockLen )
+{
+	if( !openChainForAppend() )
+	{
+		return 1;
+	}
+	size_t written = 0;
+	while( written < blockLen )
 	{
-		ss << hex << setw(2) << setfill('0') << (int)hash[i];
+		ssize_t put = write( COC_APPENDER.fd, block + written, blockLen - written );
+		if( put < 0 && EINTR == errno )
+		{
+			continue;
+		}
+		if( put <= 0 )
+		{
+			printf("Failed to append block to blockchain\n");
+			return 1;
+		}
+		written += put;
 	}
-	//the above generates the SHA256 hash as a 64byte string
-	//we need to translate the characters into their hex bytes
-	//to create a 32 byte Hash
-	unsigned char hexValues[BLOCK_PREV_HASH_SIZE];
-	string holdingString = ss.str();
-	for(int i = 0; i < BLOCK_PREV_HASH_SIZE; i++)
+	COC_APPENDER.pendingBlocks++;
+	if( !syncChain( false ) )
 	{
-		int idx = i*2;
-		//this will take 2 characters and translate them into
-		//their byte-length hex equivalent and store the value
-		hexValues[i] = stoi( holdingString.substr(idx, 2), NULL, 16 );
+		return 1;
 	}
-	hashResult.append((const char*)&hexValues[0], BLOCK_PREV_HASH_SIZE);
+	//keep the Merkle accumulator in step with the chain
+	merkleSync();
+	//and the item index
+	itemIndexSync();
+	//roll over to a new segment once the active one is full
+	if( !sealSegmentIfFull() )
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @dev Compute and return a SHA-256 hash
+ */
+string computeHash( string &contents )
+{
+	//use OpenSSL to compute the SHA256 hash directly into its 32 raw bytes
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	SHA256( (const unsigned char*)contents.data(), contents.size(), hash );
+	string hashResult = "";
+	hashResult.append((const char*)&hash[0], BLOCK_PREV_HASH_SIZE);
 	
 	return hashResult;
 }
 
+/**
+ * @dev Compute the SHA-256 hash of a serialized block into "digest"
+ */
+void hashBlock( const unsigned char* block, size_t blockLen, unsigned char* digest )
+{
+	SHA256( block, blockLen, digest );
+}
+
 /**
  * @dev Convert UUID string to 16-byte array
  */
@@ -205,1788 +692,7264 @@ string bytesToByteString(const unsigned char* data, size_t length)
     return ss.str();
 }
 
-/**
- * @dev AES-ECB encryption using OpenSSL EVP interface
+/*
+ * =============
+ * Scan kernel
+ * =============
+ * Nearly every command filters the full chain by comparing 32 byte Case/Item
+ * IDs and decoding the 12 byte State field. idMatch32 compares two IDs with a
+ * single AVX2 compare (or two SSE2 compares), chosen at startup from the CPU's
+ * features, with a portable fallback. decodeState turns a State field into the
+ * evidenceState enumeration with two integer compares per candidate state.
+ * BCHOC_SCAN_KERNEL=scalar|sse2|avx2 forces a particular implementation.
  */
-string aesEncryptECB(const unsigned char* input, const std::string& key)
+bool idMatch32Scalar( const unsigned char* first, const unsigned char* second )
 {
-    unsigned char encrypted[16] = {0};
-    int outlen = 0;
-
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr);
-    EVP_CIPHER_CTX_set_padding(ctx, 0); // Disable padding
-
-    EVP_EncryptUpdate(ctx, encrypted, &outlen, input, 16);
+	uint64_t a[4];
+	uint64_t b[4];
+	memcpy( a, first, sizeof(a) );
+	memcpy( b, second, sizeof(b) );
+	return 0 == ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]));
+}
 
-    EVP_CIPHER_CTX_free(ctx);
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+bool idMatch32SSE2( const unsigned char* first, const unsigned char* second )
+{
+	__m128i low = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)first ), _mm_loadu_si128( (const __m128i*)second ) );
+	__m128i high = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)(first + 16) ), _mm_loadu_si128( (const __m128i*)(second + 16) ) );
+	return 0xFFFF == _mm_movemask_epi8( _mm_and_si128( low, high ) );
+}
 
-    return bytesToByteString(encrypted, 16);
+__attribute__((target("avx2")))
+bool idMatch32AVX2( const unsigned char* first, const unsigned char* second )
+{
+	__m256i equal = _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)first ), _mm256_loadu_si256( (const __m256i*)second ) );
+	return -1 == _mm256_movemask_epi8( equal );
 }
+#endif
+
+//the implementation picked by selectScanKernel()
+bool (*idMatch32)( const unsigned char*, const unsigned char* ) = idMatch32Scalar;
 
 /**
- * @dev Encrypt an input byte array using the constant AES_KEY
- * @param Bytes to encrypt
- * @param Length of the value
+ * @dev Pick the fastest ID compare the CPU supports
  */
-void encryptBytes( unsigned char* itemToEncrypt, int itemLength, bool isCaseId )
+void selectScanKernel()
 {
-	//translate the input into it's byte equivalent
-    unsigned char encryptedBytes[16] = {0};
-	if( isCaseId )
+	const char* forced = getenv("BCHOC_SCAN_KERNEL");
+	idMatch32 = idMatch32Scalar;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if( (NULL != forced) && (0 == strcmp(forced, "scalar")) )
 	{
-		//translate the input into string
-		string toEncrypt = "";
-		toEncrypt.append((const char*)itemToEncrypt, itemLength);
-		//format the string into bytes
-		uuidToBytes(toEncrypt, encryptedBytes);
+		return;
 	}
-	else
+	if( __builtin_cpu_supports("avx2") && ((NULL == forced) || (0 == strcmp(forced, "avx2"))) )
 	{
-		//translate the string into an int32_t
-		uint32_t itemId = atoi( (const char*)itemToEncrypt );
-		//format the int32_t into bytes
-		prepareItemBytes(itemId, encryptedBytes);
+		idMatch32 = idMatch32AVX2;
 	}
-
-    string encryptedResult = aesEncryptECB(encryptedBytes, AES_KEY);
-    //cout << "Encrypted Case ID: " << encryptedResult << std::endl;
-	
-	//clear the input char array and copy the encrypted string into it
-	memset( &itemToEncrypt[0], 0, itemLength);
-	memcpy( &itemToEncrypt[0], encryptedResult.c_str(), itemLength );
-	
+	else if( __builtin_cpu_supports("sse2") )
+	{
+		idMatch32 = idMatch32SSE2;
+	}
+#endif
 }
 
 /**
- * @dev AES-ECB encryption using OpenSSL EVP interface
+ * @dev The State field of each evidenceState split into an 8 and a 4 byte word
  */
-std::string aesDecryptECB(const unsigned char* input, const std::string& key)
+struct StateWords
 {
-    unsigned char encrypted[16] = {0};
-    int outlen = 0;
+	uint64_t head;
+	uint32_t tail;
+};
 
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    EVP_DecryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr);
-    EVP_CIPHER_CTX_set_padding(ctx, 0); // Disable padding
-
-    EVP_DecryptUpdate(ctx, encrypted, &outlen, input, 16);
+StateWords makeStateWords( const char* name )
+{
+	unsigned char field[BLOCK_STATE_SIZE];
+	memset( field, 0, BLOCK_STATE_SIZE );
+	memcpy( field, name, strlen(name) );
+	StateWords words;
+	memcpy( &words.head, &field[0], sizeof(uint64_t) );
+	memcpy( &words.tail, &field[sizeof(uint64_t)], sizeof(uint32_t) );
+	return words;
+}
 
-    EVP_CIPHER_CTX_free(ctx);
+//indexed by evidenceState
+const StateWords STATE_WORDS[] = { makeStateWords("INITIAL"), makeStateWords("CHECKEDIN"),
+									makeStateWords("CHECKEDOUT"), makeStateWords("DISPOSED"),
+									makeStateWords("DESTROYED"), makeStateWords("RELEASED") };
+static_assert( BLOCK_STATE_SIZE == sizeof(uint64_t) + sizeof(uint32_t), "State field must split into two words" );
 
-    return bytesToByteString(encrypted, 16);
+/**
+ * @dev Decode the State field of a block into the evidenceState enumeration
+ * @return the state, or -1 if the field is not one of the known states
+ */
+int decodeState( const unsigned char* readState )
+{
+	uint64_t head;
+	uint32_t tail;
+	memcpy( &head, readState, sizeof(uint64_t) );
+	memcpy( &tail, readState + sizeof(uint64_t), sizeof(uint32_t) );
+	for( int code = INITIAL; code <= RELEASED; code++ )
+	{
+		if( (head == STATE_WORDS[code].head) && (tail == STATE_WORDS[code].tail) )
+		{
+			return code;
+		}
+	}
+	return -1;
 }
 
 /**
- * @dev Decrypt an input byte array using the constant AES_KEY
- * @param Bytes to decrypt
- * @param Length of the value
+ * @dev A parsed block. Every field is read in place from the caller's buffer, and
+ *		the State field is decoded into the evidenceState enumeration once.
  */
-void decryptBytes( unsigned char* itemToDecrypt, int itemLength, bool isItemId )
+template <typename LAYOUT>
+struct BasicBlockView
 {
-	string toDecrypt = "";
-	toDecrypt.append((const char*)itemToDecrypt, itemLength);
-	//cout << "To Decrypt: " << toDecrypt << endl;
+	const unsigned char* raw;
+	uint64_t time;
+	uint32_t dataLen;
+	int state;				//evidenceState, or -1 if unknown
 	
-	unsigned char decryptedBytes[16] = {0};
-	uuidToBytes(toDecrypt, decryptedBytes);
-	string decryptedString = aesDecryptECB( decryptedBytes, AES_KEY );
-	
-	//cout << "Decrypted: " << decryptedString <<endl;
-	
-	//Item Ids have an extra step to complete the decryption
-	if( isItemId )
+	explicit BasicBlockView( const unsigned char* block ) :
+		raw( block ),
+		time( LAYOUT::Timestamp::template load<uint64_t>( block ) ),
+		dataLen( LAYOUT::DataLen::template load<uint32_t>( block ) ),
+		state( decodeState( LAYOUT::State::at( block ) ) )
 	{
-		uint32_t itemVal;
-		stringstream ss;
-		ss << hex << decryptedString;
-		ss >> itemVal;
-		decryptedString = to_string(itemVal);
 	}
-	
-	//clear the input char array and copy the decrypted string into it
-	memset( &itemToDecrypt[0], 0, itemLength);
-	memcpy( &itemToDecrypt[0], decryptedString.c_str(), itemLength );
+	const unsigned char* prevHash() const { return LAYOUT::PrevHash::at( raw ); }
+	const unsigned char* caseId() const { return LAYOUT::CaseId::at( raw ); }
+	const unsigned char* itemId() const { return LAYOUT::ItemId::at( raw ); }
+	const unsigned char* stateField() const { return LAYOUT::State::at( raw ); }
+	const unsigned char* creator() const { return LAYOUT::Creator::at( raw ); }
+	const unsigned char* owner() const { return LAYOUT::Owner::at( raw ); }
+	const unsigned char* data() const { return raw + LAYOUT::headerSize; }
+	size_t size() const { return LAYOUT::headerSize + dataLen; }
+};
+typedef BasicBlockView<BlockLayout> BlockView;
+
+/**
+ * @dev Serialize a block into a preallocated buffer in a single pass
+ * @param out must hold LAYOUT::headerSize + dataLen bytes
+ * @return the number of bytes written
+ */
+template <typename LAYOUT>
+size_t serializeBlock( unsigned char* out, const unsigned char* prevHash, uint64_t time,
+						const unsigned char* caseId, const unsigned char* itemId, const unsigned char* state,
+						const unsigned char* creator, const unsigned char* owner,
+						const unsigned char* data, uint32_t dataLen )
+{
+	LAYOUT::PrevHash::fill( out, prevHash );
+	LAYOUT::Timestamp::store( out, time );
+	LAYOUT::CaseId::fill( out, caseId );
+	LAYOUT::ItemId::fill( out, itemId );
+	LAYOUT::State::fill( out, state );
+	LAYOUT::Creator::fill( out, creator );
+	LAYOUT::Owner::fill( out, owner );
+	LAYOUT::DataLen::store( out, dataLen );
+	if( dataLen > 0 )
+	{
+		memcpy( out + LAYOUT::headerSize, data, dataLen );
+	}
+	return LAYOUT::headerSize + dataLen;
 }
 
+/*
+ * =============
+ * Segmented storage
+ * =============
+ * When BCHOC_SEGMENT_SIZE is set (bytes, K/M/G suffixes allowed) the chain is
+ * kept as a series of files instead of one ever growing file:
+ *	<chain>.seg.000000, <chain>.seg.000001, ...	sealed, read-only segments
+ *	<chain>										the active segment new blocks go to
+ *	<chain>.manifest							one line per sealed segment
+ * Once the active segment reaches the segment size it is sealed on the block
+ * boundary. Offsets everywhere else in this file are "logical" offsets into the
+ * concatenation of all segments, so a segmented chain reads exactly like the
+ * single file it replaces.
+ */
+uint64_t COC_SEGMENT_SIZE = 0;
+
+struct ChainSegment
+{
+	string path;			//file holding this segment
+	uint64_t base;			//logical offset of the first block
+	uint64_t length;		//bytes in this segment
+	bool sealed;			//false only for the active segment
+	//summary recorded when a segment is sealed
+	uint64_t lastBlock;		//logical offset of the last block
+	string firstPrevHash;	//Previous Hash field of the first block (hex)
+	string lastHash;		//hash of the last block (hex)
+	uint64_t blockCount;
+	uint64_t minTime;
+	uint64_t maxTime;
+	uint64_t itemCount;
+	vector<string> caseIds;	//every (encrypted) Case ID in the segment
+};
+
 /**
- * @dev Single method to get time
+ * @dev Parse a byte count with an optional K/M/G suffix
  */
-uint64_t unixTimestamp()
+uint64_t parseByteSize( const char* sizeText )
 {
-	auto curTime = chrono::system_clock::now().time_since_epoch();
-	auto curTimeMs = chrono::duration_cast<chrono::microseconds>(curTime);
-	uint64_t micro = curTimeMs.count();
-	return micro;
+	char* suffix = NULL;
+	uint64_t size = strtoull( sizeText, &suffix, 10 );
+	if( (NULL != suffix) && ('K' == *suffix || 'k' == *suffix) )
+	{
+		size <<= 10;
+	}
+	else if( (NULL != suffix) && ('M' == *suffix || 'm' == *suffix) )
+	{
+		size <<= 20;
+	}
+	else if( (NULL != suffix) && ('G' == *suffix || 'g' == *suffix) )
+	{
+		size <<= 30;
+	}
+	return size;
 }
 
 /**
- * @dev Translate an Epoch into formatted time string
- * @param Count of microseconds since Epoch to format
+ * @dev Read the segment size from the environment (0 disables segmenting)
  */
-string translateTimestamp( uint64_t inTime )
+void loadSegmentSize()
 {
-	stringstream ss;
-	string result;
-	//extract the microseconds from the input Time
-	int microseconds = inTime % 1000000;
-	time_t remainder = inTime / 1000000;
-	//format the remaining YYYY-MM-DD (%F) & HH:M:SS (%T) time
-	struct tm* time = localtime(&remainder);
-	char buffer[80];
-	strftime( buffer, 80, "%FT%T.", time );
-	//transalte to a string and trim off excess characters
-	string tmpStr;
-	tmpStr.append((const char*)&buffer[0], 80);
-	tmpStr = tmpStr.substr(0, tmpStr.find("."));
-	//concat the entire time measurement into a single string
-	ss << tmpStr << "." << to_string(microseconds) << "Z";
-	result = ss.str();
-	//return the result
-	return result;
+	const char* sizeText = getenv("BCHOC_SEGMENT_SIZE");
+	if( NULL != sizeText )
+	{
+		COC_SEGMENT_SIZE = parseByteSize( sizeText );
+	}
 }
 
 /**
- * @dev Method to check if the blockchain is initialized
+ * @dev Name of the file holding sealed segment "index"
  */
-bool cocIsInit()
+string segmentPath( int index )
 {
-	bool validInit = true;
-	//confirm the file exists before attempting to read it
-	validInit = fileExists();
-	if( validInit )
+	char suffix[16];
+	snprintf( suffix, sizeof(suffix), ".seg.%06d", index );
+	return COC_FILE + suffix;
+}
+
+/**
+ * @dev Size of a file in bytes (0 if it does not exist)
+ */
+uint64_t fileSize( string path )
+{
+	struct stat info;
+	if( 0 != stat( path.c_str(), &info ) )
 	{
-		//get the current contents of the blockchain
-		FILE *fPtr;
-		fPtr = fopen( COC_FILE.c_str(), "rb" );
-		//get the state of the first block (SEEK_SET = start of file)
-		fseek( fPtr, BLOCK_STATE_OFFSET, SEEK_SET );
-		//copy the content into a local array
-		unsigned char readState[BLOCK_STATE_SIZE];
-		fread( readState, sizeof(char), BLOCK_STATE_SIZE, fPtr );
-		//Compare to expected Init value
-		unsigned char expectedState[] = {'I','N','I','T','I','A','L','\0','\0','\0','\0','\0'};
-		for( int pos = 0; pos < BLOCK_STATE_SIZE; pos++ )
+		return 0;
+	}
+	return info.st_size;
+}
+
+/**
+ * @dev Load the sealed segments from the manifest followed by the active segment.
+ *		A seal interrupted between writing the manifest and renaming the
+ *		active file is finished here.
+ * @param segs receives the segments in chain order
+ */
+void loadSegments( vector<ChainSegment> &segs )
+{
+	segs.clear();
+	string manifestFile = COC_FILE + ".manifest";
+	ifstream manifest( manifestFile.c_str() );
+	string line;
+	uint64_t nextBase = 0;
+	while( getline( manifest, line ) )
+	{
+		if( (0 == line.size()) || ('#' == line[0]) )
 		{
-			//if any byte does not match, it is an invalid init block
-			if( readState[pos] != expectedState[pos] )
-			{
-				validInit = false;
-			}
+			continue;
 		}
-		//alert user of invalid INITIAL blocks
-		if( false == validInit )
+		stringstream ss( line );
+		ChainSegment seg;
+		int index = 0;
+		int caseCount = 0;
+		ss >> index >> seg.base >> seg.length >> seg.lastBlock >> seg.firstPrevHash >> seg.lastHash
+			>> seg.blockCount >> seg.minTime >> seg.maxTime >> seg.itemCount >> caseCount;
+		for( int i = 0; i < caseCount; i++ )
 		{
-			printf("Blockchain file found without an INITIAL block\n");
+			string caseId;
+			ss >> caseId;
+			seg.caseIds.push_back( caseId );
 		}
-		
-		fclose(fPtr);
+		seg.path = segmentPath( index );
+		seg.sealed = true;
+		//finish a seal that crashed before the active file was renamed
+		struct stat existence;
+		if( (0 != stat( seg.path.c_str(), &existence )) && (fileSize( COC_FILE ) == seg.length) )
+		{
+			if( 0 == rename( COC_FILE.c_str(), seg.path.c_str() ) )
+			{
+				chmod( seg.path.c_str(), 0444 );
+				syncParentFolder( COC_FILE );
+			}
+		}
+		nextBase = seg.base + seg.length;
+		segs.push_back( seg );
 	}
-	
-	//return the result
-	return validInit;
+	//the active segment always follows the sealed ones
+	ChainSegment active;
+	active.path = COC_FILE;
+	active.base = nextBase;
+	active.length = fileSize( COC_FILE );
+	active.sealed = false;
+	active.lastBlock = 0;
+	active.blockCount = 0;
+	active.minTime = 0;
+	active.maxTime = 0;
+	active.itemCount = 0;
+	segs.push_back( active );
 }
 
 /**
- * @dev Support method to clear any unexpected data from the block info
+ * @dev Buffered reader over the logical chain (all segments back to back).
+ *		Used the same way the FILE* readers it replaced were: seek, read, tell.
  */
-void resetBlockBytes()
+const size_t CHAIN_READ_BUFFER = 64 * 1024;
+struct ChainFile
 {
-	//Initialize the fields
-	memset( &blockPrevHash[0], 0, BLOCK_PREV_HASH_SIZE);
-	memset( &blockTimestamp.byteTime[0], 0, BLOCK_TIMESTAMP_SIZE);
-	//memset( &blockCaseID[0], 0, BLOCK_CASE_ID_SIZE);
-	//memset( &blockItemID[0], 0, BLOCK_ITEM_ID_SIZE);
-	for( int i = 0; i < BLOCK_CASE_ID_SIZE; i++ )
-	{
-		blockCaseID[i] = '0';
-	}
-	for( int i = 0; i < BLOCK_ITEM_ID_SIZE; i++ )
-	{
-		blockItemID[i] = '0';
-	}
-	for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
-	{
-		blockState[i] = '\0';
-	}
-	for( int i = 0; i < BLOCK_CREATOR_SIZE; i++ )
-	{
-		blockCreator[i] = '\0';
-	}
-	for( int i = 0; i < BLOCK_OWNER_SIZE; i++ )
+	vector<ChainSegment> segs;
+	vector<int> fds;
+	uint64_t pos;					//logical read position
+	uint64_t size;					//logical size of the chain
+	vector<unsigned char> buf;		//read-ahead buffer
+	uint64_t bufStart;				//logical offset of buf[0]
+	size_t bufLen;					//valid bytes in buf
+};
+
+/**
+ * @dev Open every segment of the chain for reading
+ * @return false if the chain does not exist
+ */
+bool chainOpen( ChainFile &chain )
+{
+	loadSegments( chain.segs );
+	chain.fds.assign( chain.segs.size(), -1 );
+	chain.pos = 0;
+	chain.size = 0;
+	chain.bufStart = 0;
+	chain.bufLen = 0;
+	bool exists = false;
+	for( size_t i = 0; i < chain.segs.size(); i++ )
 	{
-		blockOwner[i] = '\0';
+		chain.fds[i] = open( chain.segs[i].path.c_str(), O_RDONLY );
+		if( chain.fds[i] >= 0 )
+		{
+			exists = true;
+			//the active segment may have grown since the manifest was read
+			struct stat info;
+			if( 0 == fstat( chain.fds[i], &info ) )
+			{
+				chain.segs[i].length = info.st_size;
+			}
+		}
+		chain.size = chain.segs[i].base + chain.segs[i].length;
 	}
-	blockDataLen.intLen = 0;
+	chain.buf.resize( CHAIN_READ_BUFFER );
+	return exists;
 }
 
 /**
- * @dev This method takes all the block info and converts into a block that gets it's
- *		hash computed
+ * @dev Release all segment descriptors
  */
-string recomputeHash( unsigned char* readPrevHash, unsigned char* readTimestamp, unsigned char* readCaseId,
-						unsigned char* readItemId, unsigned char* readState, unsigned char* readCreator,
-						unsigned char* readOwner, unsigned char* readDataLen, unsigned char* dataField, int dataFieldLen )
+void chainClose( ChainFile &chain )
 {
-	string completeBlock = "";
-	//append the sections in order
-	completeBlock.append((const char*)readPrevHash, BLOCK_PREV_HASH_SIZE);
-	completeBlock.append((const char*)readTimestamp, BLOCK_TIMESTAMP_SIZE);
-	completeBlock.append((const char*)readCaseId, BLOCK_CASE_ID_SIZE);
-	completeBlock.append((const char*)readItemId, BLOCK_ITEM_ID_SIZE);
-	completeBlock.append((const char*)readState, BLOCK_STATE_SIZE);
-	completeBlock.append((const char*)readCreator, BLOCK_CREATOR_SIZE);
-	completeBlock.append((const char*)readOwner, BLOCK_OWNER_SIZE);
-	completeBlock.append((const char*)readDataLen, BLOCK_DATA_LEN_SIZE);
-	
-	//append the data field (passed as an arg)
-	completeBlock.append((const char*)dataField, dataFieldLen );
-	//compute and append the hash value of this block
-	string result = computeHash(completeBlock);
-	
-	return result;
+	for( size_t i = 0; i < chain.fds.size(); i++ )
+	{
+		if( chain.fds[i] >= 0 )
+		{
+			close( chain.fds[i] );
+		}
+	}
+	chain.fds.clear();
 }
 
-/**
- * @dev This method takes all the block info and converts into a block that gets
- *		added to the end of the blockchain
- */
-string blockToString( string dataField )
+uint64_t chainTell( ChainFile &chain )
 {
-	string completeBlock = "";
-	//append the sections in order
-	completeBlock.append((const char*)&blockPrevHash[0], BLOCK_PREV_HASH_SIZE);
-	completeBlock.append((const char*)&blockTimestamp.byteTime[0], BLOCK_TIMESTAMP_SIZE);
-	completeBlock.append((const char*)&blockCaseID[0], BLOCK_CASE_ID_SIZE);
-	completeBlock.append((const char*)&blockItemID[0], BLOCK_ITEM_ID_SIZE);
-	completeBlock.append((const char*)&blockState[0], BLOCK_STATE_SIZE);
-	completeBlock.append((const char*)&blockCreator[0], BLOCK_CREATOR_SIZE);
-	completeBlock.append((const char*)&blockOwner[0], BLOCK_OWNER_SIZE);
-	completeBlock.append((const char*)&blockDataLen.byteLen[0], BLOCK_DATA_LEN_SIZE);
-	
-	//append the data field (passed as an arg)
-	completeBlock.append( dataField );
-	
-	return completeBlock;
+	return chain.pos;
+}
+
+uint64_t chainSize( ChainFile &chain )
+{
+	return chain.size;
+}
+
+void chainSeek( ChainFile &chain, uint64_t offset )
+{
+	chain.pos = offset;
+}
+
+void chainSkip( ChainFile &chain, int64_t delta )
+{
+	chain.pos += delta;
 }
 
 /**
- * @dev This method iterates the blockchain for a given evidence item and returns it latest state
- * @param The item name to search for
+ * @dev Index of the segment holding a logical offset
  */
-int getEvidenceState( unsigned char* itemToCheck )
+int chainSegmentAt( ChainFile &chain, uint64_t offset )
 {
-	int latestState = -1;
-	//confirm the file exists before attempting to read it
-	if( fileExists() )
+	for( size_t i = 0; i < chain.segs.size(); i++ )
 	{
-		//get the current contents of the blockchain
-		FILE* fPtr;
-		fPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( fPtr, 0, SEEK_SET );
-		//store the end of the file location
-		FILE* endPtr;
-		endPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( endPtr, 0, SEEK_END );
-		
-		//set an inital hash to compare (known to be all 0s)
-		unsigned char initHash[BLOCK_PREV_HASH_SIZE];
-		memset( &initHash[0], 0, BLOCK_PREV_HASH_SIZE);
-		string recomputedHash = "";
-		recomputedHash.append((const char*)&initHash[0], BLOCK_PREV_HASH_SIZE);
-		//loop all blocks
-		while( (ftell(fPtr) + BLOCK_MIN_SIZE) <= ftell(endPtr) )
-		{
-			/*printf("fPtr %d\n", ftell(fPtr));
-			printf("endPtr %d\n", ftell(endPtr));*/
-			//store the reads of data (Data field will be allocated for each block)
-			unsigned char readPrevHash[BLOCK_PREV_HASH_SIZE];
-			unsigned char readCase[BLOCK_CASE_ID_SIZE];
-			unsigned char readItem[BLOCK_ITEM_ID_SIZE];
-			unsigned char readState[BLOCK_STATE_SIZE];
-			unsigned char readCreator[BLOCK_CREATOR_SIZE];
-			unsigned char readOwner[BLOCK_OWNER_SIZE];
-			union
-			{
-				uint64_t dblTime;
-				unsigned char byteTime[BLOCK_TIMESTAMP_SIZE];
-			} readTimestamp;
-			union
-			{
-				unsigned int intLen;
-				unsigned char byteLen[4];
-			} readDataLen;
-			unsigned char readCurHash[BLOCK_PREV_HASH_SIZE];
-			
-			//from the start of the block, read the data
-			fread( readPrevHash, sizeof(char), BLOCK_PREV_HASH_SIZE, fPtr);
-			fread( readTimestamp.byteTime, sizeof(char), BLOCK_TIMESTAMP_SIZE, fPtr);
-			fread( readCase, sizeof(char), BLOCK_CASE_ID_SIZE, fPtr);
-			fread( readItem, sizeof(char), BLOCK_ITEM_ID_SIZE, fPtr);
-			fread( readState, sizeof(char), BLOCK_STATE_SIZE, fPtr );
-			fread( readCreator, sizeof(char), BLOCK_CREATOR_SIZE, fPtr );
-			fread( readOwner, sizeof(char), BLOCK_OWNER_SIZE, fPtr );
-			fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-			int lengthOfData = readDataLen.intLen;
-			unsigned char dataField[lengthOfData];
-			if( lengthOfData > 0 )
-			{
-				fread( &dataField[0], sizeof(char), lengthOfData, fPtr );
-			}
-			
-			//check computed hash on last block matches logged prevHash in current block
-			string prevHashResult = "";
-			prevHashResult.append((const char*)&readPrevHash[0], BLOCK_PREV_HASH_SIZE);
-			bool hashMatch = true;
-			if( 0 != recomputedHash.compare(prevHashResult) )
-			{
-				hashMatch = false;
-			}
-			
-			//proceed with efforts if the hashes match
-			if( hashMatch )
-			{
-				//check if the read item matches the one we're looking for
-				bool itemMatch = true;
-				for( int i = 0; i < BLOCK_ITEM_ID_SIZE; i++ )
-				{
-					if( readItem[i] != itemToCheck[i] )
-					{
-						itemMatch = false;
-					}
-				}
-				if( itemMatch )
-				{
-					//for convenience, copy the Case ID, Creator, & Owner of this evidence item
-					memcpy( &blockCaseID[0], &readCase[0], BLOCK_CASE_ID_SIZE );
-					memcpy( &blockCreator[0], &readCreator[0], BLOCK_CREATOR_SIZE );
-					memcpy( &blockOwner[0], &readOwner[0], BLOCK_OWNER_SIZE );
-					//now check the state of this item
-					//check for: CHECKEDIN, CHECKEDOUT, DESTROYED, DISPOSED, RELEASED
-					unsigned char tmpCI[] = {'C','H','E','C','K','E','D','I','N','\0','\0','\0'};
-					unsigned char tmpCO[] = {'C','H','E','C','K','E','D','O','U','T','\0','\0'};
-					unsigned char tmpDE[] = {'D','E','S','T','R','O','Y','E','D','\0','\0','\0'};
-					unsigned char tmpDI[] = {'D','I','S','P','O','S','E','D','\0','\0','\0','\0'};
-					unsigned char tmpRE[] = {'R','E','L','E','A','S','E','D','\0','\0','\0','\0'};
-					//CHECKEDIN check
-					bool stateMatch = true;
-					for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
-					{
-						if( readState[i] != tmpCI[i] )
-						{
-							stateMatch = false;
-						}
-					}
-					if( stateMatch )
-					{
-						latestState = (int)CHECKEDIN;
-					}
-					//CHECKEDOUT check
-					stateMatch = true;
-					for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
-					{
-						if( readState[i] != tmpCO[i] )
-						{
-							stateMatch = false;
-						}
-					}
-					if( stateMatch )
-					{
-						latestState = (int)CHECKEDOUT;
-					}
-					//DISPOSED check
-					stateMatch = true;
-					for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
-					{
-						if( readState[i] != tmpDI[i] )
-						{
-							stateMatch = false;
-						}
-					}
-					if( stateMatch )
-					{
-						latestState = (int)DISPOSED;
-					}
-					//DESTROYED check
-					stateMatch = true;
-					for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
-					{
-						if( readState[i] != tmpDE[i] )
-						{
-							stateMatch = false;
-						}
-					}
-					if( stateMatch )
-					{
-						latestState = (int)DESTROYED;
-					}
-					//RELEASED check
-					stateMatch = true;
-					for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
-					{
-						if( readState[i] != tmpRE[i] )
-						{
-							stateMatch = false;
-						}
-					}
-					if( stateMatch )
-					{
-						latestState = (int)RELEASED;
-					}
-				}
-				//proceed to next block in chain after computing hash to check
-				recomputedHash = recomputeHash( &readPrevHash[0], &readTimestamp.byteTime[0],
-						&readCase[0], &readItem[0], &readState[0], &readCreator[0],
-						&readOwner[0], &readDataLen.byteLen[0], &dataField[0], lengthOfData);
-				//for convenience, store this has in the blockPrevHash
-				memcpy( &blockPrevHash[0], recomputedHash.c_str(), BLOCK_PREV_HASH_SIZE );
-			}
-			else
-			{
-				printf("Blockchain corruption detected\n");
-				//skip to end, bad blockchain
-				fseek( fPtr, 0, SEEK_END );
-				latestState = -2;
-			}
+		if( offset < (chain.segs[i].base + chain.segs[i].length) )
+		{
+			return i;
 		}
-		fclose(fPtr);
 	}
-	return latestState;
+	return chain.segs.size() - 1;
 }
 
 /**
- * @dev This method compares a password against known allowable passwords and
- *		returns a number reflecting who's password it belongs to
- * @param The password to check
+ * @dev Read from the current position and advance it (like fread)
+ * @return the number of bytes copied into "dst"
  */
-int checkPassword( string cmpPassword )
+size_t chainRead( ChainFile &chain, void* dst, size_t len )
 {
-	int passwordsMatch = -1;
-	if( 0 == cmpPassword.compare( BCHOC_PASSWORD_CREATOR ) )
+	unsigned char* out = (unsigned char*)dst;
+	size_t copied = 0;
+	while( copied < len )
 	{
-		passwordsMatch = 0;
+		//serve what we can from the read-ahead buffer
+		if( (chain.pos >= chain.bufStart) && (chain.pos < (chain.bufStart + chain.bufLen)) )
+		{
+			size_t inBuf = (chain.bufStart + chain.bufLen) - chain.pos;
+			size_t take = min( inBuf, len - copied );
+			memcpy( out + copied, &chain.buf[chain.pos - chain.bufStart], take );
+			copied += take;
+			chain.pos += take;
+			continue;
+		}
+		if( chain.pos >= chain.size )
+		{
+			break;
+		}
+		//refill from the segment holding the position (never spans segments)
+		int seg = chainSegmentAt( chain, chain.pos );
+		uint64_t segEnd = chain.segs[seg].base + chain.segs[seg].length;
+		size_t want = min( (uint64_t)chain.buf.size(), segEnd - chain.pos );
+		ssize_t got = -1;
+		if( chain.fds[seg] >= 0 )
+		{
+			got = pread( chain.fds[seg], &chain.buf[0], want, chain.pos - chain.segs[seg].base );
+		}
+		if( got <= 0 )
+		{
+			break;
+		}
+		chain.bufStart = chain.pos;
+		chain.bufLen = got;
 	}
-	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_POLICE ) )
+	return copied;
+}
+
+/**
+ * @dev Read the whole block at the current position into "block", which is
+ *		reused from one block to the next so a scan does not allocate per block
+ * @param limit is the offset the block must end by
+ * @return false if the block's data field runs past "limit" (the position is
+ *		left at the end of its header)
+ */
+bool chainReadBlock( ChainFile &chain, vector<unsigned char> &block, uint64_t limit )
+{
+	if( block.size() < BLOCK_MIN_SIZE )
 	{
-		passwordsMatch = 1;
+		block.resize( BLOCK_MIN_SIZE );
 	}
-	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_LAWYER ) )
+	chainRead( chain, &block[0], BLOCK_MIN_SIZE );
+	uint32_t dataLen = BlockLayout::DataLen::load<uint32_t>( &block[0] );
+	if( (chainTell(chain) + dataLen) > limit )
 	{
-		passwordsMatch = 2;
+		return false;
 	}
-	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_ANALYST ) )
+	if( block.size() < (BLOCK_MIN_SIZE + (size_t)dataLen) )
 	{
-		passwordsMatch = 3;
+		block.resize( BLOCK_MIN_SIZE + dataLen );
 	}
-	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_EXECUTIVE ) )
+	if( dataLen > 0 )
 	{
-		passwordsMatch = 4;
+		chainRead( chain, &block[BLOCK_MIN_SIZE], dataLen );
 	}
-	return passwordsMatch;
+	return true;
 }
 
-/*
- * =============
- * Methods providing core functionality
- * =============
- */
- 
 /**
- * @dev Method to create an INITIAL block if none exists
+ * @dev When a scan sits at the start of a sealed segment whose summary shows it
+ *		holds no block for "caseId", jump past that segment (and any that follow)
+ * @param blocksSkipped (optional) is increased by the number of blocks passed over
+ * @return true if the read position moved
  */
-int init()
+bool chainSkipSegmentsWithoutCase( ChainFile &chain, const string &caseId, uint64_t* blocksSkipped = NULL )
 {
-	int result = 0;
-	bool prevInit = cocIsInit();
-	if( prevInit )
+	bool moved = false;
+	for( size_t i = 0; i < chain.segs.size(); i++ )
+	{
+		ChainSegment &seg = chain.segs[i];
+		if( seg.sealed && (chain.pos == seg.base) &&
+			(find( seg.caseIds.begin(), seg.caseIds.end(), caseId ) == seg.caseIds.end()) )
+		{
+			chain.pos = seg.base + seg.length;
+			moved = true;
+			if( NULL != blocksSkipped )
+			{
+				*blocksSkipped += seg.blockCount;
+			}
+		}
+	}
+	return moved;
+}
+
+/**
+ * @dev Replace the manifest with "contents" through a synced temporary file
+ * @return false if the new manifest is not durably in place
+ */
+bool writeManifest( const string &contents )
+{
+	string manifestFile = COC_FILE + ".manifest";
+	string tmpFile = manifestFile + ".tmp";
+	int tmpFd = open( tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( tmpFd < 0 )
+	{
+		return false;
+	}
+	bool written = writeFull( tmpFd, (const unsigned char*)contents.data(), contents.size() ) && (0 == fsync( tmpFd ));
+	close( tmpFd );
+	if( !written || (0 != rename( tmpFile.c_str(), manifestFile.c_str() )) )
+	{
+		unlink( tmpFile.c_str() );
+		return false;
+	}
+	return syncParentFolder( COC_FILE );
+}
+
+/**
+ * @dev Seal the active segment once it reaches BCHOC_SEGMENT_SIZE. The manifest
+ *		entry is written first, then the active file becomes a read-only
+ *		segment and a new empty active file is started.
+ * @return false if the segment could not be sealed (the chain is left as it was)
+ */
+bool sealSegmentIfFull()
+{
+	if( (0 == COC_SEGMENT_SIZE) || (fileSize( COC_FILE ) < COC_SEGMENT_SIZE) )
+	{
+		return true;
+	}
+	//only a segment that is safely on disk is sealed
+	if( !syncChain( true ) )
+	{
+		return false;
+	}
+	//summarize the active segment
+	ChainFile chain;
+	chainOpen( chain );
+	ChainSegment seg = chain.segs.back();
+	int index = chain.segs.size() - 1;
+	seg.blockCount = 0;
+	seg.minTime = 0;
+	seg.maxTime = 0;
+	set<string> cases;
+	set<string> items;
+	vector<unsigned char> wholeBlock;
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	chainSeek( chain, seg.base );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			//a damaged length, the segment is not sealed
+			chainClose( chain );
+			return true;
+		}
+		BlockView block( &wholeBlock[0] );
+		if( 0 == seg.blockCount )
+		{
+			seg.firstPrevHash = bytesToByteString( block.prevHash(), BLOCK_PREV_HASH_SIZE );
+			seg.minTime = block.time;
+		}
+		seg.minTime = min( seg.minTime, block.time );
+		seg.maxTime = max( seg.maxTime, block.time );
+		cases.insert( string( (const char*)block.caseId(), BLOCK_CASE_ID_SIZE ) );
+		items.insert( string( (const char*)block.itemId(), BLOCK_ITEM_ID_SIZE ) );
+		//hash the complete block (header + data field)
+		hashBlock( block.raw, block.size(), blockHash );
+		seg.lastHash = bytesToByteString( blockHash, BLOCK_PREV_HASH_SIZE );
+		seg.lastBlock = blockHead;
+		seg.blockCount++;
+	}
+	chainClose( chain );
+	seg.length = chainTell( chain ) - seg.base;
+	seg.itemCount = items.size();
+	seg.caseIds.assign( cases.begin(), cases.end() );
+	
+	//the new manifest is the old one plus an entry for this segment
+	string manifestFile = COC_FILE + ".manifest";
+	struct stat existence;
+	bool hadManifest = ( 0 == stat( manifestFile.c_str(), &existence ) );
+	string oldManifest = "";
+	{
+		ifstream oldFile( manifestFile.c_str(), std::ios::binary );
+		stringstream oldContents;
+		oldContents << oldFile.rdbuf();
+		oldManifest = oldContents.str();
+	}
+	stringstream newManifest;
+	if( 0 == oldManifest.size() )
+	{
+		newManifest << "# index base length lastBlock firstPrevHash lastHash blocks minTime maxTime items cases [caseIds]\n";
+	}
+	newManifest << oldManifest;
+	newManifest << index << " " << seg.base << " " << seg.length << " " << seg.lastBlock << " "
+		<< seg.firstPrevHash << " " << seg.lastHash << " " << seg.blockCount << " "
+		<< seg.minTime << " " << seg.maxTime << " " << seg.itemCount << " " << seg.caseIds.size();
+	for( size_t i = 0; i < seg.caseIds.size(); i++ )
+	{
+		newManifest << " " << seg.caseIds[i];
+	}
+	newManifest << "\n";
+	if( !writeManifest( newManifest.str() ) )
+	{
+		printf("Unable to write segment manifest, segment %d not sealed\n", index);
+		return false;
+	}
+	
+	//turn the active file into a sealed, read-only segment only once the
+	//manifest entry is durable
+	if( !closeChain() || (0 != rename( COC_FILE.c_str(), segmentPath( index ).c_str() )) )
+	{
+		printf("Unable to rename %s to %s, segment %d not sealed\n", COC_FILE.c_str(), segmentPath( index ).c_str(), index);
+		//take the entry back out so the manifest never names a missing segment
+		bool restored = hadManifest ? writeManifest( oldManifest ) : (0 == unlink( manifestFile.c_str() ));
+		if( !restored )
+		{
+			printf("Unable to restore %s\n", manifestFile.c_str());
+		}
+		return false;
+	}
+	chmod( segmentPath( index ).c_str(), 0444 );
+	if( !syncParentFolder( COC_FILE ) )
+	{
+		printf("Failed to sync blockchain folder to disk\n");
+		return false;
+	}
+	//start the next active segment
+	return openChainForAppend();
+}
+
+/*
+ * =============
+ * Summary filters
+ * =============
+ * "<chain>.filters" summarizes the chain in ranges of FILTER_RANGE_BLOCKS blocks.
+ * Every range records its offsets, min/max timestamps and a Bloom filter over
+ * the (encrypted) Case IDs and Item IDs of its blocks. Queries filtering by case
+ * or item step over any range whose filter says it cannot hold a match. Only
+ * complete ranges are recorded; the blocks after the last one are always read.
+ */
+const int FILTER_RANGE_BLOCKS = 1024;
+const int FILTER_BLOOM_BYTES = 2048;
+const int FILTER_BLOOM_HASHES = 4;
+
+struct RangeFilter
+{
+	uint64_t start;			//logical offset of the first block in the range
+	uint64_t end;			//logical offset just past the last block
+	uint64_t minTime;
+	uint64_t maxTime;
+	uint32_t blockCount;
+	uint32_t reserved;
+	unsigned char firstPrevHash[BLOCK_PREV_HASH_SIZE];	//detects a replaced chain
+	unsigned char bloom[FILTER_BLOOM_BYTES];
+};
+static_assert( sizeof(RangeFilter) == 4*8 + 2*4 + BLOCK_PREV_HASH_SIZE + FILTER_BLOOM_BYTES,
+				"RangeFilter is written to disk as-is and must not be padded" );
+
+/**
+ * @dev Positions of a key in the Bloom filter (double hashing over FNV-1a)
+ * @param isCaseId keeps Case IDs and Item IDs from colliding with each other
+ */
+void bloomPositions( const unsigned char* key, int keyLen, bool isCaseId, uint32_t* positions )
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = (hash ^ (isCaseId ? 'c' : 'i')) * 1099511628211ULL;
+	for( int i = 0; i < keyLen; i++ )
+	{
+		hash = (hash ^ key[i]) * 1099511628211ULL;
+	}
+	uint32_t h1 = (uint32_t)hash;
+	uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+	for( int i = 0; i < FILTER_BLOOM_HASHES; i++ )
+	{
+		positions[i] = (h1 + i * h2) % (FILTER_BLOOM_BYTES * 8);
+	}
+}
+
+void bloomAdd( unsigned char* bloom, const unsigned char* key, int keyLen, bool isCaseId )
+{
+	uint32_t positions[FILTER_BLOOM_HASHES];
+	bloomPositions( key, keyLen, isCaseId, positions );
+	for( int i = 0; i < FILTER_BLOOM_HASHES; i++ )
+	{
+		bloom[positions[i] / 8] |= (1 << (positions[i] % 8));
+	}
+}
+
+bool bloomMayContain( const unsigned char* bloom, const unsigned char* key, int keyLen, bool isCaseId )
+{
+	uint32_t positions[FILTER_BLOOM_HASHES];
+	bloomPositions( key, keyLen, isCaseId, positions );
+	for( int i = 0; i < FILTER_BLOOM_HASHES; i++ )
+	{
+		if( 0 == (bloom[positions[i] / 8] & (1 << (positions[i] % 8))) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @dev Load the range filters and record any ranges completed since the last
+ *		update. If the recorded ranges no longer match the chain (it was
+ *		replaced or cut short) they are rebuilt from the start.
+ * @param filters receives the ranges in chain order
+ */
+void updateRangeFilters( vector<RangeFilter> &filters )
+{
+	filters.clear();
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		return;
+	}
+	string filterFile = COC_FILE + ".filters";
+	bool rebuild = false;
+	int filterFd = open( filterFile.c_str(), O_RDONLY );
+	if( filterFd >= 0 )
+	{
+		RangeFilter range;
+		while( sizeof(RangeFilter) == read( filterFd, &range, sizeof(RangeFilter) ) )
+		{
+			filters.push_back( range );
+		}
+		close( filterFd );
+	}
+	//the last recorded range must still be part of this chain
+	if( filters.size() > 0 )
+	{
+		RangeFilter &last = filters.back();
+		unsigned char prevHash[BLOCK_PREV_HASH_SIZE];
+		chainSeek( chain, last.start );
+		if( (last.end > chainSize(chain)) ||
+			(BLOCK_PREV_HASH_SIZE != chainRead( chain, prevHash, BLOCK_PREV_HASH_SIZE )) ||
+			(0 != memcmp( prevHash, last.firstPrevHash, BLOCK_PREV_HASH_SIZE )) )
+		{
+			filters.clear();
+			rebuild = true;
+		}
+	}
+	
+	//summarize every complete range after the last recorded one
+	vector<RangeFilter> added;
+	RangeFilter range;
+	memset( &range, 0, sizeof(RangeFilter) );
+	range.start = (filters.size() > 0) ? filters.back().end : 0;
+	chainSeek( chain, range.start );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		unsigned char header[BLOCK_MIN_SIZE];
+		chainRead( chain, header, BLOCK_MIN_SIZE );
+		unsigned int dataLen = 0;
+		uint64_t blockTime = 0;
+		memcpy( &dataLen, &header[BLOCK_DATA_LEN_OFFSET], BLOCK_DATA_LEN_SIZE );
+		memcpy( &blockTime, &header[BLOCK_TIMESTAMP_OFFSET], BLOCK_TIMESTAMP_SIZE );
+		if( (chainTell(chain) + dataLen) > chainSize(chain) )
+		{
+			//incomplete block at the end of the chain
+			break;
+		}
+		chainSkip( chain, dataLen );
+		if( 0 == range.blockCount )
+		{
+			memcpy( range.firstPrevHash, &header[BLOCK_PREV_HASH_OFFSET], BLOCK_PREV_HASH_SIZE );
+			range.minTime = blockTime;
+		}
+		range.minTime = min( range.minTime, blockTime );
+		range.maxTime = max( range.maxTime, blockTime );
+		bloomAdd( range.bloom, &header[BLOCK_CASE_ID_OFFSET], BLOCK_CASE_ID_SIZE, true );
+		bloomAdd( range.bloom, &header[BLOCK_ITEM_ID_OFFSET], BLOCK_ITEM_ID_SIZE, false );
+		range.blockCount++;
+		if( FILTER_RANGE_BLOCKS == range.blockCount )
+		{
+			range.end = chainTell( chain );
+			added.push_back( range );
+			memset( &range, 0, sizeof(RangeFilter) );
+			range.start = chainTell( chain );
+		}
+	}
+	chainClose( chain );
+	
+	//record the new ranges (the filters are only a cache, so a read-only
+	//folder simply means they are recomputed next time)
+	if( rebuild || (added.size() > 0) )
+	{
+		int flags = O_WRONLY | O_CREAT | (rebuild ? O_TRUNC : O_APPEND);
+		filterFd = open( filterFile.c_str(), flags, 0644 );
+		if( filterFd >= 0 )
+		{
+			if( added.size() > 0 )
+			{
+				write( filterFd, &added[0], added.size() * sizeof(RangeFilter) );
+			}
+			close( filterFd );
+		}
+		filters.insert( filters.end(), added.begin(), added.end() );
+	}
+}
+
+/**
+ * @dev When a scan sits at a block boundary inside a sealed segment or a
+ *		filtered range that cannot hold a block for the requested case and/or
+ *		item, jump past it. An empty filter string matches everything.
+ * @param blocksSkipped (optional) is increased by the number of blocks passed over
+ * @return true if the read position moved
+ */
+bool chainSkipUnmatched( ChainFile &chain, vector<RangeFilter> &filters, const string &caseId, const string &itemId,
+							uint64_t* blocksSkipped = NULL )
+{
+	uint64_t startPos = chain.pos;
+	bool moved = true;
+	while( moved )
+	{
+		moved = false;
+		//sealed segments know exactly which cases they hold
+		if( (caseId.size() > 0) && chainSkipSegmentsWithoutCase( chain, caseId, blocksSkipped ) )
+		{
+			moved = true;
+		}
+		//find the range holding the position (ranges are in chain order)
+		size_t low = 0;
+		size_t high = filters.size();
+		while( low < high )
+		{
+			size_t mid = (low + high) / 2;
+			if( filters[mid].end <= chain.pos )
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		//(when counting blocks only whole ranges can be skipped)
+		if( (low < filters.size()) && (filters[low].start <= chain.pos) &&
+			((NULL == blocksSkipped) || (filters[low].start == chain.pos)) )
+		{
+			RangeFilter &range = filters[low];
+			bool mayMatch = true;
+			if( (caseId.size() > 0) &&
+				!bloomMayContain( range.bloom, (const unsigned char*)caseId.data(), BLOCK_CASE_ID_SIZE, true ) )
+			{
+				mayMatch = false;
+			}
+			if( (itemId.size() > 0) &&
+				!bloomMayContain( range.bloom, (const unsigned char*)itemId.data(), BLOCK_ITEM_ID_SIZE, false ) )
+			{
+				mayMatch = false;
+			}
+			if( !mayMatch )
+			{
+				chain.pos = range.end;
+				moved = true;
+				if( NULL != blocksSkipped )
+				{
+					*blocksSkipped += range.blockCount;
+				}
+			}
+		}
+	}
+	return (chain.pos != startPos);
+}
+
+/*
+ * =============
+ * Scan arena
+ * =============
+ * Scans draw their scratch memory and result records from a bump allocator
+ * instead of making small heap allocations for every block. Memory comes from
+ * fixed size chunks that never move, so pointers stay valid until the arena
+ * is reset (per block, for scratch) or released (at the end of the command).
+ * Reset keeps the chunks, so a scan stops allocating once they are warm.
+ */
+const size_t ARENA_CHUNK_SIZE = 64 * 1024;
+
+struct ScanArena
+{
+	vector<unsigned char*> chunks;
+	vector<size_t> sizes;
+	size_t current;			//chunk being filled
+	size_t used;			//bytes taken from it
+};
+
+/**
+ * @dev Take "len" bytes (8 byte aligned) from the arena
+ */
+unsigned char* arenaAlloc( ScanArena &arena, size_t len )
+{
+	len = (len + 7) & ~(size_t)7;
+	while( arena.current < arena.chunks.size() )
+	{
+		if( (arena.used + len) <= arena.sizes[arena.current] )
+		{
+			unsigned char* taken = arena.chunks[arena.current] + arena.used;
+			arena.used += len;
+			return taken;
+		}
+		arena.current++;
+		arena.used = 0;
+	}
+	size_t chunkSize = max( len, ARENA_CHUNK_SIZE );
+	arena.chunks.push_back( new unsigned char[chunkSize] );
+	arena.sizes.push_back( chunkSize );
+	arena.current = arena.chunks.size() - 1;
+	arena.used = len;
+	return arena.chunks[arena.current];
+}
+
+/**
+ * @dev Copy bytes into the arena
+ */
+unsigned char* arenaCopy( ScanArena &arena, const unsigned char* source, size_t len )
+{
+	unsigned char* copy = arenaAlloc( arena, len );
+	memcpy( copy, source, len );
+	return copy;
+}
+
+/**
+ * @dev Forget everything taken from the arena but keep its chunks for reuse
+ */
+void arenaReset( ScanArena &arena )
+{
+	arena.current = 0;
+	arena.used = 0;
+}
+
+/**
+ * @dev Return the arena's chunks to the heap
+ */
+void arenaRelease( ScanArena &arena )
+{
+	for( size_t i = 0; i < arena.chunks.size(); i++ )
+	{
+		delete[] arena.chunks[i];
+	}
+	arena.chunks.clear();
+	arena.sizes.clear();
+	arenaReset( arena );
+}
+
+/*
+ * =============
+ * Merkle accumulator
+ * =============
+ * Alongside the prev-hash chain, "<chain>.mmr" holds a Merkle Mountain Range
+ * whose leaves are the hashes of the blocks in chain order. It is append-only:
+ * adding a leaf writes the leaf plus the parents it completes, so inclusion
+ * proofs only need the O(log n) siblings and peaks. The file starts with a
+ * small header recording how much of the chain it covers; nodes follow as
+ * 32 byte hashes in MMR position order. Every MERKLE_CHECKPOINT_LEAVES leaves
+ * the root is appended to "<chain>.mmr.roots" so it can be published.
+ *	leaf	= hash of the block (the value the next block stores as Previous Hash)
+ *	node	= SHA-256( 0x01 | left | right )
+ *	root	= SHA-256( 0x02 | leaf count (8 bytes) | peaks from left to right )
+ */
+const uint64_t MERKLE_CHECKPOINT_LEAVES = 1024;
+const int MERKLE_NODE_SIZE = 32;
+
+struct MerkleHeader
+{
+	char magic[8];			//"BCHOCMMR"
+	uint64_t leafCount;		//blocks covered
+	uint64_t chainEnd;		//logical offset just past the last covered block
+	uint64_t lastBlock;		//logical offset of the last covered block
+	unsigned char reserved[32];
+};
+static_assert( sizeof(MerkleHeader) == 64, "MerkleHeader is written to disk as-is" );
+
+struct MerkleRootRecord
+{
+	uint64_t leafCount;
+	uint64_t chainEnd;
+	uint64_t timestamp;
+	unsigned char root[MERKLE_NODE_SIZE];
+};
+static_assert( sizeof(MerkleRootRecord) == 56, "MerkleRootRecord is written to disk as-is" );
+
+struct MerkleLog
+{
+	int fd;
+	bool checked;		//header has been validated against the chain
+	MerkleHeader head;
+};
+MerkleLog COC_MERKLE = { -1, false };
+
+uint64_t popCount( uint64_t value )
+{
+	uint64_t count = 0;
+	while( value )
+	{
+		value &= (value - 1);
+		count++;
+	}
+	return count;
+}
+
+/**
+ * @dev Number of nodes in an MMR with "leaves" leaves
+ */
+uint64_t mmrSize( uint64_t leaves )
+{
+	return 2 * leaves - popCount( leaves );
+}
+
+/**
+ * @dev Position of leaf "index" among the MMR nodes
+ */
+uint64_t mmrLeafPos( uint64_t index )
+{
+	return 2 * index - popCount( index );
+}
+
+/**
+ * @dev node = SHA-256( 0x01 | left | right )
+ */
+void merkleParent( const unsigned char* left, const unsigned char* right, unsigned char* parent )
+{
+	unsigned char joined[1 + 2 * MERKLE_NODE_SIZE];
+	joined[0] = 0x01;
+	memcpy( &joined[1], left, MERKLE_NODE_SIZE );
+	memcpy( &joined[1 + MERKLE_NODE_SIZE], right, MERKLE_NODE_SIZE );
+	SHA256( joined, sizeof(joined), parent );
+}
+
+/**
+ * @dev root = SHA-256( 0x02 | leaf count | peaks )
+ */
+void merkleBagPeaks( uint64_t leaves, const vector<string> &peaks, unsigned char* root )
+{
+	string joined = "";
+	joined.push_back( 0x02 );
+	joined.append( (const char*)&leaves, sizeof(uint64_t) );
+	for( size_t i = 0; i < peaks.size(); i++ )
+	{
+		joined.append( peaks[i] );
+	}
+	SHA256( (const unsigned char*)joined.data(), joined.size(), root );
+}
+
+bool merkleReadNode( int fd, uint64_t pos, unsigned char* node )
+{
+	return preadFull( fd, node, MERKLE_NODE_SIZE, sizeof(MerkleHeader) + pos * MERKLE_NODE_SIZE );
+}
+
+bool merkleWriteNode( int fd, uint64_t pos, const unsigned char* node )
+{
+	return MERKLE_NODE_SIZE == pwrite( fd, node, MERKLE_NODE_SIZE, sizeof(MerkleHeader) + pos * MERKLE_NODE_SIZE );
+}
+
+/**
+ * @dev Heights and positions of the peaks of an MMR, left to right
+ */
+void mmrPeaks( uint64_t leaves, vector<int> &heights, vector<uint64_t> &positions )
+{
+	heights.clear();
+	positions.clear();
+	uint64_t offset = 0;
+	for( int height = 63; height >= 0; height-- )
+	{
+		if( leaves & (1ULL << height) )
+		{
+			uint64_t treeSize = (1ULL << (height + 1)) - 1;
+			heights.push_back( height );
+			positions.push_back( offset + treeSize - 1 );
+			offset += treeSize;
+		}
+	}
+}
+
+/**
+ * @dev Compute the root over the first "leaves" leaves of an MMR file
+ */
+bool merkleRoot( int fd, uint64_t leaves, unsigned char* root )
+{
+	vector<int> heights;
+	vector<uint64_t> positions;
+	mmrPeaks( leaves, heights, positions );
+	vector<string> peaks;
+	for( size_t i = 0; i < positions.size(); i++ )
+	{
+		unsigned char node[MERKLE_NODE_SIZE];
+		if( !merkleReadNode( fd, positions[i], node ) )
+		{
+			return false;
+		}
+		peaks.push_back( string( (const char*)node, MERKLE_NODE_SIZE ) );
+	}
+	merkleBagPeaks( leaves, peaks, root );
+	return true;
+}
+
+/**
+ * @dev Add one leaf (and the parents it completes) to the accumulator
+ *		(the header's chainEnd must already include the leaf's block)
+ */
+bool merklePush( const unsigned char* leaf )
+{
+	uint64_t index = COC_MERKLE.head.leafCount;
+	uint64_t pos = mmrSize( index );
+	unsigned char current[MERKLE_NODE_SIZE];
+	memcpy( current, leaf, MERKLE_NODE_SIZE );
+	if( !merkleWriteNode( COC_MERKLE.fd, pos, current ) )
+	{
+		return false;
+	}
+	//every trailing 1 bit of the leaf index completes one more subtree
+	int height = 0;
+	while( index & 1 )
+	{
+		unsigned char left[MERKLE_NODE_SIZE];
+		uint64_t leftPos = pos - ((1ULL << (height + 1)) - 1);
+		if( !merkleReadNode( COC_MERKLE.fd, leftPos, left ) )
+		{
+			return false;
+		}
+		merkleParent( left, current, current );
+		pos++;
+		if( !merkleWriteNode( COC_MERKLE.fd, pos, current ) )
+		{
+			return false;
+		}
+		height++;
+		index >>= 1;
+	}
+	COC_MERKLE.head.leafCount++;
+	//publish a checkpoint root periodically
+	if( 0 == (COC_MERKLE.head.leafCount % MERKLE_CHECKPOINT_LEAVES) )
+	{
+		MerkleRootRecord record;
+		record.leafCount = COC_MERKLE.head.leafCount;
+		record.chainEnd = COC_MERKLE.head.chainEnd;
+		record.timestamp = unixTimestamp();
+		merkleRoot( COC_MERKLE.fd, record.leafCount, record.root );
+		string rootsFile = COC_FILE + ".mmr.roots";
+		int rootsFd = open( rootsFile.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644 );
+		if( rootsFd >= 0 )
+		{
+			write( rootsFd, &record, sizeof(record) );
+			close( rootsFd );
+		}
+	}
+	return true;
+}
+
+/**
+ * @dev Start the accumulator over from an empty tree
+ */
+void merkleReset()
+{
+	memset( &COC_MERKLE.head, 0, sizeof(MerkleHeader) );
+	memcpy( COC_MERKLE.head.magic, "BCHOCMMR", 8 );
+	ftruncate( COC_MERKLE.fd, sizeof(MerkleHeader) );
+	string rootsFile = COC_FILE + ".mmr.roots";
+	unlink( rootsFile.c_str() );
+}
+
+/**
+ * @dev Bring the accumulator up to date with the chain: validate it once per
+ *		command (rebuilding it if it no longer matches the chain) and add a
+ *		leaf for every block appended since it was last updated.
+ * @return false if the accumulator is not available
+ */
+bool merkleSync()
+{
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		return false;
+	}
+	if( COC_MERKLE.fd < 0 )
+	{
+		string merkleFile = COC_FILE + ".mmr";
+		COC_MERKLE.fd = open( merkleFile.c_str(), O_RDWR | O_CREAT, 0644 );
+		COC_MERKLE.checked = false;
+		if( COC_MERKLE.fd < 0 )
+		{
+			chainClose( chain );
+			return false;
+		}
+	}
+	if( !COC_MERKLE.checked )
+	{
+		//the header, node count and last leaf must all agree with the chain
+		bool valid = preadFull( COC_MERKLE.fd, &COC_MERKLE.head, sizeof(MerkleHeader), 0 ) &&
+					(0 == memcmp( COC_MERKLE.head.magic, "BCHOCMMR", 8 )) &&
+					(fileSize( COC_FILE + ".mmr" ) >= sizeof(MerkleHeader) + mmrSize( COC_MERKLE.head.leafCount ) * MERKLE_NODE_SIZE) &&
+					(COC_MERKLE.head.chainEnd <= chainSize( chain ));
+		if( valid && (COC_MERKLE.head.leafCount > 0) )
+		{
+			string lastBlock( COC_MERKLE.head.chainEnd - COC_MERKLE.head.lastBlock, '\0' );
+			unsigned char leaf[MERKLE_NODE_SIZE];
+			chainSeek( chain, COC_MERKLE.head.lastBlock );
+			valid = (lastBlock.size() == chainRead( chain, &lastBlock[0], lastBlock.size() )) &&
+					merkleReadNode( COC_MERKLE.fd, mmrLeafPos( COC_MERKLE.head.leafCount - 1 ), leaf ) &&
+					(0 == memcmp( computeHash( lastBlock ).data(), leaf, MERKLE_NODE_SIZE ));
+		}
+		if( !valid )
+		{
+			merkleReset();
+		}
+		COC_MERKLE.checked = true;
+	}
+	
+	//add a leaf for every complete block after the covered part of the chain
+	bool grew = false;
+	vector<unsigned char> wholeBlock;
+	unsigned char leaf[MERKLE_NODE_SIZE];
+	chainSeek( chain, COC_MERKLE.head.chainEnd );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		hashBlock( block.raw, block.size(), leaf );
+		COC_MERKLE.head.chainEnd = chainTell( chain );
+		COC_MERKLE.head.lastBlock = blockHead;
+		if( !merklePush( leaf ) )
+		{
+			break;
+		}
+		grew = true;
+	}
+	chainClose( chain );
+	if( grew )
+	{
+		pwrite( COC_MERKLE.fd, &COC_MERKLE.head, sizeof(MerkleHeader), 0 );
+	}
+	return true;
+}
+
+/*
+ * =============
+ * Item index
+ * =============
+ * "<chain>.idx" holds one entry per block in chain order: the block's logical
+ * offset and the number of the previous block with the same Item ID. The heads
+ * table "<chain>.idx.heads" is an open addressing hash table from Item ID to
+ * the item's first and latest block. Starting at an item's head and following
+ * the back-pointers visits only that item's blocks, newest first. Block numbers
+ * are stored plus one so that 0 means "none". Both files are only a cache: they
+ * are extended on every append and rebuilt if they no longer match the chain.
+ * Entries are fixed width, so block N's offset is one read away (show block,
+ * sampled verify, and the partitions of verify's parallel hashing).
+ */
+const uint64_t INDEX_MIN_SLOTS = 1024;
+
+struct IndexHeader
+{
+	char magic[8];					//"BCHOCIDX"
+	uint64_t blockCount;			//blocks covered
+	uint64_t chainEnd;				//logical offset just past the last covered block
+	uint64_t lastBlock;				//logical offset of the last covered block
+	uint64_t headSlots;				//slots in the heads table (a power of 2)
+	uint64_t headUsed;				//occupied slots
+	unsigned char reserved[16];
+};
+static_assert( sizeof(IndexHeader) == 64, "IndexHeader is written to disk as-is" );
+
+struct IndexEntry
+{
+	uint64_t offset;				//logical offset of the block
+	uint64_t prevSameItem;			//block number + 1 of the item's previous block
+};
+static_assert( sizeof(IndexEntry) == 16, "IndexEntry is written to disk as-is" );
+
+struct IndexHead
+{
+	unsigned char itemId[BLOCK_ITEM_ID_SIZE];
+	uint64_t first;					//block number + 1 of the item's first block (0 = empty slot)
+	uint64_t latest;				//block number + 1 of the item's latest block
+};
+static_assert( sizeof(IndexHead) == 48, "IndexHead is written to disk as-is" );
+
+struct ItemIndex
+{
+	int fd;
+	int headFd;
+	bool checked;		//header has been validated against the chain
+	IndexHeader head;
+	bool inMemory;		//a read-only command's private copy, not the files
+};
+thread_local ItemIndex COC_INDEX = { -1, -1, false };
+
+/**
+ * @dev Home slot of an Item ID in a heads table of "slots" entries (FNV-1a)
+ */
+uint64_t indexSlotOf( const unsigned char* itemId, uint64_t slots )
+{
+	uint64_t hash = 1469598103934665603ULL;
+	for( int i = 0; i < BLOCK_ITEM_ID_SIZE; i++ )
+	{
+		hash = (hash ^ itemId[i]) * 1099511628211ULL;
+	}
+	return hash & (slots - 1);
+}
+
+/**
+ * @dev Find the slot holding an Item ID, or the empty slot it would go in
+ * @return true if the item was found
+ */
+bool indexFindHead( const unsigned char* itemId, IndexHead &found, uint64_t &slot )
+{
+	slot = indexSlotOf( itemId, COC_INDEX.head.headSlots );
+	for( uint64_t probe = 0; probe < COC_INDEX.head.headSlots; probe++ )
+	{
+		if( !preadFull( COC_INDEX.headFd, &found, sizeof(IndexHead), slot * sizeof(IndexHead) ) )
+		{
+			break;
+		}
+		if( 0 == found.first )
+		{
+			return false;
+		}
+		if( idMatch32( found.itemId, itemId ) )
+		{
+			return true;
+		}
+		slot = (slot + 1) & (COC_INDEX.head.headSlots - 1);
+	}
+	memset( &found, 0, sizeof(IndexHead) );
+	return false;
+}
+
+/**
+ * @dev Double the heads table once it is half full
+ */
+bool indexGrowHeads()
+{
+	vector<IndexHead> heads( COC_INDEX.head.headSlots );
+	if( !preadFull( COC_INDEX.headFd, &heads[0], heads.size() * sizeof(IndexHead), 0 ) )
+	{
+		return false;
+	}
+	uint64_t slots = COC_INDEX.head.headSlots * 2;
+	vector<IndexHead> grown( slots );
+	memset( &grown[0], 0, slots * sizeof(IndexHead) );
+	for( size_t i = 0; i < heads.size(); i++ )
+	{
+		if( 0 != heads[i].first )
+		{
+			uint64_t slot = indexSlotOf( heads[i].itemId, slots );
+			while( 0 != grown[slot].first )
+			{
+				slot = (slot + 1) & (slots - 1);
+			}
+			grown[slot] = heads[i];
+		}
+	}
+	if( (size_t)pwrite( COC_INDEX.headFd, &grown[0], slots * sizeof(IndexHead), 0 ) != slots * sizeof(IndexHead) )
+	{
+		return false;
+	}
+	COC_INDEX.head.headSlots = slots;
+	return true;
+}
+
+/**
+ * @dev Start an empty index (both files are truncated)
+ */
+void indexReset()
+{
+	memset( &COC_INDEX.head, 0, sizeof(IndexHeader) );
+	memcpy( COC_INDEX.head.magic, "BCHOCIDX", 8 );
+	COC_INDEX.head.headSlots = INDEX_MIN_SLOTS;
+	ftruncate( COC_INDEX.fd, sizeof(IndexHeader) );
+	ftruncate( COC_INDEX.headFd, 0 );
+	ftruncate( COC_INDEX.headFd, INDEX_MIN_SLOTS * sizeof(IndexHead) );
+}
+
+/**
+ * @dev Add the next block to the index and link it to its item's head
+ */
+bool indexAdd( uint64_t blockHead, const unsigned char* itemId )
+{
+	uint64_t blockNumber = COC_INDEX.head.blockCount;
+	IndexEntry entry;
+	entry.offset = blockHead;
+	entry.prevSameItem = 0;
+	//the INITIAL block carries no evidence item
+	if( 0 != blockHead )
+	{
+		if( (COC_INDEX.head.headUsed + 1) * 2 > COC_INDEX.head.headSlots )
+		{
+			if( !indexGrowHeads() )
+			{
+				return false;
+			}
+		}
+		IndexHead found;
+		uint64_t slot = 0;
+		if( indexFindHead( itemId, found, slot ) )
+		{
+			entry.prevSameItem = found.latest;
+		}
+		else
+		{
+			memcpy( found.itemId, itemId, BLOCK_ITEM_ID_SIZE );
+			found.first = blockNumber + 1;
+			COC_INDEX.head.headUsed++;
+		}
+		found.latest = blockNumber + 1;
+		if( sizeof(IndexHead) != pwrite( COC_INDEX.headFd, &found, sizeof(IndexHead), slot * sizeof(IndexHead) ) )
+		{
+			return false;
+		}
+	}
+	if( sizeof(IndexEntry) != pwrite( COC_INDEX.fd, &entry, sizeof(IndexEntry), sizeof(IndexHeader) + blockNumber * sizeof(IndexEntry) ) )
+	{
+		return false;
+	}
+	COC_INDEX.head.blockCount++;
+	return true;
+}
+
+/**
+ * @dev Size of an open file in bytes (0 if it cannot be read)
+ */
+uint64_t descriptorSize( int fd )
+{
+	struct stat info;
+	if( 0 != fstat( fd, &info ) )
+	{
+		return 0;
+	}
+	return info.st_size;
+}
+
+/**
+ * @dev Move the index into anonymous in-memory files, so a read-only command
+ *		can build or extend it without writing next to the chain
+ * @param keep copies what the index files already hold
+ * @return false if the in-memory files could not be made
+ */
+bool indexMoveToMemory( bool keep )
+{
+	int fds[2] = { COC_INDEX.fd, COC_INDEX.headFd };
+	int memFds[2] = { memfd_create( "bchoc.idx", 0 ), memfd_create( "bchoc.idx.heads", 0 ) };
+	bool moved = (memFds[0] >= 0) && (memFds[1] >= 0);
+	for( int i = 0; i < 2; i++ )
+	{
+		if( moved && keep && (fds[i] >= 0) )
+		{
+			vector<unsigned char> contents( descriptorSize( fds[i] ) );
+			moved = (0 == contents.size()) ||
+					(preadFull( fds[i], &contents[0], contents.size(), 0 ) && writeFull( memFds[i], &contents[0], contents.size() ));
+		}
+	}
+	for( int i = 0; i < 2; i++ )
+	{
+		if( fds[i] >= 0 )
+		{
+			close( fds[i] );
+		}
+		if( !moved && (memFds[i] >= 0) )
+		{
+			close( memFds[i] );
+		}
+	}
+	COC_INDEX.fd = moved ? memFds[0] : -1;
+	COC_INDEX.headFd = moved ? memFds[1] : -1;
+	COC_INDEX.inMemory = moved;
+	return moved;
+}
+
+/**
+ * @dev Bring the item index up to date with the chain, rebuilding it if it no
+ *		longer matches (missing, damaged, or written against another chain).
+ *		Under COC_READ_ONLY the files are only read; a missing or stale index
+ *		is built in memory instead.
+ * @return false if the index could not be opened
+ */
+bool itemIndexSync()
+{
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		return false;
+	}
+	if( COC_INDEX.fd < 0 )
+	{
+		string indexFile = COC_FILE + ".idx";
+		string headsFile = COC_FILE + ".idx.heads";
+		int flags = COC_READ_ONLY ? O_RDONLY : (O_RDWR | O_CREAT);
+		COC_INDEX.fd = open( indexFile.c_str(), flags, 0644 );
+		COC_INDEX.headFd = open( headsFile.c_str(), flags, 0644 );
+		COC_INDEX.checked = false;
+		COC_INDEX.inMemory = false;
+		if( ((COC_INDEX.fd < 0) || (COC_INDEX.headFd < 0)) && !(COC_READ_ONLY && indexMoveToMemory( false )) )
+		{
+			if( COC_INDEX.fd >= 0 )
+			{
+				close( COC_INDEX.fd );
+			}
+			if( COC_INDEX.headFd >= 0 )
+			{
+				close( COC_INDEX.headFd );
+			}
+			COC_INDEX.fd = -1;
+			COC_INDEX.headFd = -1;
+			chainClose( chain );
+			return false;
+		}
+	}
+	if( !COC_INDEX.checked )
+	{
+		//the header, both file sizes and the last entry must all agree with the chain
+		bool valid = preadFull( COC_INDEX.fd, &COC_INDEX.head, sizeof(IndexHeader), 0 ) &&
+					(0 == memcmp( COC_INDEX.head.magic, "BCHOCIDX", 8 )) &&
+					(COC_INDEX.head.headSlots >= INDEX_MIN_SLOTS) &&
+					(0 == (COC_INDEX.head.headSlots & (COC_INDEX.head.headSlots - 1))) &&
+					(descriptorSize( COC_INDEX.fd ) >= sizeof(IndexHeader) + COC_INDEX.head.blockCount * sizeof(IndexEntry)) &&
+					(descriptorSize( COC_INDEX.headFd ) == COC_INDEX.head.headSlots * sizeof(IndexHead)) &&
+					(COC_INDEX.head.chainEnd <= chainSize( chain ));
+		if( valid && (COC_INDEX.head.blockCount > 0) )
+		{
+			//the last entry must point at a whole block ending where the index does
+			IndexEntry last;
+			unsigned char header[BLOCK_MIN_SIZE];
+			valid = preadFull( COC_INDEX.fd, &last, sizeof(IndexEntry), sizeof(IndexHeader) + (COC_INDEX.head.blockCount - 1) * sizeof(IndexEntry) ) &&
+					(last.offset == COC_INDEX.head.lastBlock);
+			if( valid )
+			{
+				chainSeek( chain, last.offset );
+				valid = (BLOCK_MIN_SIZE == chainRead( chain, header, BLOCK_MIN_SIZE )) &&
+						(last.offset + BlockView( header ).size() == COC_INDEX.head.chainEnd);
+			}
+			if( valid && (0 != last.offset) )
+			{
+				IndexHead found;
+				uint64_t slot = 0;
+				valid = indexFindHead( BlockView( header ).itemId(), found, slot ) &&
+						(found.latest == COC_INDEX.head.blockCount);
+			}
+		}
+		if( !valid && COC_READ_ONLY && !COC_INDEX.inMemory && !indexMoveToMemory( false ) )
+		{
+			chainClose( chain );
+			return false;
+		}
+		if( !valid )
+		{
+			indexReset();
+		}
+		COC_INDEX.checked = true;
+	}
+	
+	//add an entry for every complete block after the covered part of the chain
+	bool grew = false;
+	chainSeek( chain, COC_INDEX.head.chainEnd );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		unsigned char header[BLOCK_MIN_SIZE];
+		chainRead( chain, header, BLOCK_MIN_SIZE );
+		BlockView block( header );
+		if( (blockHead + block.size()) > chainSize(chain) )
+		{
+			break;
+		}
+		//a read-only command extends its own copy of the index
+		if( COC_READ_ONLY && !COC_INDEX.inMemory && !indexMoveToMemory( true ) )
+		{
+			break;
+		}
+		if( !indexAdd( blockHead, block.itemId() ) )
+		{
+			break;
+		}
+		chainSkip( chain, block.dataLen );
+		COC_INDEX.head.chainEnd = chainTell( chain );
+		COC_INDEX.head.lastBlock = blockHead;
+		grew = true;
+	}
+	chainClose( chain );
+	if( grew )
+	{
+		pwrite( COC_INDEX.fd, &COC_INDEX.head, sizeof(IndexHeader), 0 );
+	}
+	return true;
+}
+
+/**
+ * @dev Collect the offsets of an item's blocks, newest first
+ * @param limit stops after this many blocks (0 = all of them)
+ * @return false if the index is not available
+ */
+bool itemIndexHistory( const unsigned char* itemId, uint64_t limit, vector<uint64_t> &offsets )
+{
+	offsets.clear();
+	if( !itemIndexSync() )
+	{
+		return false;
+	}
+	IndexHead found;
+	uint64_t slot = 0;
+	if( !indexFindHead( itemId, found, slot ) )
+	{
+		return true;
+	}
+	uint64_t next = found.latest;
+	while( (0 != next) && (next <= COC_INDEX.head.blockCount) && ((0 == limit) || (offsets.size() < limit)) )
+	{
+		IndexEntry entry;
+		if( !preadFull( COC_INDEX.fd, &entry, sizeof(IndexEntry), sizeof(IndexHeader) + (next - 1) * sizeof(IndexEntry) ) ||
+			(entry.prevSameItem >= next) )
+		{
+			//a back-pointer must always move towards the start of the chain
+			return false;
+		}
+		offsets.push_back( entry.offset );
+		next = entry.prevSameItem;
+	}
+	return true;
+}
+
+/**
+ * @dev Read the index entry of a block
+ */
+bool itemIndexEntry( uint64_t blockNumber, IndexEntry &entry )
+{
+	return (blockNumber < COC_INDEX.head.blockCount) &&
+			preadFull( COC_INDEX.fd, &entry, sizeof(IndexEntry), sizeof(IndexHeader) + blockNumber * sizeof(IndexEntry) );
+}
+
+/**
+ * @dev Offset of an item's first block
+ * @return false if the item has no block
+ */
+bool itemIndexFirstBlock( const unsigned char* itemId, uint64_t &offset )
+{
+	IndexHead found;
+	uint64_t slot = 0;
+	IndexEntry entry;
+	if( !itemIndexSync() || !indexFindHead( itemId, found, slot ) || !itemIndexEntry( found.first - 1, entry ) )
+	{
+		return false;
+	}
+	offset = entry.offset;
+	return true;
+}
+
+/**
+ * @dev Binary search the index for the first block starting at or after "offset"
+ * @return the block number (the block count if every block starts before it)
+ */
+uint64_t itemIndexLowerBound( uint64_t offset )
+{
+	uint64_t low = 0;
+	uint64_t high = COC_INDEX.head.blockCount;
+	while( low < high )
+	{
+		uint64_t mid = low + (high - low) / 2;
+		IndexEntry entry;
+		if( itemIndexEntry( mid, entry ) && (entry.offset < offset) )
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+/**
+ * @dev Check that an offset is the start of a block, or the end of the chain
+ */
+bool itemIndexIsBlockStart( uint64_t offset )
+{
+	if( !itemIndexSync() )
+	{
+		return false;
+	}
+	if( offset == COC_INDEX.head.chainEnd )
+	{
+		return true;
+	}
+	IndexEntry entry;
+	return itemIndexEntry( itemIndexLowerBound( offset ), entry ) && (entry.offset == offset);
+}
+
+/*
+ * =============
+ * Materialized chain state & snapshots
+ * =============
+ * ChainState is everything the commands derive by replaying the chain: the
+ * latest state of every item, the cases (and their items) in the order they
+ * first appear, the hash/offset of the last block, the last timestamp and the
+ * set of parent hashes seen so far. "bchoc snapshot" writes it to "<chain>.snap";
+ * commands then load the snapshot and replay only the blocks appended after it.
+ * A snapshot that no longer matches the chain is ignored and replaced by a
+ * replay from the first block.
+ */
+struct ItemState
+{
+	unsigned char caseId[BLOCK_CASE_ID_SIZE];
+	unsigned char creator[BLOCK_CREATOR_SIZE];
+	unsigned char owner[BLOCK_OWNER_SIZE];
+	unsigned char state[BLOCK_STATE_SIZE];	//raw State field of the latest block
+	int32_t stateCode;						//latest recognized evidenceState (-1 if none)
+	uint32_t reserved;
+	uint64_t lastBlock;						//logical offset of the item's latest block
+	uint64_t lastTime;
+};
+
+struct ChainState
+{
+	uint64_t chainEnd;		//logical offset just past the last applied block
+	uint64_t tipBlock;		//logical offset of the last applied block
+	string tipHash;			//hash of the last applied block (all 0s for an empty chain)
+	uint64_t lastTime;
+	uint64_t blockCount;
+	bool corrupt;			//some block does not link to its parent
+	bool loaded;			//state has been read from the snapshot/replayed at least once
+	bool trackParents;		//keep the parent digest set (only needed by snapshot/verify)
+	bool trackTouched;		//list the items each applied block changes (only needed by serve)
+	bool allTouched;		//reset since "touched" was last drained, so every item may have changed
+	vector<string> touched;	//Item IDs changed since "touched" was last drained
+	unordered_map<string, ItemState> items;
+	vector<string> caseOrder;
+	unordered_map<string, vector<string> > caseItems;
+	unordered_set<string> caseItemSeen;
+	unordered_set<uint64_t> parentDigests;	//first 8 bytes of every Previous Hash seen
+};
+ChainState COC_STATE;
+
+/**
+ * @dev Forget everything, ready to replay from the first block
+ */
+void chainStateReset( ChainState &state )
+{
+	state.chainEnd = 0;
+	state.tipBlock = 0;
+	state.tipHash = string( BLOCK_PREV_HASH_SIZE, '\0' );
+	state.lastTime = 0;
+	state.blockCount = 0;
+	state.corrupt = false;
+	state.items.clear();
+	state.caseOrder.clear();
+	state.caseItems.clear();
+	state.caseItemSeen.clear();
+	state.parentDigests.clear();
+	state.touched.clear();
+	state.allTouched = true;
+}
+
+/**
+ * @dev Fold one block into the state
+ * @param header points to the first BLOCK_MIN_SIZE bytes of the block
+ * @param blockHead is the logical offset of the block
+ * @param blockEnd is the logical offset just past the block
+ * @param blockHash is the hash of the complete block
+ */
+void chainStateApply( ChainState &state, const BlockView &block, uint64_t blockHead, uint64_t blockEnd, const string &blockHash )
+{
+	if( state.trackParents )
+	{
+		uint64_t digest = 0;
+		memcpy( &digest, block.prevHash(), sizeof(digest) );
+		state.parentDigests.insert( digest );
+	}
+	//the INITIAL block carries no evidence item
+	if( 0 != blockHead )
+	{
+		string caseKey( (const char*)block.caseId(), BLOCK_CASE_ID_SIZE );
+		string itemKey( (const char*)block.itemId(), BLOCK_ITEM_ID_SIZE );
+		unordered_map<string, ItemState>::iterator found = state.items.find( itemKey );
+		if( found == state.items.end() )
+		{
+			ItemState fresh;
+			memset( &fresh, 0, sizeof(ItemState) );
+			fresh.stateCode = -1;
+			found = state.items.insert( make_pair( itemKey, fresh ) ).first;
+		}
+		ItemState &item = found->second;
+		memcpy( item.caseId, block.caseId(), BLOCK_CASE_ID_SIZE );
+		memcpy( item.creator, block.creator(), BLOCK_CREATOR_SIZE );
+		memcpy( item.owner, block.owner(), BLOCK_OWNER_SIZE );
+		memcpy( item.state, block.stateField(), BLOCK_STATE_SIZE );
+		if( (CHECKEDIN <= block.state) && (RELEASED >= block.state) )
+		{
+			item.stateCode = block.state;
+		}
+		item.lastBlock = blockHead;
+		item.lastTime = block.time;
+		//cases and the items under them, in the order they first appear
+		if( 0 == state.caseItems.count( caseKey ) )
+		{
+			state.caseOrder.push_back( caseKey );
+		}
+		if( state.caseItemSeen.insert( caseKey + itemKey ).second )
+		{
+			state.caseItems[caseKey].push_back( itemKey );
+		}
+		if( state.trackTouched )
+		{
+			state.touched.push_back( itemKey );
+		}
+	}
+	state.tipBlock = blockHead;
+	state.chainEnd = blockEnd;
+	state.tipHash = blockHash;
+	state.lastTime = block.time;
+	state.blockCount++;
+}
+
+/**
+ * @dev Replay every complete block after state.chainEnd. A block whose Previous
+ *		Hash does not match its parent marks the state as corrupt.
+ */
+void chainStateReplay( ChainState &state, ChainFile &chain )
+{
+	vector<unsigned char> wholeBlock;
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	chainSeek( chain, state.chainEnd );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			//incomplete block at the end of the chain
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		if( 0 != memcmp( block.prevHash(), state.tipHash.data(), BLOCK_PREV_HASH_SIZE ) )
+		{
+			//keep going so listings still see every block, but remember it
+			state.corrupt = true;
+		}
+		hashBlock( block.raw, block.size(), blockHash );
+		chainStateApply( state, block, blockHead, chainTell(chain), string( (const char*)blockHash, BLOCK_PREV_HASH_SIZE ) );
+	}
+}
+
+/**
+ * @dev Append a plain value to a snapshot buffer
+ */
+template <typename T>
+void snapPut( string &out, const T &value )
+{
+	out.append( (const char*)&value, sizeof(T) );
+}
+
+/**
+ * @dev Read a plain value from a snapshot buffer (false when out of data)
+ */
+template <typename T>
+bool snapGet( const string &in, size_t &pos, T &value )
+{
+	if( (pos + sizeof(T)) > in.size() )
+	{
+		return false;
+	}
+	memcpy( &value, &in[pos], sizeof(T) );
+	pos += sizeof(T);
+	return true;
+}
+
+/**
+ * @dev Serialize a state into the snapshot format
+ *	header:	"BCHOCSNP" | chainEnd | tipBlock | tipHash[32] | lastTime | blockCount
+ *			| item count | case count | parent count (when tracked, else 0)
+ *	items:	Item ID[32] | ItemState
+ *	cases:	Case ID[32] | item count | Item IDs[32] ...
+ *	parents: 8 byte digests (kept last so they can be left unread)
+ */
+void chainStateSerialize( ChainState &state, string &out )
+{
+	out.clear();
+	out.append( "BCHOCSNP", 8 );
+	snapPut( out, state.chainEnd );
+	snapPut( out, state.tipBlock );
+	out.append( state.tipHash );
+	snapPut( out, state.lastTime );
+	snapPut( out, state.blockCount );
+	snapPut( out, (uint64_t)state.items.size() );
+	snapPut( out, (uint64_t)state.caseOrder.size() );
+	snapPut( out, (uint64_t)(state.trackParents ? state.parentDigests.size() : 0) );
+	for( unordered_map<string, ItemState>::iterator it = state.items.begin(); it != state.items.end(); ++it )
+	{
+		out.append( it->first );
+		snapPut( out, it->second );
+	}
+	for( size_t i = 0; i < state.caseOrder.size(); i++ )
+	{
+		vector<string> &caseItemList = state.caseItems[state.caseOrder[i]];
+		out.append( state.caseOrder[i] );
+		snapPut( out, (uint64_t)caseItemList.size() );
+		for( size_t j = 0; j < caseItemList.size(); j++ )
+		{
+			out.append( caseItemList[j] );
+		}
+	}
+	if( state.trackParents )
+	{
+		for( unordered_set<uint64_t>::iterator it = state.parentDigests.begin(); it != state.parentDigests.end(); ++it )
+		{
+			snapPut( out, *it );
+		}
+	}
+}
+
+/**
+ * @dev Rebuild a state from the snapshot format
+ * @return false if the buffer is not a complete snapshot
+ */
+bool chainStateDeserialize( ChainState &state, const string &in )
+{
+	chainStateReset( state );
+	size_t pos = 8;
+	uint64_t itemCount = 0;
+	uint64_t caseCount = 0;
+	uint64_t parentCount = 0;
+	if( (in.size() < 8) || (0 != in.compare( 0, 8, "BCHOCSNP" )) ||
+		!snapGet( in, pos, state.chainEnd ) || !snapGet( in, pos, state.tipBlock ) ||
+		((pos + BLOCK_PREV_HASH_SIZE) > in.size()) )
+	{
+		return false;
+	}
+	state.tipHash = in.substr( pos, BLOCK_PREV_HASH_SIZE );
+	pos += BLOCK_PREV_HASH_SIZE;
+	if( !snapGet( in, pos, state.lastTime ) || !snapGet( in, pos, state.blockCount ) ||
+		!snapGet( in, pos, itemCount ) || !snapGet( in, pos, caseCount ) || !snapGet( in, pos, parentCount ) )
+	{
+		return false;
+	}
+	for( uint64_t i = 0; i < itemCount; i++ )
+	{
+		ItemState item;
+		if( (pos + BLOCK_ITEM_ID_SIZE) > in.size() )
+		{
+			return false;
+		}
+		string itemKey = in.substr( pos, BLOCK_ITEM_ID_SIZE );
+		pos += BLOCK_ITEM_ID_SIZE;
+		if( !snapGet( in, pos, item ) )
+		{
+			return false;
+		}
+		state.items[itemKey] = item;
+	}
+	for( uint64_t i = 0; i < caseCount; i++ )
+	{
+		uint64_t caseItemCount = 0;
+		if( (pos + BLOCK_CASE_ID_SIZE) > in.size() )
+		{
+			return false;
+		}
+		string caseKey = in.substr( pos, BLOCK_CASE_ID_SIZE );
+		pos += BLOCK_CASE_ID_SIZE;
+		if( !snapGet( in, pos, caseItemCount ) || ((pos + caseItemCount * BLOCK_ITEM_ID_SIZE) > in.size()) )
+		{
+			return false;
+		}
+		state.caseOrder.push_back( caseKey );
+		vector<string> &caseItemList = state.caseItems[caseKey];
+		for( uint64_t j = 0; j < caseItemCount; j++ )
+		{
+			caseItemList.push_back( in.substr( pos, BLOCK_ITEM_ID_SIZE ) );
+			state.caseItemSeen.insert( caseKey + caseItemList.back() );
+			pos += BLOCK_ITEM_ID_SIZE;
+		}
+	}
+	if( state.trackParents )
+	{
+		//a snapshot without the parent set cannot seed a state that needs it
+		if( (0 == parentCount) && (state.blockCount > 0) )
+		{
+			return false;
+		}
+		for( uint64_t i = 0; i < parentCount; i++ )
+		{
+			uint64_t digest = 0;
+			if( !snapGet( in, pos, digest ) )
+			{
+				return false;
+			}
+			state.parentDigests.insert( digest );
+		}
+	}
+	return true;
+}
+
+/**
+ * @dev Check that a state describes a prefix of the chain: the block it ends
+ *		with must still be there and still hash to the recorded tip hash
+ */
+bool chainStateMatches( ChainState &state, ChainFile &chain )
+{
+	if( state.chainEnd > chainSize( chain ) )
+	{
+		return false;
+	}
+	if( 0 == state.blockCount )
+	{
+		return (0 == state.chainEnd);
+	}
+	string lastBlock( state.chainEnd - state.tipBlock, '\0' );
+	chainSeek( chain, state.tipBlock );
+	return (lastBlock.size() == chainRead( chain, &lastBlock[0], lastBlock.size() )) &&
+			(0 == computeHash( lastBlock ).compare( state.tipHash ));
+}
+
+/**
+ * @dev Bring a state up to date with the chain. The first call loads the
+ *		snapshot (if it still matches the chain); every call replays the
+ *		blocks appended since the previous one.
+ * @return false if the chain does not exist
+ */
+bool chainStateSync( ChainState &state )
+{
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		return false;
+	}
+	if( !state.loaded )
+	{
+		bool fromSnapshot = false;
+		ifstream snapFile( (COC_FILE + ".snap").c_str(), std::ios::binary );
+		if( snapFile )
+		{
+			stringstream contents;
+			contents << snapFile.rdbuf();
+			fromSnapshot = chainStateDeserialize( state, contents.str() ) && chainStateMatches( state, chain );
+		}
+		if( !fromSnapshot )
+		{
+			chainStateReset( state );
+		}
+		state.loaded = true;
+	}
+	else if( !chainStateMatches( state, chain ) )
+	{
+		//the chain was replaced underneath us, start over
+		chainStateReset( state );
+	}
+	chainStateReplay( state, chain );
+	chainClose( chain );
+	return true;
+}
+
+/**
+ * @dev Atomically replace a file with new contents
+ */
+bool writeFileAtomic( string path, const string &contents )
+{
+	string tmpFile = path + ".tmp";
+	int fd = open( tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 )
+	{
+		return false;
+	}
+	size_t written = 0;
+	while( written < contents.size() )
+	{
+		ssize_t put = write( fd, contents.data() + written, contents.size() - written );
+		if( put <= 0 )
+		{
+			close( fd );
+			unlink( tmpFile.c_str() );
+			return false;
+		}
+		written += put;
+	}
+	fsync( fd );
+	close( fd );
+	if( 0 != rename( tmpFile.c_str(), path.c_str() ) )
+	{
+		return false;
+	}
+	syncParentFolder( path );
+	return true;
+}
+
+/*
+ * =============
+ * State checkpoints
+ * =============
+ * "<chain>.ckpt.data" holds the chain state (in the snapshot format) as it
+ * stood at regular points along the chain, and "<chain>.ckpt" is a directory
+ * of fixed size records locating each one. Because block timestamps only ever
+ * increase, the directory is sorted by time as well as by position, so the
+ * state at any moment is the nearest checkpoint before it (found by binary
+ * search) plus at most BCHOC_CHECKPOINT_BLOCKS (default 4096) blocks after
+ * it. Every checkpoint is a full state, so a smaller interval answers faster
+ * at the cost of a larger file. Both files are only a cache: they are
+ * extended when as-of queries run and rebuilt if they no longer match the chain.
+ */
+const uint64_t CHECKPOINT_DEFAULT_BLOCKS = 4096;
+
+struct CheckpointRecord
+{
+	uint64_t blockCount;			//blocks applied to the state
+	uint64_t chainEnd;				//logical offset just past the last applied block
+	uint64_t tipBlock;				//logical offset of the last applied block
+	uint64_t lastTime;				//timestamp of the last applied block
+	uint64_t dataOffset;			//where the serialized state starts in "<chain>.ckpt.data"
+	uint64_t dataLength;
+	unsigned char tipHash[BLOCK_PREV_HASH_SIZE];
+};
+static_assert( sizeof(CheckpointRecord) == 80, "CheckpointRecord is written to disk as-is" );
+
+/**
+ * @dev Read the checkpoint directory, discarding it if its last checkpoint is
+ *		not part of the chain any more
+ */
+void checkpointLoad( vector<CheckpointRecord> &dir, ChainFile &chain )
+{
+	dir.clear();
+	string dirFile = COC_FILE + ".ckpt";
+	string dataFile = COC_FILE + ".ckpt.data";
+	uint64_t count = fileSize( dirFile ) / sizeof(CheckpointRecord);
+	int fd = open( dirFile.c_str(), O_RDONLY );
+	if( (fd >= 0) && (count > 0) )
+	{
+		dir.resize( count );
+		if( !preadFull( fd, &dir[0], count * sizeof(CheckpointRecord), 0 ) )
+		{
+			dir.clear();
+		}
+	}
+	if( fd >= 0 )
+	{
+		close( fd );
+	}
+	if( dir.size() > 0 )
+	{
+		CheckpointRecord &last = dir.back();
+		ChainState probe;
+		probe.chainEnd = last.chainEnd;
+		probe.tipBlock = last.tipBlock;
+		probe.tipHash = string( (const char*)last.tipHash, BLOCK_PREV_HASH_SIZE );
+		probe.blockCount = last.blockCount;
+		if( (fileSize( dataFile ) < last.dataOffset + last.dataLength) || !chainStateMatches( probe, chain ) )
+		{
+			dir.clear();
+		}
+	}
+	if( (0 == dir.size()) && !COC_READ_ONLY )
+	{
+		unlink( dirFile.c_str() );
+		unlink( dataFile.c_str() );
+	}
+}
+
+/**
+ * @dev Load the state saved by a checkpoint
+ */
+bool checkpointRead( const CheckpointRecord &record, ChainState &state )
+{
+	string dataFile = COC_FILE + ".ckpt.data";
+	string contents( record.dataLength, '\0' );
+	int fd = open( dataFile.c_str(), O_RDONLY );
+	if( fd < 0 )
+	{
+		return false;
+	}
+	bool loaded = preadFull( fd, &contents[0], contents.size(), record.dataOffset );
+	close( fd );
+	state.trackParents = false;
+	return loaded && chainStateDeserialize( state, contents );
+}
+
+/**
+ * @dev Save "state" as the next checkpoint
+ */
+bool checkpointWrite( vector<CheckpointRecord> &dir, ChainState &state )
+{
+	string contents;
+	chainStateSerialize( state, contents );
+	CheckpointRecord record;
+	memset( &record, 0, sizeof(CheckpointRecord) );
+	record.blockCount = state.blockCount;
+	record.chainEnd = state.chainEnd;
+	record.tipBlock = state.tipBlock;
+	record.lastTime = state.lastTime;
+	record.dataOffset = (0 == dir.size()) ? 0 : (dir.back().dataOffset + dir.back().dataLength);
+	record.dataLength = contents.size();
+	memcpy( record.tipHash, state.tipHash.data(), BLOCK_PREV_HASH_SIZE );
+	
+	//the state goes first so the directory never names a checkpoint that was not written
+	string dataFile = COC_FILE + ".ckpt.data";
+	string dirFile = COC_FILE + ".ckpt";
+	int dataFd = open( dataFile.c_str(), O_WRONLY | O_CREAT, 0644 );
+	int dirFd = open( dirFile.c_str(), O_WRONLY | O_CREAT, 0644 );
+	bool written = (dataFd >= 0) && (dirFd >= 0) &&
+					((ssize_t)contents.size() == pwrite( dataFd, contents.data(), contents.size(), record.dataOffset )) &&
+					((ssize_t)sizeof(CheckpointRecord) == pwrite( dirFd, &record, sizeof(CheckpointRecord), dir.size() * sizeof(CheckpointRecord) ));
+	if( dataFd >= 0 )
+	{
+		close( dataFd );
+	}
+	if( dirFd >= 0 )
+	{
+		close( dirFd );
+	}
+	if( written )
+	{
+		dir.push_back( record );
+	}
+	return written;
+}
+
+/**
+ * @dev Bring the checkpoints up to date, taking any that are due
+ * @return false if the chain does not exist
+ */
+bool checkpointSync( vector<CheckpointRecord> &dir )
+{
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		return false;
+	}
+	checkpointLoad( dir, chain );
+	if( COC_READ_ONLY )
+	{
+		//use the checkpoints already taken, without taking new ones
+		chainClose( chain );
+		return true;
+	}
+	ChainState state;
+	state.trackParents = false;
+	state.trackTouched = false;
+	chainStateReset( state );
+	if( (dir.size() > 0) && !checkpointRead( dir.back(), state ) )
+	{
+		dir.clear();
+		chainStateReset( state );
+	}
+	uint64_t lastCheckpoint = state.blockCount;
+	uint64_t interval = CHECKPOINT_DEFAULT_BLOCKS;
+	if( (NULL != getenv("BCHOC_CHECKPOINT_BLOCKS")) && (strtoull( getenv("BCHOC_CHECKPOINT_BLOCKS"), NULL, 10 ) > 0) )
+	{
+		interval = strtoull( getenv("BCHOC_CHECKPOINT_BLOCKS"), NULL, 10 );
+	}
+	vector<unsigned char> wholeBlock;
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	chainSeek( chain, state.chainEnd );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		hashBlock( block.raw, block.size(), blockHash );
+		chainStateApply( state, block, blockHead, chainTell(chain), string( (const char*)blockHash, BLOCK_PREV_HASH_SIZE ) );
+		if( (state.blockCount - lastCheckpoint) >= interval )
+		{
+			if( !checkpointWrite( dir, state ) )
+			{
+				break;
+			}
+			lastCheckpoint = state.blockCount;
+		}
+	}
+	chainClose( chain );
+	return true;
+}
+
+/**
+ * @dev Rebuild the chain state as it stood at a moment in time: the nearest
+ *		checkpoint at or before "asOf" plus the blocks after it up to "asOf"
+ * @param before (UINT64_MAX for none) also stops the state at the block
+ *		starting at this offset
+ * @return false if the chain does not exist
+ */
+bool chainStateAsOf( uint64_t asOf, ChainState &state, uint64_t before )
+{
+	vector<CheckpointRecord> dir;
+	if( !checkpointSync( dir ) )
+	{
+		return false;
+	}
+	//binary search for the last checkpoint taken at or before the target time
+	size_t low = 0;
+	size_t high = dir.size();
+	while( low < high )
+	{
+		size_t mid = low + (high - low) / 2;
+		if( (dir[mid].lastTime <= asOf) && (dir[mid].chainEnd <= before) )
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	state.trackParents = false;
+	state.trackTouched = false;
+	chainStateReset( state );
+	if( (low > 0) && !checkpointRead( dir[low - 1], state ) )
+	{
+		chainStateReset( state );
+	}
+	//replay the blocks after the checkpoint until the target time (or offset)
+	ChainFile chain;
+	chainOpen( chain );
+	vector<unsigned char> wholeBlock;
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	chainSeek( chain, state.chainEnd );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		if( (block.time > asOf) || (blockHead >= before) )
+		{
+			break;
+		}
+		hashBlock( block.raw, block.size(), blockHash );
+		chainStateApply( state, block, blockHead, chainTell(chain), string( (const char*)blockHash, BLOCK_PREV_HASH_SIZE ) );
+	}
+	chainClose( chain );
+	return true;
+}
+
+/*
+ * =============
+ * Custody index
+ * =============
+ * "<chain>.custody" lists every item that is currently CHECKEDOUT, with its
+ * owner, case and the time it was checked out. An item is held exactly when
+ * its latest block is CHECKEDOUT, so the index is brought up to date by
+ * folding in only the blocks appended after it. checkout, checkin and remove
+ * do that right after their append. When the file no longer matches the chain
+ * it is rebuilt from the materialized chain state.
+ *	header:	"BCHOCCUS" | chainEnd | tipBlock | tipHash[32] | blockCount | record count
+ *	records: Item ID[32] | CustodyRecord
+ */
+struct CustodyRecord
+{
+	unsigned char owner[BLOCK_OWNER_SIZE];
+	unsigned char caseId[BLOCK_CASE_ID_SIZE];
+	uint32_t reserved;
+	uint64_t since;						//time of the checkout
+};
+
+struct CustodyIndex
+{
+	ChainState tip;						//only chainEnd/tipBlock/tipHash/blockCount are used
+	map<string, CustodyRecord> held;	//Item ID -> who holds it
+	bool loaded;
+};
+CustodyIndex COC_CUSTODY;
+
+/**
+ * @dev Fold one block into the custody index
+ */
+void custodyApply( CustodyIndex &custody, const BlockView &block, uint64_t blockHead )
+{
+	//the INITIAL block and unrecognized states do not change custody
+	if( (0 == blockHead) || (block.state < CHECKEDIN) || (block.state > RELEASED) )
+	{
+		return;
+	}
+	string itemKey( (const char*)block.itemId(), BLOCK_ITEM_ID_SIZE );
+	if( CHECKEDOUT == block.state )
+	{
+		CustodyRecord record;
+		memset( &record, 0, sizeof(CustodyRecord) );
+		memcpy( record.owner, block.owner(), BLOCK_OWNER_SIZE );
+		memcpy( record.caseId, block.caseId(), BLOCK_CASE_ID_SIZE );
+		record.since = block.time;
+		custody.held[itemKey] = record;
+	}
+	else
+	{
+		custody.held.erase( itemKey );
+	}
+}
+
+/**
+ * @dev Rebuild a custody index from the materialized chain state
+ */
+void custodyFromState( CustodyIndex &custody, ChainState &state )
+{
+	custody.held.clear();
+	custody.tip.chainEnd = state.chainEnd;
+	custody.tip.tipBlock = state.tipBlock;
+	custody.tip.tipHash = state.tipHash;
+	custody.tip.blockCount = state.blockCount;
+	for( unordered_map<string, ItemState>::iterator it = state.items.begin(); it != state.items.end(); ++it )
+	{
+		if( CHECKEDOUT == it->second.stateCode )
+		{
+			CustodyRecord record;
+			memset( &record, 0, sizeof(CustodyRecord) );
+			memcpy( record.owner, it->second.owner, BLOCK_OWNER_SIZE );
+			memcpy( record.caseId, it->second.caseId, BLOCK_CASE_ID_SIZE );
+			record.since = it->second.lastTime;
+			custody.held[it->first] = record;
+		}
+	}
+}
+
+void custodySerialize( CustodyIndex &custody, string &out )
+{
+	out.clear();
+	out.append( "BCHOCCUS", 8 );
+	snapPut( out, custody.tip.chainEnd );
+	snapPut( out, custody.tip.tipBlock );
+	out.append( custody.tip.tipHash );
+	snapPut( out, custody.tip.blockCount );
+	snapPut( out, (uint64_t)custody.held.size() );
+	for( map<string, CustodyRecord>::iterator it = custody.held.begin(); it != custody.held.end(); ++it )
+	{
+		out.append( it->first );
+		snapPut( out, it->second );
+	}
+}
+
+bool custodyDeserialize( CustodyIndex &custody, const string &in )
+{
+	custody.held.clear();
+	chainStateReset( custody.tip );
+	size_t pos = 8;
+	uint64_t recordCount = 0;
+	if( (in.size() < 8) || (0 != in.compare( 0, 8, "BCHOCCUS" )) ||
+		!snapGet( in, pos, custody.tip.chainEnd ) || !snapGet( in, pos, custody.tip.tipBlock ) ||
+		((pos + BLOCK_PREV_HASH_SIZE) > in.size()) )
+	{
+		return false;
+	}
+	custody.tip.tipHash = in.substr( pos, BLOCK_PREV_HASH_SIZE );
+	pos += BLOCK_PREV_HASH_SIZE;
+	if( !snapGet( in, pos, custody.tip.blockCount ) || !snapGet( in, pos, recordCount ) )
+	{
+		return false;
+	}
+	for( uint64_t i = 0; i < recordCount; i++ )
+	{
+		CustodyRecord record;
+		if( (pos + BLOCK_ITEM_ID_SIZE) > in.size() )
+		{
+			return false;
+		}
+		string itemKey = in.substr( pos, BLOCK_ITEM_ID_SIZE );
+		pos += BLOCK_ITEM_ID_SIZE;
+		if( !snapGet( in, pos, record ) )
+		{
+			return false;
+		}
+		custody.held[itemKey] = record;
+	}
+	return true;
+}
+
+/**
+ * @dev Bring the custody index up to date with the chain and save it if it moved
+ * @return false if the chain does not exist
+ */
+bool custodySync( CustodyIndex &custody )
+{
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		return false;
+	}
+	bool changed = false;
+	bool valid = custody.loaded;
+	if( !custody.loaded )
+	{
+		ifstream custodyFile( (COC_FILE + ".custody").c_str(), std::ios::binary );
+		if( custodyFile )
+		{
+			stringstream contents;
+			contents << custodyFile.rdbuf();
+			valid = custodyDeserialize( custody, contents.str() );
+		}
+		custody.loaded = true;
+	}
+	if( !valid || !chainStateMatches( custody.tip, chain ) )
+	{
+		//missing, damaged, or written against another chain
+		chainStateSync( COC_STATE );
+		custodyFromState( custody, COC_STATE );
+		changed = true;
+	}
+	
+	//fold in every complete block after the covered part of the chain
+	vector<unsigned char> wholeBlock;
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	chainSeek( chain, custody.tip.chainEnd );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		custodyApply( custody, block, blockHead );
+		hashBlock( block.raw, block.size(), blockHash );
+		custody.tip.tipBlock = blockHead;
+		custody.tip.chainEnd = chainTell( chain );
+		custody.tip.tipHash = string( (const char*)blockHash, BLOCK_PREV_HASH_SIZE );
+		custody.tip.blockCount++;
+		changed = true;
+	}
+	chainClose( chain );
+	if( changed )
+	{
+		string contents;
+		custodySerialize( custody, contents );
+		writeFileAtomic( COC_FILE + ".custody", contents );
+	}
+	return true;
+}
+
+/**
+ * @dev AES-ECB encryption using OpenSSL EVP interface
+ */
+string aesEncryptECB(const unsigned char* input, const std::string& key)
+{
+    unsigned char encrypted[16] = {0};
+    int outlen = 0;
+
+    //each thread keys one context and reuses it (ECB keeps no state between blocks)
+    static thread_local EVP_CIPHER_CTX* ctx = NULL;
+    static thread_local string ctxKey;
+    if( (NULL == ctx) || (0 != ctxKey.compare( key )) )
+    {
+        if( NULL == ctx )
+        {
+            ctx = EVP_CIPHER_CTX_new();
+        }
+        EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr);
+        EVP_CIPHER_CTX_set_padding(ctx, 0); // Disable padding
+        ctxKey = key;
+    }
+
+    EVP_EncryptUpdate(ctx, encrypted, &outlen, input, 16);
+
+    return bytesToByteString(encrypted, 16);
+}
+
+/**
+ * @dev Encrypt an input byte array using the constant AES_KEY
+ * @param Bytes to encrypt
+ * @param Length of the value
+ */
+void encryptBytes( unsigned char* itemToEncrypt, int itemLength, bool isCaseId )
+{
+	//translate the input into it's byte equivalent
+    unsigned char encryptedBytes[16] = {0};
+	if( isCaseId )
+	{
+		//translate the input into string
+		string toEncrypt = "";
+		toEncrypt.append((const char*)itemToEncrypt, itemLength);
+		//format the string into bytes
+		uuidToBytes(toEncrypt, encryptedBytes);
+	}
+	else
+	{
+		//translate the string into an int32_t
+		uint32_t itemId = atoi( (const char*)itemToEncrypt );
+		//format the int32_t into bytes
+		prepareItemBytes(itemId, encryptedBytes);
+	}
+
+    string encryptedResult = aesEncryptECB(encryptedBytes, AES_KEY);
+    //cout << "Encrypted Case ID: " << encryptedResult << std::endl;
+	
+	//clear the input char array and copy the encrypted string into it
+	memset( &itemToEncrypt[0], 0, itemLength);
+	memcpy( &itemToEncrypt[0], encryptedResult.c_str(), itemLength );
+	
+}
+
+/**
+ * @dev AES-ECB encryption using OpenSSL EVP interface
+ */
+std::string aesDecryptECB(const unsigned char* input, const std::string& key)
+{
+    unsigned char encrypted[16] = {0};
+    int outlen = 0;
+
+    //each thread keys one context and reuses it (ECB keeps no state between blocks)
+    static thread_local EVP_CIPHER_CTX* ctx = NULL;
+    static thread_local string ctxKey;
+    if( (NULL == ctx) || (0 != ctxKey.compare( key )) )
+    {
+        if( NULL == ctx )
+        {
+            ctx = EVP_CIPHER_CTX_new();
+        }
+        EVP_DecryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, reinterpret_cast<const unsigned char*>(key.data()), nullptr);
+        EVP_CIPHER_CTX_set_padding(ctx, 0); // Disable padding
+        ctxKey = key;
+    }
+
+    EVP_DecryptUpdate(ctx, encrypted, &outlen, input, 16);
+
+    return bytesToByteString(encrypted, 16);
+}
+
+/**
+ * @dev Decrypt an input byte array using the constant AES_KEY
+ * @param Bytes to decrypt
+ * @param Length of the value
+ */
+void decryptBytes( unsigned char* itemToDecrypt, int itemLength, bool isItemId )
+{
+	string toDecrypt = "";
+	toDecrypt.append((const char*)itemToDecrypt, itemLength);
+	//cout << "To Decrypt: " << toDecrypt << endl;
+	
+	unsigned char decryptedBytes[16] = {0};
+	uuidToBytes(toDecrypt, decryptedBytes);
+	string decryptedString = aesDecryptECB( decryptedBytes, AES_KEY );
+	
+	//cout << "Decrypted: " << decryptedString <<endl;
+	
+	//Item Ids have an extra step to complete the decryption
+	if( isItemId )
+	{
+		uint32_t itemVal;
+		stringstream ss;
+		ss << hex << decryptedString;
+		ss >> itemVal;
+		decryptedString = to_string(itemVal);
+	}
+	
+	//clear the input char array and copy the decrypted string into it
+	memset( &itemToDecrypt[0], 0, itemLength);
+	memcpy( &itemToDecrypt[0], decryptedString.c_str(), itemLength );
+}
+
+/**
+ * @dev Translate an Epoch into formatted time string
+ * @param Count of microseconds since Epoch to format
+ */
+string translateTimestamp( uint64_t inTime )
+{
+	stringstream ss;
+	string result;
+	//extract the microseconds from the input Time
+	int microseconds = inTime % 1000000;
+	time_t remainder = inTime / 1000000;
+	//format the remaining YYYY-MM-DD (%F) & HH:M:SS (%T) time
+	struct tm time;
+	localtime_r( &remainder, &time );
+	char buffer[80];
+	strftime( buffer, 80, "%FT%T.", &time );
+	//transalte to a string and trim off excess characters
+	string tmpStr;
+	tmpStr.append((const char*)&buffer[0], 80);
+	tmpStr = tmpStr.substr(0, tmpStr.find("."));
+	//concat the entire time measurement into a single string
+	ss << tmpStr << "." << to_string(microseconds) << "Z";
+	result = ss.str();
+	//return the result
+	return result;
+}
+
+/**
+ * @dev Parse a time given on the command line. It is either microseconds since
+ *		the epoch, or the YYYY-MM-DDTHH:MM:SS[.micro][Z] form the other commands
+ *		print (read back the same way translateTimestamp writes it)
+ * @return false if the text is neither
+ */
+bool parseTimestamp( string text, uint64_t &result )
+{
+	if( (text.size() > 0) && (string::npos == text.find_first_not_of("0123456789")) )
+	{
+		result = strtoull( text.c_str(), NULL, 10 );
+		return true;
+	}
+	struct tm parsed;
+	memset( &parsed, 0, sizeof(parsed) );
+	unsigned int microseconds = 0;
+	int fields = sscanf( text.c_str(), "%d-%d-%dT%d:%d:%d.%u", &parsed.tm_year, &parsed.tm_mon, &parsed.tm_mday,
+						&parsed.tm_hour, &parsed.tm_min, &parsed.tm_sec, &microseconds );
+	if( (fields < 6) || (microseconds >= 1000000) )
+	{
+		return false;
+	}
+	parsed.tm_year -= 1900;
+	parsed.tm_mon -= 1;
+	parsed.tm_isdst = -1;
+	time_t seconds = mktime( &parsed );
+	if( seconds < 0 )
+	{
+		return false;
+	}
+	result = (uint64_t)seconds * 1000000 + microseconds;
+	return true;
+}
+
+/**
+ * @dev Format a chain position as a resumable cursor (fixed width hex offset)
+ */
+string formatCursor( uint64_t offset )
+{
+	char buffer[32];
+	snprintf( buffer, sizeof(buffer), "%016llx", (unsigned long long)offset );
+	return string( buffer );
+}
+
+/**
+ * @dev Parse a cursor printed by formatCursor
+ * @return false if the text is not a cursor
+ */
+bool parseCursor( string text, uint64_t &offset )
+{
+	if( (0 == text.size()) || (text.size() > 16) || (string::npos != text.find_first_not_of("0123456789abcdefABCDEF")) )
+	{
+		return false;
+	}
+	offset = strtoull( text.c_str(), NULL, 16 );
+	return true;
+}
+
+/**
+ * @dev Parse an entry count given on the command line (-n, --limit)
+ * @return false if the text is not a plain decimal number
+ */
+bool parseCount( string text, int &count )
+{
+	if( (0 == text.size()) || (text.size() > 9) || (string::npos != text.find_first_not_of("0123456789")) )
+	{
+		return false;
+	}
+	count = atoi( text.c_str() );
+	return true;
+}
+
+/**
+ * @dev Method to check if the blockchain is initialized
+ */
+bool cocIsInit()
+{
+	bool validInit = true;
+	//confirm the file exists before attempting to read it
+	validInit = fileExists();
+	if( validInit )
+	{
+		//get the current contents of the blockchain
+		ChainFile chain;
+		chainOpen( chain );
+		//get the state of the first block (start of the chain)
+		chainSeek( chain, BLOCK_STATE_OFFSET );
+		//copy the content into a local array
+		unsigned char readState[BLOCK_STATE_SIZE];
+		chainRead( chain, readState, BLOCK_STATE_SIZE );
+		//Compare to expected Init value
+		unsigned char expectedState[] = {'I','N','I','T','I','A','L','\0','\0','\0','\0','\0'};
+		for( int pos = 0; pos < BLOCK_STATE_SIZE; pos++ )
+		{
+			//if any byte does not match, it is an invalid init block
+			if( readState[pos] != expectedState[pos] )
+			{
+				validInit = false;
+			}
+		}
+		//alert user of invalid INITIAL blocks
+		if( false == validInit )
+		{
+			printf("Blockchain file found without an INITIAL block\n");
+		}
+		
+		chainClose( chain );
+	}
+	
+	//return the result
+	return validInit;
+}
+
+/**
+ * @dev Support method to clear any unexpected data from the block info
+ */
+void resetBlockBytes()
+{
+	//Initialize the fields
+	memset( &blockPrevHash[0], 0, BLOCK_PREV_HASH_SIZE);
+	memset( &blockTimestamp.byteTime[0], 0, BLOCK_TIMESTAMP_SIZE);
+	//memset( &blockCaseID[0], 0, BLOCK_CASE_ID_SIZE);
+	//memset( &blockItemID[0], 0, BLOCK_ITEM_ID_SIZE);
+	for( int i = 0; i < BLOCK_CASE_ID_SIZE; i++ )
+	{
+		blockCaseID[i] = '0';
+	}
+	for( int i = 0; i < BLOCK_ITEM_ID_SIZE; i++ )
+	{
+		blockItemID[i] = '0';
+	}
+	for( int i = 0; i < BLOCK_STATE_SIZE; i++ )
+	{
+		blockState[i] = '\0';
+	}
+	for( int i = 0; i < BLOCK_CREATOR_SIZE; i++ )
+	{
+		blockCreator[i] = '\0';
+	}
+	for( int i = 0; i < BLOCK_OWNER_SIZE; i++ )
+	{
+		blockOwner[i] = '\0';
+	}
+	blockDataLen.intLen = 0;
+}
+
+//serialization buffer reused by every appended block
+vector<unsigned char> COC_BLOCK_BUFFER;
+
+/**
+ * @dev This method serializes all the block info into a single block and adds
+ *		it to the end of the blockchain
+ * @param dataField is the contents of the variable length data field
+ * @return 0 on success, 1 on failure
+ */
+int appendCurrentBlock( const string &dataField )
+{
+	if( COC_BLOCK_BUFFER.size() < (BLOCK_MIN_SIZE + dataField.size()) )
+	{
+		COC_BLOCK_BUFFER.resize( BLOCK_MIN_SIZE + dataField.size() );
+	}
+	size_t blockLen = serializeBlock<BlockLayout>( &COC_BLOCK_BUFFER[0], blockPrevHash, blockTimestamp.dblTime,
+						blockCaseID, blockItemID, blockState, blockCreator, blockOwner,
+						(const unsigned char*)dataField.data(), dataField.size() );
+	return appendBlock( &COC_BLOCK_BUFFER[0], blockLen );
+}
+
+/**
+ * @dev This method returns the latest state of an evidence item. The chain state is
+ *		loaded from the snapshot (if any) and only the blocks after it are replayed.
+ * @param The item name to search for
+ */
+int getEvidenceState( unsigned char* itemToCheck )
+{
+	int latestState = -1;
+	//confirm the file exists before attempting to read it
+	if( fileExists() )
+	{
+		chainStateSync( COC_STATE );
+		string itemKey( (const char*)itemToCheck, BLOCK_ITEM_ID_SIZE );
+		unordered_map<string, ItemState>::iterator found = COC_STATE.items.find( itemKey );
+		if( found != COC_STATE.items.end() )
+		{
+			//for convenience, copy the Case ID, Creator, & Owner of this evidence item
+			memcpy( &blockCaseID[0], found->second.caseId, BLOCK_CASE_ID_SIZE );
+			memcpy( &blockCreator[0], found->second.creator, BLOCK_CREATOR_SIZE );
+			memcpy( &blockOwner[0], found->second.owner, BLOCK_OWNER_SIZE );
+			latestState = found->second.stateCode;
+		}
+		//for convenience, store the hash of the last block in the blockPrevHash
+		memcpy( &blockPrevHash[0], COC_STATE.tipHash.data(), BLOCK_PREV_HASH_SIZE );
+		if( COC_STATE.corrupt )
+		{
+			printf("Blockchain corruption detected\n");
+			latestState = -2;
+		}
+	}
+	return latestState;
+}
+
+/**
+ * @dev This method compares a password against known allowable passwords and
+ *		returns a number reflecting who's password it belongs to
+ * @param The password to check
+ */
+int checkPassword( string cmpPassword )
+{
+	int passwordsMatch = -1;
+	if( 0 == cmpPassword.compare( BCHOC_PASSWORD_CREATOR ) )
+	{
+		passwordsMatch = 0;
+	}
+	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_POLICE ) )
+	{
+		passwordsMatch = 1;
+	}
+	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_LAWYER ) )
+	{
+		passwordsMatch = 2;
+	}
+	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_ANALYST ) )
+	{
+		passwordsMatch = 3;
+	}
+	else if( 0 == cmpPassword.compare( BCHOC_PASSWORD_EXECUTIVE ) )
+	{
+		passwordsMatch = 4;
+	}
+	return passwordsMatch;
+}
+
+/*
+ * =============
+ * Methods providing core functionality
+ * =============
+ */
+ 
+/**
+ * @dev Method to create an INITIAL block if none exists
+ */
+int init()
+{
+	int result = 0;
+	bool prevInit = cocIsInit();
+	if( prevInit )
 	{
 		//INITIAL block exists, do not create another
 		printf("Blockchain file found with INITIAL block\n");
 	}
-	else
+	else
+	{
+		//Confirm we reached here because no blockchain file
+		//exists, and not because the file has a first block that
+		//is something other than INITIAL
+		if( !(fileExists()) )
+		{
+			//INITIAL block does not exist, create one
+			printf("Blockchain file not found. Created INITIAL block\n");
+			//create the folder per BCHOC_FILE_PATH (first check it doesnt already exist)
+			struct stat existence;
+			int idxOfNameStart = -1;
+			for( int i = strlen(COC_FILE.c_str()); i >= 0; i-- )
+			{
+				//find the first instance of "/"
+				if( '/' == COC_FILE[i] )
+				{
+					idxOfNameStart = i + 1;
+					i = -1;
+				}
+			}
+			//FILE_PATH includes more than just filename
+			if( -1 != idxOfNameStart )
+			{
+				//take the substring containing the folder path
+				string folderPath = COC_FILE.substr( 0, idxOfNameStart );
+				//if it doesnt exist, create it
+				if( 0 != stat(folderPath.c_str(), &existence) )
+				{
+					mkdir( folderPath.c_str(), 0777 );
+				}
+			}
+			//Initialize the fields (reset 0s everything as deired)
+			resetBlockBytes();
+			//set specific fields
+			//get time of creation
+			blockTimestamp.dblTime = unixTimestamp();;
+			//case-id can remain all 0s
+			//item-id can remain all 0s
+			//set state to INITIAL
+			string setValue = "INITIAL";
+			memcpy( &blockState[0], setValue.c_str(), setValue.size() );
+			//do some ridiculous data manipulation to get the exact bytes "Initial Block\0"
+			setValue = "Initial block";
+			int valByteLen = setValue.size() + 1;
+			unsigned char dataBytes[setValue.size() + 1];
+			for( int i = 0; i < valByteLen; i++ )
+			{
+				dataBytes[i] = '\0';
+				if( i < setValue.size() )
+				{
+					dataBytes[i] = setValue[i];
+				}
+			}
+			setValue = "";
+			setValue.append((const char*)&dataBytes[0], valByteLen);
+			blockDataLen.intLen = valByteLen;
+			//create the INITIAL block as the first entry in the file
+			if( 0 != appendCurrentBlock( setValue ) )
+			{
+				result = 1;
+			}
+		}
+		else
+		{
+			//else we have a block chain with a 1st block other than an INITIAL
+			result = 1;
+		}
+	}
+	return result;
+}
+ 
+/**
+ * @dev Method to add a new evidence item t othe blockchain
+ * @param The case to associate to the item
+ * @param The item to attempt to add
+ * @param The Creator name to asosciate to the item
+ */
+int addItemToCase( string inCaseId, string inItemId, string inCreator )
+{
+	//check if method successfully added (0 = success / 1 = failure)
+	int result = 0;
+	//if we add before creating an INITIAL block, create one
+	init();
+	
+	//before attempting to add a block,
+	//clear out any existing data i nthe arrays
+	resetBlockBytes();
+	//prepare item for uniqueness check against entries in blockchain
+	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
+	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
+	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
+	
+	//encrypt the data for simple comparison in the getEvidenceState()
+	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
+	int evidenceState = getEvidenceState( &itemID[0] );
+	if( -1 == evidenceState)
+	{
+		//get the time the evidence was added
+		uint64_t timeOfEvent = unixTimestamp();
+		
+		//evidence ID is unique and should be added
+		//Capture timestamp and store
+		blockTimestamp.dblTime = timeOfEvent;
+		//copy Case Id (then encrypt the bytes)
+		memcpy( &blockCaseID[0], inCaseId.c_str(), inCaseId.size() );
+		encryptBytes( &blockCaseID[0], BLOCK_CASE_ID_SIZE, true );
+		//copy Item Id (bytes already encrypted befoer checking evidence state)
+		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
+		//set default state
+		string defaultState = "CHECKEDIN";
+		memcpy( &blockState[0], defaultState.c_str(), defaultState.size() );
+		//copy creator id
+		memcpy( &blockCreator[0], inCreator.c_str(), inCreator.size() );
+		//Owner is left in default empty state
+		//set the data length to 0 since there is no data field value
+		blockDataLen.intLen = 0;
+		
+		//BCHOC does not support comments in the data field during adds
+		//append new block to end
+		if( 0 != appendCurrentBlock( "" ) )
+		{
+			//appendBlock has already reported why the block was not stored
+			result = 1;
+		}
+		else
+		{
+			//event completed successfully, perform stdout operations
+			printf("Added item: %s\n", inItemId.c_str());
+			printf("Status: CHECKEDIN\n");
+			printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
+		}
+	}
+	else
+	{
+		printf("Evidence already exists\n");
+		result = 1;
+	}
+	
+	return result;
+}
+
+/**
+ * @dev This method will attempt to checkout an item if it is in the checkedin state
+ * @param The item id to attempt to checkout
+ * @param The password will set the owner based on the password used to complete the action
+ */
+int checkoutItem( string inItemId, int checkoutPassword )
+{
+	//check if method successfully added (0 = success / 1 = failure)
+	int result = 0;
+	//before attempting to checkout an item
+	//clear out any existing data in the arrays
+	resetBlockBytes();
+	//prepare item for check against entries in blockchain
+	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
+	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
+	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
+	
+	//encrypt the data for simple comparison in the getEvidenceState()
+	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
+	int evidenceState = getEvidenceState( &itemID[0] );
+	//operation only permitted if evidence is CHECKEDIN
+	if( CHECKEDIN == evidenceState)
+	{
+		//get the time the evidence was checked out
+		uint64_t timeOfEvent = unixTimestamp();
+		
+		//evidence Id is valid and in a CHECKEDIN state, make checkout entry
+		//Capture timestamp and store
+		blockTimestamp.dblTime = timeOfEvent;
+		//--getEvidenceState() has already stored the Case Id in the blockCaseId after finding a matching Item ID
+		//Copy the Item ID (already encrypted)
+		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
+		//set checkout state
+		string checkoutState = "CHECKEDOUT";
+		memcpy( &blockState[0], checkoutState.c_str(), checkoutState.size() );
+		//--getEvidenceState() has already stored the Creator in the blockCreator after finding a matching Item ID
+		//Set the owner according to the password used
+		string Owner = "";
+		switch( checkoutPassword )
+		{
+			case 1: Owner = "POLICE";
+				break;
+			case 2: Owner = "LAWYER";
+				break;
+			case 3: Owner = "ANALYST";
+				break;
+			case 4: Owner = "EXECUTIVE";
+				break;
+		}
+		//reset any lingering data in this block before copying
+		for( int i = 0; i < BLOCK_OWNER_SIZE; i++ )
+		{
+			blockOwner[i] = '\0';
+		}
+		memcpy( &blockOwner[0], Owner.c_str(), Owner.size() );
+		//DataLen is left as 0 and Data field is empty
+		
+		//BCHOC does not support comments in the data field during checkouts
+		//append new block to end
+		if( 0 != appendCurrentBlock( "" ) )
+		{
+			//appendBlock has already reported why the block was not stored
+			result = 1;
+		}
+		else
+		{
+			//keep the custody index in step with the new block
+			custodySync( COC_CUSTODY );
+			
+			//event completed successfully, perform stdout operations
+			string tmpCaseId = "";
+			unsigned char tmpCaseIdBytes[BLOCK_CASE_ID_SIZE];
+			memcpy(&tmpCaseIdBytes[0], &blockCaseID[0], BLOCK_CASE_ID_SIZE);
+			decryptBytes( &tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE, false );
+			tmpCaseId.append((const char*)&tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE);
+			printf("Case: %s\n", tmpCaseId.c_str());
+			printf("Checked out item: %s\n", inItemId.c_str());
+			printf("Status: CHECKEDOUT\n");
+			printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
+		}
+	}
+	else
+	{
+		printf("Evidence CANNOT be Checked Out\n");
+		result = 1; //return 1 on error
+	}
+	
+	//return result
+	return result;
+}
+
+/**
+ * @dev This item looks for an item, and if it is checked out then it will make a checkin block
+ * @param The item to attempt to checkin
+ * @param The password used to complete the action will set the Owner field to POLICE/LAWYER/ANALYST/EXECUTIVE
+ */
+int checkinItem( string inItemId, int checkoutPassword )
+{
+	//check if method successfully added (0 = success / 1 = failure)
+	int result = 0;
+	//before attempting to checkin an item,
+	//clear out any existing data in the arrays
+	resetBlockBytes();
+	//prepare item for check against entries in blockchain
+	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
+	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
+	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
+	
+	//encrypt the data for simple comparison in the getEvidenceState()
+	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
+	int evidenceState = getEvidenceState( &itemID[0] );
+	//operation only permitted if evidence is CHECKEDOUT
+	if( CHECKEDOUT == evidenceState)
+	{
+		//get the time the evidence was checked in
+		uint64_t timeOfEvent = unixTimestamp();
+		
+		//evidence Id is valid and in a CHECKEDOUT state, make checkin entry
+		//Capture timestamp and store
+		blockTimestamp.dblTime = timeOfEvent;
+		//--getEvidenceState() has already stored the Case Id in the blockCaseId after finding a matching Item ID
+		//Copy the Item ID (already encrypted)
+		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
+		//set checkin state
+		string checkinState = "CHECKEDIN";
+		memcpy( &blockState[0], checkinState.c_str(), checkinState.size() );
+		//--getEvidenceState() has already stored the Creator in the blockCreator after finding a matching Item ID
+		//Set the owner according to the password used
+		string Owner = "";
+		switch( checkoutPassword )
+		{
+			case 1: Owner = "POLICE";
+				break;
+			case 2: Owner = "LAWYER";
+				break;
+			case 3: Owner = "ANALYST";
+				break;
+			case 4: Owner = "EXECUTIVE";
+				break;
+		}
+		//reset any lingering data in this block before copying
+		for( int i = 0; i < BLOCK_OWNER_SIZE; i++ )
+		{
+			blockOwner[i] = '\0';
+		}
+		memcpy( &blockOwner[0], Owner.c_str(), Owner.size() );
+		//DataLen is left as 0 and Data field is empty
+		
+		//BCHOC does not support comments in the data field during checkins
+		//append new block to end
+		if( 0 != appendCurrentBlock( "" ) )
+		{
+			//appendBlock has already reported why the block was not stored
+			result = 1;
+		}
+		else
+		{
+			//keep the custody index in step with the new block
+			custodySync( COC_CUSTODY );
+			
+			//event completed successfully, perform stdout operations
+			string tmpCaseId = "";
+			unsigned char tmpCaseIdBytes[BLOCK_CASE_ID_SIZE];
+			memcpy(&tmpCaseIdBytes[0], &blockCaseID[0], BLOCK_CASE_ID_SIZE);
+			decryptBytes( &tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE, false );
+			tmpCaseId.append((const char*)&tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE);
+			printf("Case: %s\n", tmpCaseId.c_str());
+			printf("Checked out item: %s\n", inItemId.c_str());
+			printf("Status: CHECKEDIN\n");
+			printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
+		}
+	}
+	else
+	{
+		printf("Evidence CANNOT be Checked In\n");
+		result = 1;
+	}
+	
+	return result;
+}
+
+/**
+ * @dev This method "removes" an evidence item from the Chain of Custody by updating its state
+ * @param inItemId specifies which item to remove
+ * @param removalType is the state change to DESTROYED/DISPOSED/RELEASED
+ * @param removalReason is the string to put in the data field for the event (optional for all but RELEASED)
+ */
+int removeItem( string inItemId, int removalType, string removalReason , int checkoutPassword )
+{
+	//check if method successfully added (0 = success / 1 = failure)
+	int result = 0;
+	//before attempting to checkin an item,
+	//clear out any existing data in the arrays
+	resetBlockBytes();
+	//prepare item for check against entries in blockchain
+	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
+	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
+	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
+	
+	//encrypt the data for simple comparison in the getEvidenceState()
+	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
+	int evidenceState = getEvidenceState( &itemID[0] );
+	//operation only permitted if evidence is CHECKEDIN
+	if( CHECKEDIN == evidenceState)
+	{
+		//get the time the evidence was removed
+		uint64_t timeOfEvent = unixTimestamp();
+		
+		//evidence Id is valid and in a CHECKEDIN state, make removal entry
+		//Capture timestamp and store
+		blockTimestamp.dblTime = timeOfEvent;
+		//--getEvidenceState() has already stored the Case Id in the blockCaseId after finding a matching Item ID
+		//Copy the Item ID
+		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
+		//set removal state based on argument
+		string removalState = "";
+		switch( removalType )
+		{
+			case 1: removalState = "DISPOSED";
+				break;
+			case 2: removalState = "DESTROYED";
+				break;
+			case 3: removalState = "RELEASED";
+				break;
+		}
+		memcpy( &blockState[0], removalState.c_str(), removalState.size() );
+		//--getEvidenceState() has already stored the Creator in the blockCreator after finding a matching Item ID
+		//Leave the Owner field to the last individual to access the evidence
+		//check if a comment has been added to the data field
+		//(when there is none, DataLen is left as 0 and Data field is empty)
+		blockDataLen.intLen = removalReason.size();
+		//append new block to end
+		if( 0 != appendCurrentBlock( removalReason ) )
+		{
+			//appendBlock has already reported why the block was not stored
+			result = 1;
+		}
+		else
+		{
+			//keep the custody index in step with the new block
+			custodySync( COC_CUSTODY );
+			
+			//event completed successfully, perform stdout operations
+			string tmpCaseId = "";
+			unsigned char tmpCaseIdBytes[BLOCK_CASE_ID_SIZE];
+			memcpy(&tmpCaseIdBytes[0], &blockCaseID[0], BLOCK_CASE_ID_SIZE);
+			decryptBytes( &tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE, false );
+			tmpCaseId.append((const char*)&tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE);
+			printf("Case: %s\n", tmpCaseId.c_str() );
+			printf("Checked out item: %s\n", inItemId.c_str() );
+			printf("Status: %s\n", removalState.c_str() );
+			printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
+		}
+	}
+	else
+	{
+		printf("Evidence CANNOT be Removed\n");
+		result = 1;
+	}
+	
+	return result;
+}
+
+/**
+ * @dev Method that shows all unique cases in the blockchain
+ */
+void showCases()
+{
+	//track the list of unique Case IDs
+	vector<string> caseIdList;
+	//confirm the file exists before attempting to read it
+	if( fileExists() )
+	{
+		//the chain state already lists the cases in the order they first appear
+		chainStateSync( COC_STATE );
+		caseIdList = COC_STATE.caseOrder;
+	}
+	
+	//print all found cases
+	for( int i = 0; i < caseIdList.size(); i++ )
+	{
+		//decrypt the data for human readable output
+		decryptBytes( (unsigned char*)caseIdList[i].c_str(), BLOCK_CASE_ID_SIZE, false );
+		caseIdList[i].insert(20, "-");
+		caseIdList[i].insert(16, "-");
+		caseIdList[i].insert(12, "-");
+		caseIdList[i].insert(8, "-");
+		printf("%s\n", caseIdList[i].c_str() );
+	}
+}
+
+/**
+ * @dev This method prints all Evidence items associated to the specified case
+ * @param the case to find all items for
+ * @param paged prints a cursor (the item's first block) after the last item, which
+ *		"afterCursor" takes to resume with the next page ("" starts at the first item)
+ * @param limit is the most items to print (-1 for all)
+ * @return 1 if the cursor is invalid
+ */
+int showItems( string inCaseId, bool paged, string afterCursor, int limit )
+{
+	//track the list of unique item IDs for this case
+	vector<string> itemIdList;
+	//translate input to a full length string for proper comparisons
+	//This is because when reading from the byte array the string will always
+	//be of length 32 (even if it is only "1234"). We need to translate the
+	//input to be length 32 otherwise comparison will flag false by string
+	//length even if its contents are matching
+	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
+	memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
+	memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
+	//then we need to encrypt the bytes to match the blockchain sotrage
+	encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
+	inCaseId = "";
+	inCaseId.append((const char*)&tmpCaseId[0], BLOCK_CASE_ID_SIZE);
+	//confirm the file exists before attempting to read it
+	if( fileExists() )
+	{
+		//the chain state already lists each case's items in the order they first appear
+		chainStateSync( COC_STATE );
+		unordered_map<string, vector<string> >::iterator found = COC_STATE.caseItems.find( inCaseId );
+		if( found != COC_STATE.caseItems.end() )
+		{
+			itemIdList = found->second;
+		}
+	}
+	
+	//items are listed in the order of their first blocks, so the cursor's
+	//item is found with a binary search on those offsets
+	size_t first = 0;
+	if( 0 != afterCursor.compare("") )
+	{
+		uint64_t after = 0;
+		size_t high = itemIdList.size();
+		uint64_t offset = 0;
+		bool valid = parseCursor( afterCursor, after );
+		while( valid && (first < high) )
+		{
+			size_t mid = first + (high - first) / 2;
+			valid = itemIndexFirstBlock( (const unsigned char*)itemIdList[mid].data(), offset );
+			if( offset < after )
+			{
+				first = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		if( !valid || (first == itemIdList.size()) ||
+			!itemIndexFirstBlock( (const unsigned char*)itemIdList[first].data(), offset ) || (offset != after) )
+		{
+			printf("Invalid cursor\n");
+			return 1;
+		}
+		first++;
+	}
+	size_t last = itemIdList.size();
+	if( (limit >= 0) && ((first + limit) < last) )
+	{
+		last = first + limit;
+	}
+	
+	//print all found cases
+	for( size_t i = first; i < last; i++ )
+	{
+		string itemId = itemIdList[i];
+		//decrypt the data for human readable output
+		decryptBytes( (unsigned char*)itemId.c_str(), BLOCK_ITEM_ID_SIZE, true );
+		printf("%s\n", itemId.c_str() );
+	}
+	//the last item's first block is where the next page picks up
+	uint64_t offset = 0;
+	if( paged && (last > first) && itemIndexFirstBlock( (const unsigned char*)itemIdList[last - 1].data(), offset ) )
+	{
+		printf("Cursor: %s\n", formatCursor( offset ).c_str());
+	}
+	return 0;
+}
+
+/**
+ * @dev Prints the items that are currently checked out, grouped by owner
+ * @param inOwner limits the list to one owner ("" applies no filter)
+ * @param inCaseId limits the list to one case ("" applies no filter)
+ */
+void showCustody( string inOwner, string inCaseId )
+{
+	//translate the case to its stored (encrypted) form for comparisons
+	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
+	if( 0 != inCaseId.compare("") )
+	{
+		memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
+		memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
+		encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
+	}
+	//translate the owner to the zero padded Owner field
+	unsigned char tmpOwner[BLOCK_OWNER_SIZE];
+	memset( &tmpOwner[0], 0, BLOCK_OWNER_SIZE );
+	memcpy( &tmpOwner[0], inOwner.c_str(), min( inOwner.size(), (size_t)BLOCK_OWNER_SIZE ) );
+	
+	//collect the matching records, ordered by owner and then checkout time
+	vector< pair< pair<string, uint64_t>, string > > heldList;
+	if( fileExists() && custodySync( COC_CUSTODY ) )
+	{
+		for( map<string, CustodyRecord>::iterator it = COC_CUSTODY.held.begin(); it != COC_CUSTODY.held.end(); ++it )
+		{
+			CustodyRecord &record = it->second;
+			if( (0 != inOwner.compare("")) && (0 != memcmp( record.owner, tmpOwner, BLOCK_OWNER_SIZE )) )
+			{
+				continue;
+			}
+			if( (0 != inCaseId.compare("")) && !idMatch32( record.caseId, tmpCaseId ) )
+			{
+				continue;
+			}
+			string ownerKey( (const char*)record.owner, BLOCK_OWNER_SIZE );
+			heldList.push_back( make_pair( make_pair( ownerKey, record.since ), it->first ) );
+		}
+	}
+	sort( heldList.begin(), heldList.end() );
+	
+	//print all found items
+	for( size_t i = 0; i < heldList.size(); i++ )
+	{
+		CustodyRecord &record = COC_CUSTODY.held[heldList[i].second];
+		string owner( (const char*)record.owner, strnlen( (const char*)record.owner, BLOCK_OWNER_SIZE ) );
+		string caseId( (const char*)record.caseId, BLOCK_CASE_ID_SIZE );
+		string itemId = heldList[i].second;
+		//decrypt the case id & item id for human readable output
+		decryptBytes( (unsigned char*)caseId.c_str(), BLOCK_CASE_ID_SIZE, false );
+		decryptBytes( (unsigned char*)itemId.c_str(), BLOCK_ITEM_ID_SIZE, true );
+		//re-apply hifens
+		caseId.insert(20, "-");
+		caseId.insert(16, "-");
+		caseId.insert(12, "-");
+		caseId.insert(8, "-");
+		printf("Owner: %s\nCase: %s\nItem: %s\nTime: %s\n\n",
+					owner.c_str(),
+					caseId.c_str(),
+					itemId.c_str(),
+					translateTimestamp( record.since ).c_str() );
+	}
+}
+
+/**
+ * @dev Prints the state of every item in a case as it stood at a moment in time
+ * @param inCaseId is the case to report on
+ * @param asOf is the moment (microseconds since the epoch)
+ */
+int showStateAsOf( string inCaseId, uint64_t asOf )
+{
+	//translate the case to its stored (encrypted) form for comparisons
+	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
+	memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
+	memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
+	encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
+	string caseKey( (const char*)&tmpCaseId[0], BLOCK_CASE_ID_SIZE );
+	
+	ChainState state;
+	if( !fileExists() || !chainStateAsOf( asOf, state, UINT64_MAX ) )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	unordered_map<string, vector<string> >::iterator found = state.caseItems.find( caseKey );
+	if( found == state.caseItems.end() )
+	{
+		printf("Case not found\n");
+		return 1;
+	}
+	//print every item of the case that existed at that moment
+	string caseId = caseKey;
+	decryptBytes( (unsigned char*)caseId.c_str(), BLOCK_CASE_ID_SIZE, false );
+	caseId.insert(20, "-");
+	caseId.insert(16, "-");
+	caseId.insert(12, "-");
+	caseId.insert(8, "-");
+	for( size_t i = 0; i < found->second.size(); i++ )
+	{
+		ItemState &item = state.items[found->second[i]];
+		string itemId = found->second[i];
+		decryptBytes( (unsigned char*)itemId.c_str(), BLOCK_ITEM_ID_SIZE, true );
+		string itemState( (const char*)item.state, strnlen( (const char*)item.state, BLOCK_STATE_SIZE ) );
+		string owner( (const char*)item.owner, strnlen( (const char*)item.owner, BLOCK_OWNER_SIZE ) );
+		printf("Case: %s\nItem: %s\nStatus: %s\nOwner: %s\nTime: %s\n\n",
+					caseId.c_str(),
+					itemId.c_str(),
+					itemState.c_str(),
+					owner.c_str(),
+					translateTimestamp( item.lastTime ).c_str() );
+	}
+	return 0;
+}
+
+/**
+ * @dev One matching block kept by show history
+ */
+const size_t HISTORY_RECORD_FIELDS = BLOCK_CASE_ID_SIZE + BLOCK_ITEM_ID_SIZE + BLOCK_STATE_SIZE;
+
+struct HistoryRecord
+{
+	unsigned char* fields;		//Case ID, Item ID and State back to back (in the arena)
+	uint64_t time;
+	bool initial;				//the INITIAL block, which is not encrypted
+};
+
+HistoryRecord historyRecord( ScanArena &arena, const BlockView &block, bool initial )
+{
+	HistoryRecord record;
+	record.initial = initial;
+	record.fields = arenaAlloc( arena, HISTORY_RECORD_FIELDS );
+	memcpy( record.fields, block.caseId(), BLOCK_CASE_ID_SIZE );
+	memcpy( record.fields + BLOCK_CASE_ID_SIZE, block.itemId(), BLOCK_ITEM_ID_SIZE );
+	memcpy( record.fields + BLOCK_CASE_ID_SIZE + BLOCK_ITEM_ID_SIZE, block.stateField(), BLOCK_STATE_SIZE );
+	record.time = block.time;
+	return record;
+}
+
+/**
+ * @dev Format one history entry from its decrypted fields
+ * @param initial prints the INITIAL block's Item ID as "0" instead of "0000..."
+ * @param out receives the text
+ */
+void formatHistoryEntry( const unsigned char* caseId, const unsigned char* itemId, const unsigned char* state, uint64_t time, bool initial, string &out )
+{
+	//re-apply hifens
+	char caseText[BLOCK_CASE_ID_SIZE + 5];
+	int length = 0;
+	for( int i = 0; i < BLOCK_CASE_ID_SIZE; i++ )
+	{
+		if( (8 == i) || (12 == i) || (16 == i) || (20 == i) )
+		{
+			caseText[length++] = '-';
+		}
+		caseText[length++] = caseId[i];
+	}
+	caseText[length] = '\0';
+	const char* itemText = initial ? "0" : (const char*)itemId;
+	int itemLength = initial ? 1 : BLOCK_ITEM_ID_SIZE;
+	//Time is a double of microseconds since Epoch, translate to human readable
+	//NOTICE - autograder expects a single string output
+	char entry[256];
+	int entryLength = snprintf( entry, sizeof(entry), "Case: %s\nItem: %.*s\nAction: %.*s\nTime: %s\n\n",
+				caseText,
+				itemLength, itemText,
+				BLOCK_STATE_SIZE, (const char*)state,
+				translateTimestamp( time ).c_str() );
+	out.append( entry, entryLength );
+}
+
+/**
+ * @dev Print one history entry from its decrypted fields
+ */
+void printHistoryEntry( const unsigned char* caseId, const unsigned char* itemId, const unsigned char* state, uint64_t time, bool initial )
+{
+	string entry;
+	formatHistoryEntry( caseId, itemId, state, time, initial, entry );
+	fwrite( entry.data(), 1, entry.size(), stdout );
+}
+/*
+ * =============
+ * History pipeline
+ * =============
+ * show history runs as three stages: the command's own thread reads and
+ * filters blocks into batches, a pool of workers decrypts and formats each
+ * batch, and a writer thread prints the batches in the order they were
+ * submitted. Batches are formatted out of order but written in order, so the
+ * output is the same as printing one entry at a time. BCHOC_THREADS sets the
+ * number of workers (default: one per core). Each batch owns its records'
+ * bytes and is freed once written, and the reader waits while too many
+ * batches are in flight, so memory stays bounded however long the output.
+ */
+const size_t HISTORY_BATCH_RECORDS = 512;
+
+struct HistoryBatch
+{
+	vector<HistoryRecord> records;
+	ScanArena arena;				//holds the records' fields
+	string output;
+	bool formatted;
+};
+
+struct HistoryPipeline
+{
+	mutex lock;
+	condition_variable queued;		//signalled when a batch is submitted (or input ends)
+	condition_variable formatted;	//signalled when a batch has been formatted
+	condition_variable drained;		//signalled when a batch has been written
+	deque<HistoryBatch*> pending;	//batches waiting for a worker
+	deque<HistoryBatch*> ordered;	//batches waiting to be written, in output order
+	HistoryBatch* filling;			//batch the reader is adding to
+	size_t maxInFlight;				//batches queued before the reader waits
+	bool closed;
+	vector<thread> workers;
+	thread writer;
+};
+
+/**
+ * @dev Decrypt and format the records of batches until the input ends
+ */
+void historyWorker( HistoryPipeline* pipeline )
+{
+	while( true )
+	{
+		HistoryBatch* batch = NULL;
+		{
+			unique_lock<mutex> guard( pipeline->lock );
+			while( !pipeline->closed && pipeline->pending.empty() )
+			{
+				pipeline->queued.wait( guard );
+			}
+			if( pipeline->pending.empty() )
+			{
+				return;
+			}
+			batch = pipeline->pending.front();
+			pipeline->pending.pop_front();
+		}
+		for( size_t i = 0; i < batch->records.size(); i++ )
+		{
+			HistoryRecord &record = batch->records[i];
+			//INITIAL block is not encrypted
+			if( !record.initial )
+			{
+				//decrypt the case id & item id for human readable output
+				decryptBytes( record.fields, BLOCK_CASE_ID_SIZE, false );
+				decryptBytes( record.fields + BLOCK_CASE_ID_SIZE, BLOCK_ITEM_ID_SIZE, true );
+			}
+			formatHistoryEntry( record.fields, record.fields + BLOCK_CASE_ID_SIZE,
+								record.fields + BLOCK_CASE_ID_SIZE + BLOCK_ITEM_ID_SIZE, record.time, record.initial, batch->output );
+		}
+		{
+			lock_guard<mutex> guard( pipeline->lock );
+			batch->formatted = true;
+		}
+		pipeline->formatted.notify_all();
+	}
+}
+
+/**
+ * @dev Print formatted batches in submission order until the input ends
+ */
+void historyWriter( HistoryPipeline* pipeline )
+{
+	while( true )
+	{
+		HistoryBatch* batch = NULL;
+		{
+			unique_lock<mutex> guard( pipeline->lock );
+			//the next batch to print, or the end of the input
+			while( pipeline->ordered.empty() ? !pipeline->closed : !pipeline->ordered.front()->formatted )
+			{
+				pipeline->formatted.wait( guard );
+			}
+			if( pipeline->ordered.empty() )
+			{
+				return;
+			}
+			batch = pipeline->ordered.front();
+			pipeline->ordered.pop_front();
+		}
+		pipeline->drained.notify_one();
+		fwrite( batch->output.data(), 1, batch->output.size(), stdout );
+		arenaRelease( batch->arena );
+		delete batch;
+	}
+}
+
+void historyPipelineStart( HistoryPipeline &pipeline )
+{
+	unsigned int threads = thread::hardware_concurrency();
+	if( (NULL != getenv("BCHOC_THREADS")) && (atoi( getenv("BCHOC_THREADS") ) > 0) )
+	{
+		threads = atoi( getenv("BCHOC_THREADS") );
+	}
+	pipeline.filling = NULL;
+	pipeline.maxInFlight = 2 * max( threads, 1u ) + 2;
+	pipeline.closed = false;
+	for( unsigned int i = 0; i < max( threads, 1u ); i++ )
+	{
+		pipeline.workers.push_back( thread( historyWorker, &pipeline ) );
+	}
+	pipeline.writer = thread( historyWriter, &pipeline );
+}
+
+/**
+ * @dev Hand the batch being filled to the workers
+ */
+void historyPipelineFlush( HistoryPipeline &pipeline )
+{
+	if( NULL == pipeline.filling )
+	{
+		return;
+	}
+	{
+		unique_lock<mutex> guard( pipeline.lock );
+		//let the writer catch up before queueing more
+		while( pipeline.ordered.size() >= pipeline.maxInFlight )
+		{
+			pipeline.drained.wait( guard );
+		}
+		pipeline.pending.push_back( pipeline.filling );
+		pipeline.ordered.push_back( pipeline.filling );
+	}
+	pipeline.filling = NULL;
+	pipeline.queued.notify_one();
+}
+
+/**
+ * @dev Queue a record to be printed after every record added before it
+ *		(its fields are copied into the batch)
+ */
+void historyPipelineAdd( HistoryPipeline &pipeline, const HistoryRecord &record )
+{
+	if( NULL == pipeline.filling )
+	{
+		pipeline.filling = new HistoryBatch();
+		pipeline.filling->arena = ScanArena();
+		pipeline.filling->formatted = false;
+		pipeline.filling->records.reserve( HISTORY_BATCH_RECORDS );
+	}
+	HistoryRecord copy = record;
+	copy.fields = arenaCopy( pipeline.filling->arena, record.fields, HISTORY_RECORD_FIELDS );
+	pipeline.filling->records.push_back( copy );
+	if( pipeline.filling->records.size() >= HISTORY_BATCH_RECORDS )
+	{
+		historyPipelineFlush( pipeline );
+	}
+}
+
+/**
+ * @dev End the input and wait for everything queued to be printed
+ */
+void historyPipelineFinish( HistoryPipeline &pipeline )
+{
+	historyPipelineFlush( pipeline );
+	{
+		lock_guard<mutex> guard( pipeline.lock );
+		pipeline.closed = true;
+	}
+	pipeline.queued.notify_all();
+	pipeline.formatted.notify_all();
+	for( size_t i = 0; i < pipeline.workers.size(); i++ )
+	{
+		pipeline.workers[i].join();
+	}
+	pipeline.writer.join();
+	fflush( stdout );
+}
+
+
+/**
+ * @dev Where show history's matches go. Forward order hands them straight to
+ *		the pipeline and stops after the first "limit"; reverse order keeps only
+ *		the newest "limit" in a ring (every match when there is no limit).
+ */
+struct HistoryStream
+{
+	HistoryPipeline pipeline;
+	bool reverse;
+	uint64_t limit;					//entries to print (UINT64_MAX for all)
+	uint64_t matched;				//matches seen so far
+	uint64_t lastBlock;				//offset of the latest match
+	vector<HistoryRecord> ring;		//reverse order: the newest matches
+	ScanArena arena;				//the ring's fields (forward order: scratch)
+};
+
+void historyStreamStart( HistoryStream &stream, int numEntries, bool reverse )
+{
+	stream.reverse = reverse;
+	//any negative count prints everything, as -1 does
+	stream.limit = UINT64_MAX;
+	if( numEntries >= 0 )
+	{
+		stream.limit = numEntries;
+	}
+	stream.matched = 0;
+	stream.arena = ScanArena();
+	historyPipelineStart( stream.pipeline );
+}
+
+/**
+ * @dev True once no further match could be printed
+ */
+bool historyStreamDone( HistoryStream &stream )
+{
+	return (0 == stream.limit) || (!stream.reverse && (stream.matched >= stream.limit));
+}
+
+void historyStreamAdd( HistoryStream &stream, const BlockView &block, uint64_t blockHead, bool initial )
+{
+	stream.lastBlock = blockHead;
+	if( !stream.reverse )
+	{
+		arenaReset( stream.arena );
+		historyPipelineAdd( stream.pipeline, historyRecord( stream.arena, block, initial ) );
+	}
+	else if( stream.ring.size() < stream.limit )
+	{
+		stream.ring.push_back( historyRecord( stream.arena, block, initial ) );
+	}
+	else
+	{
+		//overwrite the oldest match kept
+		HistoryRecord &oldest = stream.ring[stream.matched % stream.limit];
+		memcpy( oldest.fields, block.caseId(), BLOCK_CASE_ID_SIZE );
+		memcpy( oldest.fields + BLOCK_CASE_ID_SIZE, block.itemId(), BLOCK_ITEM_ID_SIZE );
+		memcpy( oldest.fields + BLOCK_CASE_ID_SIZE + BLOCK_ITEM_ID_SIZE, block.stateField(), BLOCK_STATE_SIZE );
+		oldest.time = block.time;
+		oldest.initial = initial;
+	}
+	stream.matched++;
+}
+
+/**
+ * @dev Print what reverse order kept (newest first) and wait for the output
+ */
+void historyStreamFinish( HistoryStream &stream )
+{
+	for( uint64_t i = 0; i < stream.ring.size(); i++ )
+	{
+		historyPipelineAdd( stream.pipeline, stream.ring[(stream.matched - 1 - i) % stream.limit] );
+	}
+	historyPipelineFinish( stream.pipeline );
+	arenaRelease( stream.arena );
+}
+
+/**
+ * @dev Show's the individual blocks in the blockchain
+ * @param inCaseId is an argument to filter the history by a specific Case ("" applies no filter)
+ * @param inItemId is an argument to filter the history by a specific item ("" applies no filter)
+ * @param numEntries defines how many entries to print (-1 prints all)
+ * @param By default it prints oldest to newest, but reverse=true prints newest to oldest
+ * @param paged prints a cursor after the entries, which "afterCursor" takes to
+ *		resume with the next page ("" starts from the first or, for reverse, last block)
+ * @return 1 if the cursor is invalid
+ */
+int showHistory( string inCaseId, string inItemId, int numEntries, bool reverse, bool paged, string afterCursor )
+{
+	//store the original strings for a simply empty compare later
+	string origCaseId = inCaseId;
+	string origItemId = inItemId;
+	//the INITIAL block isn't encrypted, so we shouldn't
+	//decrypt the results if it is among the list
+	bool listContainsInitialBlock = false;
+	if( (0 == origCaseId.compare("")) && (0 == origItemId.compare("")) )
+	{
+		listContainsInitialBlock = true;
+	}
+	//translate inputs to a full length string for proper comparisons
+	//This is because when reading from the byte array the string will always
+	//be of length 32 (even if it is only "1234"). We need to translate the
+	//input to be length 32 otherwise comparison will flag false by string
+	//length even if its contents are matching
+	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
+	memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
+	memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
+	//encrypting an empty string has errors, don't allow it
+	if( 0 != inCaseId.compare("") )
+	{
+		//then we need to encrypt the bytes to match the blockchain sotrage
+		encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
+	}
+	inCaseId = "";
+	inCaseId.append((const char*)&tmpCaseId[0], BLOCK_CASE_ID_SIZE);
+	//repeat process for Item ID
+	unsigned char tmpItemId[BLOCK_ITEM_ID_SIZE];
+	memset( &tmpItemId[0], 0, BLOCK_ITEM_ID_SIZE );
+	memcpy( &tmpItemId[0], inItemId.c_str(), inItemId.size() );
+	//encrypting an empty string has errors, don't allow it
+	if( 0 != inItemId.compare("") )
+	{
+		//then we need to encrypt the bytes to match the blockchain sotrage
+		encryptBytes( &tmpItemId[0], BLOCK_ITEM_ID_SIZE, false );
+	}
+	inItemId = "";
+	inItemId.append((const char*)&tmpItemId[0], BLOCK_ITEM_ID_SIZE);	
+	
+	//a page resumes next to the block named by the cursor
+	uint64_t after = 0;
+	bool hasAfter = (0 != afterCursor.compare(""));
+	if( hasAfter && (!parseCursor( afterCursor, after ) || !itemIndexIsBlockStart( after ) || (after >= COC_INDEX.head.chainEnd)) )
+	{
+		printf("Invalid cursor\n");
+		return 1;
+	}
+	//matches are printed as they are found (the newest ones are kept for -r).
+	//Pages in newest first order are read backwards, so they need no ring.
+	bool backwards = reverse && paged;
+	HistoryStream stream;
+	historyStreamStart( stream, numEntries, reverse && !backwards );
+	
+	//an item's history comes straight from the item index, which only visits
+	//that item's blocks (newest first)
+	vector<uint64_t> itemBlocks;
+	bool fromIndex = false;
+	if( fileExists() && (0 != origItemId.compare("")) )
+	{
+		//"-r -n" only needs the newest entries (unless a case filter drops some)
+		uint64_t limit = 0;
+		if( reverse && (numEntries > 0) && (0 == origCaseId.compare("")) && !hasAfter )
+		{
+			limit = numEntries;
+		}
+		fromIndex = itemIndexHistory( &tmpItemId[0], limit, itemBlocks );
+	}
+	if( fromIndex )
+	{
+		ChainFile chain;
+		chainOpen( chain );
+		//matches are added oldest to newest (newest to oldest for backwards pages)
+		for( size_t n = 0; (n < itemBlocks.size()) && !historyStreamDone( stream ); n++ )
+		{
+			uint64_t blockHead = itemBlocks[backwards ? n : (itemBlocks.size() - 1 - n)];
+			if( hasAfter && (backwards ? (blockHead >= after) : (blockHead <= after)) )
+			{
+				continue;
+			}
+			unsigned char header[BLOCK_MIN_SIZE];
+			chainSeek( chain, blockHead );
+			chainRead( chain, header, BLOCK_MIN_SIZE );
+			BlockView block( header );
+			if( (0 != origCaseId.compare("")) && !idMatch32( block.caseId(), (const unsigned char*)inCaseId.data() ) )
+			{
+				continue;
+			}
+			historyStreamAdd( stream, block, blockHead, false );
+		}
+		chainClose( chain );
+	}
+	//a backwards page walks the block offsets in the item index from the cursor
+	else if( backwards && fileExists() && itemIndexSync() )
+	{
+		ChainFile chain;
+		chainOpen( chain );
+		uint64_t blockNumber = hasAfter ? itemIndexLowerBound( after ) : COC_INDEX.head.blockCount;
+		IndexEntry entry;
+		while( (blockNumber-- > 0) && !historyStreamDone( stream ) && itemIndexEntry( blockNumber, entry ) )
+		{
+			unsigned char header[BLOCK_MIN_SIZE];
+			chainSeek( chain, entry.offset );
+			chainRead( chain, header, BLOCK_MIN_SIZE );
+			BlockView block( header );
+			if( (0 != origCaseId.compare("")) && !idMatch32( block.caseId(), (const unsigned char*)inCaseId.data() ) )
+			{
+				continue;
+			}
+			historyStreamAdd( stream, block, entry.offset, listContainsInitialBlock && (0 == entry.offset) );
+		}
+		chainClose( chain );
+	}
+	//otherwise, confirm the file exists before attempting to read it
+	else if( fileExists() && !historyStreamDone( stream ) )
+	{
+		string caseFilter = "";
+		if( 0 != origCaseId.compare("") )
+		{
+			caseFilter = inCaseId;
+		}
+		string itemFilter = "";
+		if( 0 != origItemId.compare("") )
+		{
+			itemFilter = inItemId;
+		}
+		//bring the range filters up to date so unrelated history can be skipped
+		//(an unfiltered dump has nothing to skip, and may stop after a few blocks)
+		vector<RangeFilter> filters;
+		if( (0 != caseFilter.size()) || (0 != itemFilter.size()) )
+		{
+			updateRangeFilters( filters );
+		}
+		//get the current contents of the blockchain
+		ChainFile chain;
+		chainOpen( chain );
+		//store the end of the chain location
+		uint64_t endOfChain = chainSize( chain );
+		//a forward page starts just past the cursor's block
+		if( hasAfter )
+		{
+			unsigned char header[BLOCK_MIN_SIZE];
+			chainSeek( chain, after );
+			chainRead( chain, header, BLOCK_MIN_SIZE );
+			chainSeek( chain, after + BlockView( header ).size() );
+		}
+		
+		//we need to sequentially check every block to determine the latest
+		//state of this evidence item
+		while( ((chainTell(chain) + BLOCK_MIN_SIZE) <= endOfChain) && !historyStreamDone( stream ) )
+		{
+			//when filtering by case and/or item, sealed segments and filtered
+			//ranges that never saw them can be passed over whole
+			if( chainSkipUnmatched( chain, filters, caseFilter, itemFilter ) )
+			{
+				continue;
+			}
+			//notice, this method does no verification of blockchain integrity
+			//read the fixed size header in one go and parse its fields in place
+			uint64_t blockHead = chainTell( chain );
+			unsigned char header[BLOCK_MIN_SIZE];
+			chainRead( chain, header, BLOCK_MIN_SIZE );
+			BlockView block( header );
+			
+			//check to see if it should be appended to the list of matches
+			//by comparing it to the Case ID & Item ID filter (guaranteed
+			//add to list if both are "")
+			bool addToList = true;
+			if( 0 != origCaseId.compare("") )
+			{
+				//if the current case & filter case do not
+				//match, then do not add to the list
+				if( !idMatch32( block.caseId(), (const unsigned char*)inCaseId.data() ) )
+				{
+					addToList = false;
+				}
+			}
+			if( 0 != origItemId.compare("") )
+			{
+				//if the current item & filter item do not
+				//match, then do not add to the list
+				if( !idMatch32( block.itemId(), (const unsigned char*)inItemId.data() ) )
+				{
+					addToList = false;
+				}
+			}
+			
+			//add the captured data from the block chain to the history list to show
+			if( addToList )
+			{
+				historyStreamAdd( stream, block, blockHead, listContainsInitialBlock && (0 == blockHead) );
+			}
+			
+			//advance past the data field to the next block
+			chainSkip( chain, block.dataLen );
+		}
+		chainClose( chain );
+	}
+	
+	historyStreamFinish( stream );
+	//the last row of a page is where the next page picks up
+	if( paged && (stream.matched > 0) )
+	{
+		printf("Cursor: %s\n", formatCursor( stream.lastBlock ).c_str());
+	}
+	return 0;
+}
+
+/**
+ * @dev First values seen for an item, which later blocks must keep
+ */
+struct VerifyItem
+{
+	const unsigned char* caseId;		//fields are copied into the verify arena
+	const unsigned char* itemId;
+	const unsigned char* creator;
+	int state;							//latest state
+};
+
+/**
+ * @dev Everything a verification carries from one block to the next, so it
+ *		can run in one go (verify) or a slice at a time (the service's
+ *		background verifier)
+ */
+struct VerifyRun
+{
+	bool started;						//the INITIAL block has been checked
+	bool allGood;
+	int transCount;
+	uint64_t offset;					//where the next block starts
+	uint64_t lastBlockTime;
+	//hash of the block before the one being checked
+	unsigned char parentHash[BLOCK_PREV_HASH_SIZE];
+	//track all Hashes, it has been expressed that each hash will be unique
+	vector<const unsigned char*> monitoredHash;
+	unordered_set<uint64_t> parentDigests;			//first 8 bytes of each, to skip the scan
+	//track linkage of case/item/states/creator as one record per item
+	vector<VerifyItem> monitoredItems;
+	unordered_multimap<uint64_t, size_t> itemSlots;	//first 8 bytes of each Item ID -> record
+	//records keep their bytes in "arena"; per block scratch comes from "scratch"
+	ScanArena arena;
+	ScanArena scratch;
+	//every block is read whole into this buffer (reused from block to block)
+	vector<unsigned char> wholeBlock;
+	//track the Hash of the bad block and the reason it is bad
+	vector<string> badBlocks;
+	vector<int> failureCondition;
+	//set by the caller, kept by verifyStart
+	bool failFast;						//stop after the first block with a failure
+	bool stream;						//print each failure as it is found
+	//hashes of upcoming blocks worked out ahead by verifyPrehash, in block order
+	vector<uint64_t> hashOffsets;
+	vector<unsigned char> hashes;
+	size_t hashNext;
+};
+
+/**
+ * @dev Description of a failed verification condition
+ */
+const char* verifyFailureText( int condition )
+{
+	switch( condition )
+	{
+		case 1:
+				return "Invalid INITIAL block fields";
+		case 2:
+				return "Previous Hash block content does not match parent block hash";
+		case 3:
+				return "2 Blocks have same parent Hash";
+		case 4:
+				return "Time not strictly increasing block chain events";
+		case 5:
+				return "Case ID changed for Evidence Item";
+		case 6:
+				return "Creator changed for Evidence Item";
+		case 7:
+				return "Evidence Item had invalid State Change";
+		case 8:
+				return "Incomplete block detected at end of file";
+	}
+	return "";
+}
+
+/**
+ * @dev Exit code of a failed condition. Each class of failure has its own
+ *		code, one more than its condition number (2 to 9). 1 is left for a
+ *		chain that could not be checked at all.
+ */
+int verifyExitCode( int condition )
+{
+	if( (condition < 1) || (condition > 8) )
+	{
+		return 1;
+	}
+	return condition + 1;
+}
+
+/**
+ * @dev Log a failed condition for the block at "offset", printing it at once
+ *		as a JSON line when the run streams
+ */
+void verifyRecord( VerifyRun &run, uint64_t offset, const string &blockHash, int condition )
+{
+	run.badBlocks.push_back( blockHash );
+	run.failureCondition.push_back( condition );
+	if( run.stream )
+	{
+		printf("{\"offset\": %llu, \"cursor\": \"%s\", \"hash\": %s%s%s, \"condition\": %d, \"reason\": \"%s\"}\n",
+				(unsigned long long)offset, formatCursor( offset ).c_str(),
+				(0 == blockHash.compare("NULL")) ? "" : "\"", (0 == blockHash.compare("NULL")) ? "null" : blockHash.c_str(),
+				(0 == blockHash.compare("NULL")) ? "" : "\"", condition, verifyFailureText( condition ));
+		fflush( stdout );
+	}
+}
+
+/**
+ * @dev Whether an item may go from one state to the next
+ *		(Checkin > Checkout || Checkout > Checkin || Checkin > Removed)
+ */
+bool verifyStateChange( int previous, int next )
+{
+	if( CHECKEDIN == previous )
+	{
+		//previously CHECKEDIN
+		//Allowable next states: CHECKEDOUT, DESTROYED, DISPOSED, RELEASED
+		return (CHECKEDOUT == next) || (DESTROYED == next) || (DISPOSED == next) || (RELEASED == next);
+	}
+	else if( CHECKEDOUT == previous )
+	{
+		//previously CHECKEDOUT
+		//Allowable next states: CHECKEDIN
+		return (CHECKEDIN == next);
+	}
+	//previously DESTROYED, DISPOSED, RELEASED
+	//Allowable next states: N/A (any transition is illegal)
+	return false;
+}
+
+/**
+ * @dev Get a run ready to check a chain from its first block
+ */
+void verifyStart( VerifyRun &run )
+{
+	run.started = false;
+	run.allGood = true;
+	run.transCount = 0;
+	run.offset = 0;
+	run.lastBlockTime = 0;
+	run.monitoredHash.clear();
+	run.parentDigests.clear();
+	run.monitoredItems.clear();
+	run.itemSlots.clear();
+	arenaRelease( run.arena );
+	arenaRelease( run.scratch );
+	run.badBlocks.clear();
+	run.failureCondition.clear();
+	run.hashOffsets.clear();
+	run.hashes.clear();
+	run.hashNext = 0;
+}
+
+/**
+ * @dev Check the blocks from run.offset on
+ * @param endOfChain is where the chain ended when the run was started
+ * @param budget is roughly how many bytes to check before returning
+ * @return true once every complete block before endOfChain has been checked,
+ *		or a fail-fast run has found a failure
+ */
+bool verifyStep( VerifyRun &run, ChainFile &chain, uint64_t endOfChain, uint64_t budget )
+{
+	chainSeek( chain, run.offset );
+	uint64_t stepEnd = (budget > UINT64_MAX - run.offset) ? UINT64_MAX : (run.offset + budget);
+	if( !run.started )
+	{
+		run.started = true;
+		//read the INITIAL block (header & data field), which must end inside the chain
+		if( !chainReadBlock( chain, run.wholeBlock, endOfChain ) )
+		{
+			verifyRecord( run, 0, "NULL", 8 );
+			run.offset = endOfChain;
+			return true;
+		}
+		BlockView initialBlock( &run.wholeBlock[0] );
+		
+		//#1 check the integrity of the INITIAL block
+		bool validIniBlock = true;
+		if( INITIAL != initialBlock.state )
+		{
+			//Initial block is not marked as initial, flag error
+			validIniBlock = false;
+			run.allGood = false;
+		}
+		//after reading the dat field, increment transaction counter
+		run.transCount++;
+		
+		//compute the hash of the INITIAL block
+		hashBlock( initialBlock.raw, initialBlock.size(), run.parentHash );
+		
+		//log if the INITIAL block had errors
+		if( !validIniBlock )
+		{
+			string recomputedHash( (const char*)run.parentHash, BLOCK_PREV_HASH_SIZE );
+			//convert the bytes back to human readable Hash value
+			//for reporting purposes
+			std::stringstream ss;
+			ss << hex;
+			for(int i = 0; i < BLOCK_PREV_HASH_SIZE; ++i)
+			{
+				ss << std::setw(2) << std::setfill('0') << (int)recomputedHash[i];
+			}
+			string stringHash = ss.str();
+			//the report keeps this hash's historical formatting, a stream gets plain hex
+			verifyRecord( run, 0, run.stream ? bytesToByteString( run.parentHash, BLOCK_PREV_HASH_SIZE ) : stringHash, 1 );
+		}
+	}
+	
+	//we need to sequentially check every block to determine the latest
+	//state of this evidence item
+	while( ((chainTell(chain) + BLOCK_MIN_SIZE) <= endOfChain) && (chainTell(chain) < stepEnd) &&
+			!(run.failFast && !run.badBlocks.empty()) )
+	{
+		//scratch from the previous block is no longer needed
+		arenaReset( run.scratch );
+		
+		//read the whole block (header & data field) and parse its fields in place
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, run.wholeBlock, endOfChain ) )
+		{
+			//the Data Length runs past the end: an incomplete (or damaged) block,
+			//which is not read (no specific block to call out). Unlike a few
+			//stray bytes at the end, a whole header means blocks may be missing.
+			run.allGood = false;
+			verifyRecord( run, blockHead, "NULL", 8 );
+			run.offset = endOfChain;
+			return true;
+		}
+		BlockView block( &run.wholeBlock[0] );
+		//after reading the data field, increment transaction counter
+		run.transCount++;
+		
+		
+		//the fields are compared in place, only the decoded values are copied
+		uint64_t tmpTime = block.time;
+		int tmpState = block.state;
+		
+		//--- Verification Checks ---
+		//	2) Previous Hash matches the hash of the parent block
+		//	3) 2 Blocks have same parent Hash
+		//	4) Strictly Increasing Time
+		//	5) Unique Item ID has unchanged Case ID
+		//	6) Unique Item ID has unchanged Creator
+		//	7) Item has appropriate state changes
+		//		(Initial is Checkin || Checkin > Checkout || Checkout > Checkin || Checkin > Removed)
+		
+		//#2
+		bool parentHashMatch = true;
+		if( 0 != memcmp( run.parentHash, block.prevHash(), BLOCK_PREV_HASH_SIZE ) )
+		{
+			parentHashMatch = false;
+			run.allGood = false;
+		}
+		
+		//#3
+		bool uniqueHash = true;
+		uint64_t parentDigest = 0;
+		memcpy( &parentDigest, block.prevHash(), sizeof(parentDigest) );
+		//only a digest seen before can belong to a repeated hash
+		bool digestSeen = (0 != run.parentDigests.count( parentDigest ));
+		for( int i = 0; digestSeen && (i < run.monitoredHash.size()); i++ )
+		{
+			//on match, 2 blocks have same parent
+			if( 0 == memcmp( block.prevHash(), run.monitoredHash[i], BLOCK_PREV_HASH_SIZE ) )
+			{
+				uniqueHash = false;
+				run.allGood = false;
+			}
+		}
+		//in all cases, append the hash to the list of monitored hashes
+		run.monitoredHash.push_back( arenaCopy( run.arena, block.prevHash(), BLOCK_PREV_HASH_SIZE ) );
+		run.parentDigests.insert( parentDigest );
+		
+		//#4
+		bool increasingTime = true;
+		if( run.lastBlockTime > tmpTime )
+		{
+			increasingTime = false;
+			run.allGood = false;
+		}
+		run.lastBlockTime = tmpTime;
+		
+		//#5/6/7
+		bool unchangedCaseId = true;
+		bool unchangedCreator = true;
+		bool validInitialState = true;
+		//check if this item is being tracked yet
+		int itemMonitored = -1;
+		uint64_t itemDigest = 0;
+		memcpy( &itemDigest, block.itemId(), sizeof(itemDigest) );
+		pair<unordered_multimap<uint64_t, size_t>::iterator, unordered_multimap<uint64_t, size_t>::iterator> candidates = run.itemSlots.equal_range( itemDigest );
+		for( unordered_multimap<uint64_t, size_t>::iterator it = candidates.first; it != candidates.second; ++it )
+		{
+			if( idMatch32( block.itemId(), run.monitoredItems[it->second].itemId ) )
+			{
+				itemMonitored = it->second;
+				break;
+			}
+		}
+		if( -1 != itemMonitored )
+		{
+			//item is on the monitoring block, do verification
+			if( 0 != memcmp( block.caseId(), run.monitoredItems[itemMonitored].caseId, BLOCK_CASE_ID_SIZE ) )
+			{
+				unchangedCaseId = false;
+				run.allGood = false;
+			}
+			if( 0 != memcmp( block.creator(), run.monitoredItems[itemMonitored].creator, BLOCK_CREATOR_SIZE ) )
+			{
+				unchangedCreator = false;
+				run.allGood = false;
+			}
+		}
+		else
+		{
+			//first instance of the item, add its values to the list
+			VerifyItem item;
+			item.caseId = arenaCopy( run.arena, block.caseId(), BLOCK_CASE_ID_SIZE );
+			item.itemId = arenaCopy( run.arena, block.itemId(), BLOCK_ITEM_ID_SIZE );
+			item.creator = arenaCopy( run.arena, block.creator(), BLOCK_CREATOR_SIZE );
+			item.state = tmpState;
+			run.itemSlots.insert( make_pair( itemDigest, run.monitoredItems.size() ) );
+			run.monitoredItems.push_back( item );
+			//partial check of #7, check initial value is CHECKEDIN
+			if( CHECKEDIN != tmpState )
+			{
+				validInitialState = false;
+				run.allGood = false;
+			}
+		}
+		
+		//#7
+		//leverage previous check for item existence in moitoring yet
+		bool validStateChange = true;
+		if( (-1 != itemMonitored) && (validInitialState) )
+		{
+			validStateChange = verifyStateChange( run.monitoredItems[itemMonitored].state, tmpState );
+			if( !validStateChange )
+			{
+				//there was an invalid state change
+				run.allGood = false;
+			}
+			//in all cases, update the monitored state to what was read
+			run.monitoredItems[itemMonitored].state = tmpState;
+		}
+		
+		// --- End of Verification ---
+		
+		//compute the hash of this block to compare to the next block's Previous Hash
+		//(unless it was worked out ahead)
+		if( (run.hashNext < run.hashOffsets.size()) && (run.hashOffsets[run.hashNext] == blockHead) )
+		{
+			memcpy( run.parentHash, &run.hashes[BLOCK_PREV_HASH_SIZE * run.hashNext++], BLOCK_PREV_HASH_SIZE );
+		}
+		else
+		{
+			hashBlock( block.raw, block.size(), run.parentHash );
+		}
+		
+		//convert the bytes back to human readable Hash value
+		//for reporting purposes
+		char* stringHash = (char*)arenaAlloc( run.scratch, 2 * BLOCK_PREV_HASH_SIZE + 1 );
+		for(int i = 0; i < BLOCK_PREV_HASH_SIZE; ++i)
+		{
+			snprintf( &stringHash[2 * i], 3, "%02x", run.parentHash[i] );
+		}
+		
+		//Catalog all failures for this Block
+		if( !parentHashMatch )
+		{
+			verifyRecord( run, blockHead, stringHash, 2 );
+		}
+		if( !uniqueHash )
+		{
+			verifyRecord( run, blockHead, stringHash, 3 );
+		}
+		if( !increasingTime )
+		{
+			verifyRecord( run, blockHead, stringHash, 4 );
+		}
+		if( !unchangedCaseId )
+		{
+			verifyRecord( run, blockHead, stringHash, 5 );
+		}
+		if( !unchangedCreator )
+		{
+			verifyRecord( run, blockHead, stringHash, 6 );
+		}
+		if( (!validStateChange) || (!validInitialState) )
+		{
+			verifyRecord( run, blockHead, stringHash, 7 );
+		}
+		
+	}
+	run.offset = chainTell( chain );
+	return ((chainTell(chain) + BLOCK_MIN_SIZE) > endOfChain) || (run.failFast && !run.badBlocks.empty());
+}
+
+/**
+ * @dev Close a run that has checked every block: no incomplete blocks may
+ *		exist, meaning the end of the last block equals end of file
+ */
+void verifyFinish( VerifyRun &run, uint64_t endOfChain )
+{
+	if( run.offset != endOfChain )
+	{
+		//no specific block to call out
+		verifyRecord( run, run.offset, "NULL", 8 );
+	}
+}
+
+/**
+ * @dev Turn a range bound into a chain offset. A time (in the form the other
+ *		commands print) falls between blocks: a range starting at it begins with
+ *		the first block at or after it, one ending at it stops after the last
+ *		block at or before it. A cursor names a block, which the range starts
+ *		with or ends after.
+ * @param isEnd is true for the end of the range
+ * @return false if the bound is neither a time nor the cursor of a block
+ */
+bool verifyRangeBound( ChainFile &chain, string text, bool isEnd, uint64_t &offset )
+{
+	uint64_t moment = 0;
+	if( string::npos != text.find(':') )
+	{
+		ChainState state;
+		if( !parseTimestamp( text, moment ) || (!isEnd && (0 == moment)) ||
+			!chainStateAsOf( isEnd ? moment : (moment - 1), state, UINT64_MAX ) )
+		{
+			return false;
+		}
+		offset = state.chainEnd;
+		return true;
+	}
+	if( !parseCursor( text, offset ) || !itemIndexSync() || !itemIndexIsBlockStart( offset ) ||
+		(offset >= COC_INDEX.head.chainEnd) )
+	{
+		return false;
+	}
+	if( isEnd )
+	{
+		unsigned char header[BLOCK_MIN_SIZE];
+		chainSeek( chain, offset );
+		chainRead( chain, header, BLOCK_MIN_SIZE );
+		offset += BlockView( header ).size();
+	}
+	return true;
+}
+
+/**
+ * @dev Start a run at "start" with what the blocks before it left behind:
+ *		the state from the nearest checkpoint plus the blocks since gives the
+ *		parent hash, last timestamp and every item's case, creator and state
+ *		(parent hashes seen before the range are not kept, so repeated
+ *		parents are only caught inside the range)
+ */
+void verifySeed( VerifyRun &run, uint64_t start )
+{
+	ChainState state;
+	chainStateAsOf( UINT64_MAX, state, start );
+	run.started = true;
+	run.offset = state.chainEnd;
+	memcpy( run.parentHash, state.tipHash.data(), BLOCK_PREV_HASH_SIZE );
+	run.lastBlockTime = state.lastTime;
+	for( unordered_map<string, ItemState>::iterator it = state.items.begin(); it != state.items.end(); ++it )
+	{
+		VerifyItem item;
+		item.caseId = arenaCopy( run.arena, it->second.caseId, BLOCK_CASE_ID_SIZE );
+		item.itemId = arenaCopy( run.arena, (const unsigned char*)it->first.data(), BLOCK_ITEM_ID_SIZE );
+		item.creator = arenaCopy( run.arena, it->second.creator, BLOCK_CREATOR_SIZE );
+		item.state = it->second.stateCode;
+		uint64_t itemDigest = 0;
+		memcpy( &itemDigest, item.itemId, sizeof(itemDigest) );
+		run.itemSlots.insert( make_pair( itemDigest, run.monitoredItems.size() ) );
+		run.monitoredItems.push_back( item );
+	}
+}
+
+/**
+ * @dev Blocks hashed ahead per window of a parallel verify (32 bytes of hash each)
+ */
+const uint64_t VERIFY_PREHASH_BLOCKS = 16384;
+
+/**
+ * @dev Hash one thread's share of a prehash window: entries [from, to) of run->hashOffsets
+ */
+void verifyHashShare( string chainFile, VerifyRun* run, size_t from, size_t to )
+{
+	//this thread reads the chain through its own handle
+	COC_FILE = chainFile;
+	ChainFile chain;
+	chainOpen( chain );
+	vector<unsigned char> wholeBlock;
+	for( size_t i = from; i < to; i++ )
+	{
+		chainSeek( chain, run->hashOffsets[i] );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			//left for verifyStep to read and report
+			run->hashOffsets[i] = UINT64_MAX;
+			continue;
+		}
+		BlockView block( &wholeBlock[0] );
+		hashBlock( block.raw, block.size(), &run->hashes[BLOCK_PREV_HASH_SIZE * i] );
+	}
+	chainClose( chain );
+}
+
+/**
+ * @dev Hash blocks [firstBlock, firstBlock + count) ahead of verifyStep, split
+ *		evenly across threads. The index entries are fixed width, so every
+ *		thread's share is found by block number without scanning to it.
+ * @return false if the index could not be read (the run then hashes as it goes)
+ */
+bool verifyPrehash( VerifyRun &run, uint64_t firstBlock, uint64_t count, unsigned int threads )
+{
+	vector<IndexEntry> entries( count );
+	run.hashOffsets.clear();
+	run.hashNext = 0;
+	if( !preadFull( COC_INDEX.fd, &entries[0], count * sizeof(IndexEntry), sizeof(IndexHeader) + firstBlock * sizeof(IndexEntry) ) )
+	{
+		return false;
+	}
+	run.hashOffsets.resize( count );
+	run.hashes.resize( count * BLOCK_PREV_HASH_SIZE );
+	for( uint64_t i = 0; i < count; i++ )
+	{
+		run.hashOffsets[i] = entries[i].offset;
+	}
+	vector<thread> workers;
+	for( unsigned int t = 0; t < threads; t++ )
+	{
+		workers.push_back( thread( verifyHashShare, COC_FILE, &run, (size_t)(count * t / threads), (size_t)(count * (t + 1) / threads) ) );
+	}
+	for( size_t t = 0; t < workers.size(); t++ )
+	{
+		workers[t].join();
+	}
+	return true;
+}
+
+/**
+ * @dev The report verify prints: the transaction count, CLEAN or ERROR and
+ *		each failure found
+ * @param scope is "blockchain", or "range" for a range check
+ */
+void verifyReport( VerifyRun &run, const char* scope, bool clean, string &out )
+{
+	char entry[256];
+	snprintf( entry, sizeof(entry), "Transactions in %s: %d\nState of blockchain: %s\n",
+				scope, run.transCount, clean ? "CLEAN" : "ERROR" );
+	out += entry;
+	for( size_t i = 0; !clean && (i < run.badBlocks.size()); i++ )
+	{
+		//the hash of the block with the error and a description of the error
+		out += "Bad block: " + run.badBlocks[i] + "\n";
+		out += verifyFailureText( run.failureCondition[i] );
+		out += "\n\n";
+	}
+}
+
+/**
+ * @dev Verify method that will check the blockchain for a set of potential errors
+ * @param failFast stops at the first block with a failure
+ * @param stream prints each failure as a JSON line as soon as it is found
+ * @param fromText/toText (optional) limit the check to a range of blocks, given
+ *		as times or cursors (see verifyRangeBound)
+ * @return 0 if clean, otherwise the exit code of the first failure's class
+ *		(see verifyExitCode)
+ */
+int verify( bool failFast, bool stream, string fromText, string toText )
+{
+	int result = 0;
+	//verify only reads the chain, range lookups and parallel hashing included
+	COC_READ_ONLY = true;
+	VerifyRun run = VerifyRun();
+	run.failFast = failFast;
+	run.stream = stream;
+	verifyStart( run );
+	//confirm the file exists before attempting to read it
+	if( fileExists() )
+	{
+		//get the current contents of the blockchain
+		ChainFile chain;
+		chainOpen( chain );
+		//store the end of the chain location
+		uint64_t endOfChain = chainSize( chain );
+		//a range is checked from the state the blocks before it left behind
+		uint64_t rangeStart = 0;
+		uint64_t rangeEnd = endOfChain;
+		bool ranged = (0 != fromText.size() + toText.size());
+		if( ((0 != fromText.size()) && !verifyRangeBound( chain, fromText, false, rangeStart )) ||
+			((0 != toText.size()) && !verifyRangeBound( chain, toText, true, rangeEnd )) ||
+			(ranged && (rangeStart >= rangeEnd)) )
+		{
+			printf("Invalid range\n");
+			chainClose( chain );
+			return 1;
+		}
+		if( rangeStart > 0 )
+		{
+			verifySeed( run, rangeStart );
+		}
+		//hashing dominates a long check, so with more than one core the blocks are
+		//hashed ahead a window at a time by all of them (BCHOC_THREADS sets how many)
+		unsigned int threads = thread::hardware_concurrency();
+		if( (NULL != getenv("BCHOC_THREADS")) && (atoi( getenv("BCHOC_THREADS") ) > 0) )
+		{
+			threads = atoi( getenv("BCHOC_THREADS") );
+		}
+		bool done = false;
+		if( (threads > 1) && itemIndexSync() )
+		{
+			uint64_t firstBlock = itemIndexLowerBound( rangeStart );
+			//the INITIAL block is checked on its own
+			firstBlock = max( firstBlock, (uint64_t)1 );
+			IndexEntry entry;
+			while( !done && (firstBlock < COC_INDEX.head.blockCount) &&
+					itemIndexEntry( firstBlock, entry ) && (entry.offset < rangeEnd) )
+			{
+				uint64_t count = min( VERIFY_PREHASH_BLOCKS, COC_INDEX.head.blockCount - firstBlock );
+				if( !verifyPrehash( run, firstBlock, count, threads ) )
+				{
+					break;
+				}
+				//check up to the start of the next window
+				uint64_t windowEnd = COC_INDEX.head.chainEnd;
+				if( itemIndexEntry( firstBlock + count, entry ) )
+				{
+					windowEnd = entry.offset;
+				}
+				done = verifyStep( run, chain, rangeEnd, (windowEnd > run.offset) ? (windowEnd - run.offset) : 0 );
+				firstBlock += count;
+			}
+			run.hashOffsets.clear();
+		}
+		if( !done )
+		{
+			verifyStep( run, chain, rangeEnd, UINT64_MAX );
+		}
+		//a fail-fast run that stopped early has not reached the end of the file,
+		//and neither has a range that stops short of it
+		if( !(failFast && !run.badBlocks.empty()) && (rangeEnd == endOfChain) )
+		{
+			verifyFinish( run, endOfChain );
+		}
+		chainClose( chain );
+	}
+	else
+	{
+		printf("File not found\n");
+	}
+	arenaRelease( run.arena );
+	arenaRelease( run.scratch );
+	
+	/*
+		CONDITIONS VERIFIED
+		1) Invalid INITIAL block
+		2) Previous Hash field matches the hash of the parent block
+		3) 2 Blocks have same parent block hash
+		4) Strictly Increasing Time
+		5) Unique Item ID has unchanged Case ID
+		6) Unique Item ID has unchanged Creator
+		7) Item has appropriate state changes
+		8) Trailing bytes near end of file (incomplete block risk)
+	*/
+	if( (failFast || stream) && !run.failureCondition.empty() )
+	{
+		//every failure counts here, an incomplete last block included
+		result = verifyExitCode( run.failureCondition[0] );
+	}
+	if( stream )
+	{
+		printf("{\"transactions\": %d, \"state\": \"%s\", \"status\": %d}\n",
+				run.transCount, (0 == result) ? "CLEAN" : "ERROR", result);
+		return result;
+	}
+	//print how many transactions are in the blockchain (or the range)
+	const char* scope = (0 != fromText.size() + toText.size()) ? "range" : "blockchain";
+	string report;
+	if( failFast && (0 != result) )
+	{
+		verifyReport( run, scope, false, report );
+	}
+	else if( run.allGood )
+	{
+		verifyReport( run, scope, true, report );
+	}
+	else
+	{
+		//Errors were detected
+		result = run.failureCondition.empty() ? 1 : verifyExitCode( run.failureCondition[0] );
+		verifyReport( run, scope, false, report );
+	}
+	fwrite( report.data(), 1, report.size(), stdout );
+	
+	return result;
+}
+
+/**
+ * @dev Re-verify a single sealed segment on its own. The hash linkage, time
+ *		ordering and block framing are checked against the boundary hashes and
+ *		summary recorded in the manifest when the segment was sealed, so a long
+ *		verification can be resumed (or split up) segment by segment.
+ * @param segIndex is the index of the sealed segment to check
+ */
+int verifySegment( int segIndex )
+{
+	int result = 0;
+	ChainFile chain;
+	if( !chainOpen( chain ) )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	if( (segIndex < 0) || (segIndex >= (int)chain.segs.size() - 1) )
+	{
+		printf("Segment %d is not a sealed segment\n", segIndex);
+		chainClose( chain );
+		return 1;
+	}
+	ChainSegment seg = chain.segs[segIndex];
+	//the first block must link to the end of the previous segment
+	string expectedPrevHash = string( BLOCK_PREV_HASH_SIZE * 2, '0' );
+	if( segIndex > 0 )
+	{
+		expectedPrevHash = chain.segs[segIndex - 1].lastHash;
+	}
+	vector<string> failures;
+	if( 0 != seg.firstPrevHash.compare( expectedPrevHash ) )
+	{
+		failures.push_back("Segment does not link to the previous segment");
+	}
+	
+	string recomputedHash = "";
+	uint64_t lastBlockTime = 0;
+	uint64_t blockCount = 0;
+	uint64_t minTime = 0;
+	uint64_t maxTime = 0;
+	uint64_t segEnd = seg.base + seg.length;
+	vector<unsigned char> wholeBlock;
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	chainSeek( chain, seg.base );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= segEnd )
+	{
+		if( !chainReadBlock( chain, wholeBlock, segEnd ) )
+		{
+			//data field runs past the end of the segment
+			chainSkip( chain, BlockView( &wholeBlock[0] ).dataLen );
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		uint64_t blockTime = block.time;
+		string prevHash = bytesToByteString( block.prevHash(), BLOCK_PREV_HASH_SIZE );
+		if( (0 == blockCount) && (0 != prevHash.compare( seg.firstPrevHash )) )
+		{
+			failures.push_back("First block does not match the recorded boundary hash");
+		}
+		if( (blockCount > 0) && (0 != prevHash.compare( recomputedHash )) )
+		{
+			failures.push_back("Previous Hash block content does not match parent block hash");
+		}
+		if( lastBlockTime > blockTime )
+		{
+			failures.push_back("Time not strictly increasing block chain events");
+		}
+		lastBlockTime = blockTime;
+		if( 0 == blockCount )
+		{
+			minTime = blockTime;
+		}
+		minTime = min( minTime, blockTime );
+		maxTime = max( maxTime, blockTime );
+		hashBlock( block.raw, block.size(), blockHash );
+		recomputedHash = bytesToByteString( blockHash, BLOCK_PREV_HASH_SIZE );
+		blockCount++;
+	}
+	chainClose( chain );
+	
+	if( chainTell(chain) != segEnd )
+	{
+		failures.push_back("Incomplete block detected at end of segment");
+	}
+	if( 0 != recomputedHash.compare( seg.lastHash ) )
+	{
+		failures.push_back("Last block does not match the recorded boundary hash");
+	}
+	if( (blockCount != seg.blockCount) || (minTime != seg.minTime) || (maxTime != seg.maxTime) )
+	{
+		failures.push_back("Segment contents do not match the recorded summary");
+	}
+	
+	printf("Transactions in segment: %llu\n", (unsigned long long)blockCount);
+	if( 0 == failures.size() )
+	{
+		printf("State of segment: CLEAN\n");
+	}
+	else
+	{
+		result = 1;
+		printf("State of segment: ERROR\n");
+		for( size_t i = 0; i < failures.size(); i++ )
+		{
+			printf("%s\n", failures[i].c_str());
+		}
+	}
+	return result;
+}
+
+//blocks at the end of the chain that "verify --sample" always checks
+const uint64_t SAMPLE_TAIL_BLOCKS = 1024;
+
+/**
+ * @dev Check one block against its neighbours, using the item index to find
+ *		them: it must be followed by the next block with no gap, the next
+ *		block's Previous Hash must match its hash and time must not go back;
+ *		against the item's previous block it must keep the Case ID and Creator
+ *		and make a valid state change
+ * @param blockNumber is the block to check (the index covers the whole chain)
+ * @param badBlocks/failureCondition receive the hash of each failing block and
+ *		the condition it failed (see verifyFailureText)
+ */
+void verifySampleBlock( ChainFile &chain, uint64_t blockNumber, vector<string> &badBlocks, vector<int> &failureCondition )
+{
+	vector<unsigned char> wholeBlock;
+	IndexEntry entry;
+	if( !itemIndexEntry( blockNumber, entry ) )
+	{
+		return;
+	}
+	chainSeek( chain, entry.offset );
+	if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+	{
+		return;
+	}
+	BlockView block( &wholeBlock[0] );
+	unsigned char digest[BLOCK_PREV_HASH_SIZE];
+	hashBlock( block.raw, block.size(), digest );
+	string blockHash = bytesToByteString( digest, BLOCK_PREV_HASH_SIZE );
+	if( 0 == blockNumber )
+	{
+		if( INITIAL != block.state )
+		{
+			badBlocks.push_back( blockHash );
+			failureCondition.push_back(1);
+		}
+	}
+	else if( 0 == entry.prevSameItem )
+	{
+		//first block of the item
+		if( CHECKEDIN != block.state )
+		{
+			badBlocks.push_back( blockHash );
+			failureCondition.push_back(7);
+		}
+	}
+	else
+	{
+		IndexEntry previous;
+		unsigned char header[BLOCK_MIN_SIZE];
+		itemIndexEntry( entry.prevSameItem - 1, previous );
+		chainSeek( chain, previous.offset );
+		chainRead( chain, header, BLOCK_MIN_SIZE );
+		BlockView earlier( header );
+		if( 0 != memcmp( block.caseId(), earlier.caseId(), BLOCK_CASE_ID_SIZE ) )
+		{
+			badBlocks.push_back( blockHash );
+			failureCondition.push_back(5);
+		}
+		if( 0 != memcmp( block.creator(), earlier.creator(), BLOCK_CREATOR_SIZE ) )
+		{
+			badBlocks.push_back( blockHash );
+			failureCondition.push_back(6);
+		}
+		if( !verifyStateChange( earlier.state, block.state ) )
+		{
+			badBlocks.push_back( blockHash );
+			failureCondition.push_back(7);
+		}
+	}
+	//the link to the next block is reported against the next block, as verify does
+	IndexEntry next;
+	if( !itemIndexEntry( blockNumber + 1, next ) )
+	{
+		return;
+	}
+	uint64_t blockTime = block.time;
+	chainSeek( chain, next.offset );
+	if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+	{
+		return;
+	}
+	BlockView successor( &wholeBlock[0] );
+	unsigned char successorDigest[BLOCK_PREV_HASH_SIZE];
+	hashBlock( successor.raw, successor.size(), successorDigest );
+	string successorHash = bytesToByteString( successorDigest, BLOCK_PREV_HASH_SIZE );
+	if( ((entry.offset + block.size()) != next.offset) ||
+		(0 != memcmp( successor.prevHash(), digest, BLOCK_PREV_HASH_SIZE )) )
+	{
+		badBlocks.push_back( successorHash );
+		failureCondition.push_back(2);
+	}
+	if( blockTime > successor.time )
+	{
+		badBlocks.push_back( successorHash );
+		failureCondition.push_back(4);
+	}
+}
+
+/**
+ * @dev Spot-check a chain: K blocks picked at random from the item index are
+ *		each checked against their neighbours (see verifySampleBlock), and the
+ *		last SAMPLE_TAIL_BLOCKS blocks are all checked. Reports the share of
+ *		blocks checked and the chance that corruption would have been caught.
+ * @param sampleCount is the number of random blocks to check
+ */
+int verifySample( uint64_t sampleCount )
+{
+	int result = 0;
+	//a spot check only reads the chain
+	COC_READ_ONLY = true;
+	ChainFile chain;
+	if( !fileExists() || !chainOpen( chain ) )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	if( !itemIndexSync() || (0 == COC_INDEX.head.blockCount) )
+	{
+		printf("Index not available\n");
+		chainClose( chain );
+		return 1;
+	}
+	uint64_t blockCount = COC_INDEX.head.blockCount;
+	uint64_t tailStart = (blockCount > SAMPLE_TAIL_BLOCKS) ? (blockCount - SAMPLE_TAIL_BLOCKS) : 0;
+	//pick distinct blocks before the tail (Floyd's algorithm), then visit
+	//them in chain order
+	vector<uint64_t> picked;
+	if( sampleCount >= tailStart )
+	{
+		for( uint64_t n = 0; n < tailStart; n++ )
+		{
+			picked.push_back( n );
+		}
+	}
+	else
+	{
+		random_device seed;
+		mt19937_64 generator( seed() );
+		set<uint64_t> chosen;
+		for( uint64_t j = tailStart - sampleCount; j < tailStart; j++ )
+		{
+			uint64_t n = uniform_int_distribution<uint64_t>( 0, j )( generator );
+			chosen.insert( chosen.count( n ) ? j : n );
+		}
+		picked.assign( chosen.begin(), chosen.end() );
+	}
+	for( uint64_t n = tailStart; n < blockCount; n++ )
+	{
+		picked.push_back( n );
+	}
+	
+	vector<string> badBlocks;
+	vector<int> failureCondition;
+	for( size_t i = 0; i < picked.size(); i++ )
+	{
+		verifySampleBlock( chain, picked[i], badBlocks, failureCondition );
+	}
+	//bytes after the last indexed block are an incomplete block
+	if( COC_INDEX.head.chainEnd != chainSize( chain ) )
+	{
+		badBlocks.push_back("NULL");
+		failureCondition.push_back(8);
+	}
+	chainClose( chain );
+	
+	//chance that b bad blocks all fall among the blocks that were not checked
+	uint64_t checked = picked.size();
+	double missOne = (double)(blockCount - checked) / blockCount;
+	double missPercent = 1.0;
+	uint64_t percentBlocks = (blockCount + 99) / 100;
+	for( uint64_t b = 0; b < percentBlocks; b++ )
+	{
+		missPercent *= (checked + b >= blockCount) ? 0.0 : ((double)(blockCount - checked - b) / (blockCount - b));
+	}
+	printf("Transactions in blockchain: %llu\n", (unsigned long long)blockCount);
+	printf("Blocks checked: %llu (%llu sampled, %llu at the tail)\n", (unsigned long long)checked,
+			(unsigned long long)(checked - (blockCount - tailStart)), (unsigned long long)(blockCount - tailStart));
+	printf("Coverage: %.2f%%\n", 100.0 * checked / blockCount);
+	printf("Chance of catching 1 bad block: %.2f%%\n", 100.0 * (1.0 - missOne));
+	printf("Chance of catching 1%% bad blocks: %.2f%%\n", 100.0 * (1.0 - missPercent));
+	if( 0 == badBlocks.size() )
+	{
+		printf("State of blockchain: CLEAN\n");
+	}
+	else
+	{
+		result = 1;
+		printf("State of blockchain: ERROR\n");
+		for( size_t i = 0; i < badBlocks.size(); i++ )
+		{
+			printf("Bad block: %s\n", badBlocks[i].c_str());
+			printf("%s\n", verifyFailureText( failureCondition[i] ));
+			printf("\n");
+		}
+	}
+	return result;
+}
+
+/**
+ * @dev Copy a byte range between descriptors inside the kernel (copy_file_range),
+ *		falling back to a read/write loop where that is not supported
+ * @return true if every byte was copied
+ */
+bool copyRange( int inFd, uint64_t inOffset, int outFd, uint64_t outOffset, uint64_t len )
+{
+	while( len > 0 )
+	{
+		loff_t inPos = inOffset;
+		loff_t outPos = outOffset;
+		ssize_t moved = copy_file_range( inFd, &inPos, outFd, &outPos, len, 0 );
+		if( moved < 0 && EINTR == errno )
+		{
+			continue;
+		}
+		if( moved <= 0 )
+		{
+			break;
+		}
+		inOffset += moved;
+		outOffset += moved;
+		len -= moved;
+	}
+	vector<unsigned char> buffer;
+	while( len > 0 )
+	{
+		buffer.resize( min( len, (uint64_t)CHAIN_READ_BUFFER ) );
+		ssize_t got = pread( inFd, &buffer[0], buffer.size(), inOffset );
+		if( (got <= 0) || (got != pwrite( outFd, &buffer[0], got, outOffset )) )
+		{
+			return false;
+		}
+		inOffset += got;
+		outOffset += got;
+		len -= got;
+	}
+	return true;
+}
+
+/**
+ * @dev Copy a file to the destination path
+ * @return true on success
+ */
+bool copyFile( string fromPath, string toPath )
+{
+	int inFd = open( fromPath.c_str(), O_RDONLY );
+	if( inFd < 0 )
+	{
+		return false;
+	}
+	int outFd = open( toPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( outFd < 0 )
+	{
+		close( inFd );
+		return false;
+	}
+	bool copied = true;
+	vector<unsigned char> buffer( CHAIN_READ_BUFFER );
+	ssize_t got = 0;
+	while( (got = read( inFd, &buffer[0], buffer.size() )) > 0 )
+	{
+		if( got != write( outFd, &buffer[0], got ) )
+		{
+			copied = false;
+			break;
+		}
+	}
+	if( got < 0 )
+	{
+		copied = false;
+	}
+	fsync( outFd );
+	close( outFd );
+	close( inFd );
+	return copied;
+}
+
+/**
+ * @dev Print one block the way show history does
+ * @param blockHead is the logical offset of the block (the INITIAL block is not encrypted)
+ */
+void printBlock( const BlockView &block, uint64_t blockHead )
+{
+	unsigned char caseId[BLOCK_CASE_ID_SIZE];
+	unsigned char itemId[BLOCK_ITEM_ID_SIZE];
+	memcpy( caseId, block.caseId(), BLOCK_CASE_ID_SIZE );
+	memcpy( itemId, block.itemId(), BLOCK_ITEM_ID_SIZE );
+	if( 0 != blockHead )
+	{
+		//decrypt the case id & item id for human readable output
+		decryptBytes( caseId, BLOCK_CASE_ID_SIZE, false );
+		decryptBytes( itemId, BLOCK_ITEM_ID_SIZE, true );
+	}
+	printHistoryEntry( caseId, itemId, block.stateField(), block.time, 0 == blockHead );
+}
+
+/**
+ * @dev Prints one block by its number (0 is the INITIAL block); the item index
+ *		holds every block's offset, so it is read without scanning to it
+ * @return 1 if the chain has no such block
+ */
+int showBlock( uint64_t blockNumber )
+{
+	//looking a block up only reads the chain
+	COC_READ_ONLY = true;
+	IndexEntry entry;
+	if( !fileExists() || !itemIndexSync() || !itemIndexEntry( blockNumber, entry ) )
+	{
+		printf("Block not found\n");
+		return 1;
+	}
+	ChainFile chain;
+	chainOpen( chain );
+	vector<unsigned char> wholeBlock;
+	chainSeek( chain, entry.offset );
+	bool complete = chainReadBlock( chain, wholeBlock, chainSize(chain) );
+	chainClose( chain );
+	if( !complete )
+	{
+		printf("Block not found\n");
+		return 1;
+	}
+	BlockView block( &wholeBlock[0] );
+	unsigned char blockHash[BLOCK_PREV_HASH_SIZE];
+	hashBlock( block.raw, block.size(), blockHash );
+	string creator( (const char*)block.creator(), strnlen( (const char*)block.creator(), BLOCK_CREATOR_SIZE ) );
+	string owner( (const char*)block.owner(), strnlen( (const char*)block.owner(), BLOCK_OWNER_SIZE ) );
+	printf("Block: %llu\nCursor: %s\nHash: %s\nPrevious Hash: %s\nCreator: %s\nOwner: %s\nData: %u bytes\n",
+				(unsigned long long)blockNumber,
+				formatCursor( entry.offset ).c_str(),
+				bytesToByteString( blockHash, BLOCK_PREV_HASH_SIZE ).c_str(),
+				bytesToByteString( block.prevHash(), BLOCK_PREV_HASH_SIZE ).c_str(),
+				creator.c_str(),
+				owner.c_str(),
+				block.dataLen );
+	printBlock( block, entry.offset );
+	return 0;
+}
+
+/**
+ * @dev Start watching the chain's folder for anything written, created or
+ *		renamed in it (appends, and segments being sealed)
+ * @return the inotify descriptor, or -1
+ */
+int watchChainFolder()
+{
+	string folder = ".";
+	if( string::npos != COC_FILE.find_last_of('/') )
+	{
+		folder = COC_FILE.substr( 0, COC_FILE.find_last_of('/') + 1 );
+	}
+	int notifyFd = inotify_init1( IN_CLOEXEC );
+	if( (notifyFd >= 0) &&
+		(inotify_add_watch( notifyFd, folder.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO ) < 0) )
+	{
+		close( notifyFd );
+		notifyFd = -1;
+	}
+	return notifyFd;
+}
+
+/**
+ * @dev Sleep until the chain's folder changes (re-checking every second regardless)
+ */
+void waitForChainChange( int notifyFd )
+{
+	struct pollfd waitFd;
+	waitFd.fd = notifyFd;
+	waitFd.events = POLLIN;
+	if( poll( &waitFd, 1, 1000 ) > 0 )
+	{
+		char events[4096];
+		read( notifyFd, events, sizeof(events) );
+	}
+}
+
+/**
+ * @dev Stream every block appended to the chain, waiting for appends with
+ *		inotify on the chain's folder (which also sees segments being sealed).
+ *		Blocks are printed only once they are complete, each followed by its
+ *		cursor (the block's start, as everywhere else). Runs until interrupted.
+ * @param inCaseId / inItemId filter the blocks ("" applies no filter)
+ * @param fromCursor is the block to resume after ("" starts at the current end of the chain)
+ */
+int followChain( string inCaseId, string inItemId, string fromCursor )
+{
+	//translate the filters to their stored (encrypted) form
+	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
+	unsigned char tmpItemId[BLOCK_ITEM_ID_SIZE];
+	if( 0 != inCaseId.compare("") )
+	{
+		memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
+		memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
+		encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
+	}
+	if( 0 != inItemId.compare("") )
+	{
+		memset( &tmpItemId[0], 0, BLOCK_ITEM_ID_SIZE );
+		memcpy( &tmpItemId[0], inItemId.c_str(), inItemId.size() );
+		encryptBytes( &tmpItemId[0], BLOCK_ITEM_ID_SIZE, false );
+	}
+	
+	if( !fileExists() || !itemIndexSync() || (0 == COC_INDEX.head.blockCount) )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	//without a cursor, follow on from the last complete block
+	uint64_t lastBlock = COC_INDEX.head.lastBlock;
+	uint64_t position = COC_INDEX.head.chainEnd;
+	if( 0 != fromCursor.compare("") )
+	{
+		//a cursor must name the start of a block, following resumes just past it
+		IndexEntry next;
+		if( !parseCursor( fromCursor, lastBlock ) || !itemIndexIsBlockStart( lastBlock ) ||
+			(lastBlock >= COC_INDEX.head.chainEnd) )
+		{
+			printf("Invalid cursor\n");
+			return 1;
+		}
+		position = itemIndexEntry( itemIndexLowerBound( lastBlock ) + 1, next ) ? next.offset : COC_INDEX.head.chainEnd;
+	}
+	printf("Cursor: %s\n\n", formatCursor( lastBlock ).c_str());
+	fflush( stdout );
+	
+	ChainFile chain;
+	
+	int notifyFd = watchChainFolder();
+	if( notifyFd < 0 )
+	{
+		printf("Unable to watch the blockchain folder\n");
+		return 1;
+	}
+	vector<unsigned char> wholeBlock;
+	while( true )
+	{
+		//print every complete block after the cursor
+		chainOpen( chain );
+		chainSeek( chain, position );
+		while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+		{
+			uint64_t blockHead = chainTell( chain );
+			if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+			{
+				//torn tail, hold it back until the rest of the block arrives
+				break;
+			}
+			position = chainTell( chain );
+			BlockView block( &wholeBlock[0] );
+			if( (0 != inCaseId.compare("")) && !idMatch32( block.caseId(), tmpCaseId ) )
+			{
+				continue;
+			}
+			if( (0 != inItemId.compare("")) && !idMatch32( block.itemId(), tmpItemId ) )
+			{
+				continue;
+			}
+			printBlock( block, blockHead );
+			printf("Cursor: %s\n\n", formatCursor( blockHead ).c_str());
+		}
+		chainClose( chain );
+		fflush( stdout );
+		
+		waitForChainChange( notifyFd );
+	}
+	close( notifyFd );
+	return 0;
+}
+
+/**
+ * @dev Bring a follower chain file up to date with the chain. The follower's
+ *		last block must match the chain's block at the same offset; only the
+ *		complete blocks after it are shipped (inside the kernel), and each one
+ *		must link to its parent once it has arrived.
+ * @return 0 on success, 1 on divergence or failure
+ */
+int replicateOnce( string toPath )
+{
+	if( !itemIndexSync() )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	uint64_t primaryEnd = COC_INDEX.head.chainEnd;
+	int followerFd = open( toPath.c_str(), O_RDWR | O_CREAT, 0644 );
+	struct stat info;
+	if( (followerFd < 0) || (0 != fstat( followerFd, &info )) )
+	{
+		printf("Unable to open follower %s\n", toPath.c_str());
+		return 1;
+	}
+	uint64_t followerEnd = info.st_size;
+	if( followerEnd > primaryEnd )
+	{
+		printf("Follower diverges from the chain: it is longer (%llu bytes)\n", (unsigned long long)followerEnd);
+		close( followerFd );
+		return 1;
+	}
+	//a block the follower only partially received is shipped again, as long
+	//as the part it holds is the start of the chain's block
+	uint64_t blockNumber = itemIndexLowerBound( followerEnd );
+	IndexEntry entry;
+	if( !itemIndexIsBlockStart( followerEnd ) && (blockNumber > 0) && itemIndexEntry( blockNumber - 1, entry ) )
+	{
+		size_t partialLen = followerEnd - entry.offset;
+		vector<unsigned char> followerPart( partialLen );
+		vector<unsigned char> primaryPart( partialLen );
+		ChainFile chain;
+		bool matches = chainOpen( chain );
+		chainSeek( chain, entry.offset );
+		matches = matches && (partialLen == chainRead( chain, &primaryPart[0], partialLen ));
+		chainClose( chain );
+		matches = matches && preadFull( followerFd, &followerPart[0], partialLen, entry.offset ) &&
+					(0 == memcmp( &followerPart[0], &primaryPart[0], partialLen ));
+		if( !matches )
+		{
+			printf("Follower diverges from the chain inside the block at cursor %s\n", formatCursor( entry.offset ).c_str());
+			close( followerFd );
+			return 1;
+		}
+		if( 0 != ftruncate( followerFd, entry.offset ) )
+		{
+			printf("Unable to remove a partial block from follower %s\n", toPath.c_str());
+			close( followerFd );
+			return 1;
+		}
+		printf("Removed %llu bytes of a partial block from the follower\n", (unsigned long long)(followerEnd - entry.offset));
+		followerEnd = entry.offset;
+		blockNumber--;
+	}
+	
+	//the follower's last block must be the chain's block at the same offset
+	unsigned char tipHash[BLOCK_PREV_HASH_SIZE];
+	memset( tipHash, 0, BLOCK_PREV_HASH_SIZE );
+	if( followerEnd > 0 )
+	{
+		IndexEntry tip = { 0, 0 };
+		ChainFile chain;
+		vector<unsigned char> primaryBlock;
+		if( (0 == blockNumber) || !itemIndexEntry( blockNumber - 1, tip ) || !chainOpen( chain ) )
+		{
+			printf("Item index not available\n");
+			close( followerFd );
+			return 1;
+		}
+		chainSeek( chain, tip.offset );
+		bool matches = chainReadBlock( chain, primaryBlock, followerEnd ) && (chainTell(chain) == followerEnd);
+		chainClose( chain );
+		vector<unsigned char> followerBlock( followerEnd - tip.offset );
+		matches = matches && preadFull( followerFd, &followerBlock[0], followerBlock.size(), tip.offset ) &&
+					(0 == memcmp( &followerBlock[0], &primaryBlock[0], followerBlock.size() ));
+		if( !matches )
+		{
+			printf("Follower diverges from the chain at cursor %s\n", formatCursor( tip.offset ).c_str());
+			close( followerFd );
+			return 1;
+		}
+		hashBlock( &followerBlock[0], followerBlock.size(), tipHash );
+	}
+	
+	//ship the new blocks segment by segment
+	ChainFile chain;
+	chainOpen( chain );
+	bool shipped = true;
+	for( size_t i = 0; (i < chain.segs.size()) && shipped; i++ )
+	{
+		ChainSegment &seg = chain.segs[i];
+		uint64_t from = max( followerEnd, seg.base );
+		uint64_t to = min( primaryEnd, seg.base + seg.length );
+		if( from < to )
+		{
+			shipped = copyRange( chain.fds[i], from - seg.base, followerFd, from, to - from );
+		}
+	}
+	chainClose( chain );
+	
+	//check every block as it arrived on the follower
+	uint64_t position = followerEnd;
+	uint64_t blockCount = 0;
+	vector<unsigned char> wholeBlock( BLOCK_MIN_SIZE );
+	while( shipped && (position < primaryEnd) )
+	{
+		shipped = preadFull( followerFd, &wholeBlock[0], BLOCK_MIN_SIZE, position );
+		uint32_t dataLen = BlockView( &wholeBlock[0] ).dataLen;
+		//every shipped block ends inside what was shipped
+		shipped = shipped && (position + BLOCK_MIN_SIZE + dataLen <= primaryEnd);
+		wholeBlock.resize( max( wholeBlock.size(), (size_t)BLOCK_MIN_SIZE + dataLen ) );
+		shipped = shipped && ((0 == dataLen) || preadFull( followerFd, &wholeBlock[BLOCK_MIN_SIZE], dataLen, position + BLOCK_MIN_SIZE ));
+		BlockView block( &wholeBlock[0] );
+		if( shipped && (0 != position) && (0 != memcmp( block.prevHash(), tipHash, BLOCK_PREV_HASH_SIZE )) )
+		{
+			printf("Shipped block at cursor %s does not link to its parent\n", formatCursor( position ).c_str());
+			shipped = false;
+		}
+		hashBlock( block.raw, block.size(), tipHash );
+		position += block.size();
+		blockCount++;
+	}
+	if( !shipped )
+	{
+		//leave the follower as it was
+		if( 0 != ftruncate( followerFd, followerEnd ) )
+		{
+			printf("Unable to cut follower %s back to %llu bytes\n", toPath.c_str(), (unsigned long long)followerEnd);
+		}
+		close( followerFd );
+		printf("Replication failed\n");
+		return 1;
+	}
+	bool durable = (0 == fsync( followerFd ));
+	close( followerFd );
+	if( !durable )
+	{
+		printf("Replication failed: unable to sync follower %s\n", toPath.c_str());
+		return 1;
+	}
+	//the cursor names the follower's last block, as every cursor names a block
+	if( blockCount > 0 )
+	{
+		printf("Shipped %llu blocks (%llu bytes), follower's last block at cursor %s\n", (unsigned long long)blockCount,
+				(unsigned long long)(primaryEnd - followerEnd), formatCursor( COC_INDEX.head.lastBlock ).c_str());
+	}
+	else
+	{
+		printf("Follower is up to date, last block at cursor %s\n", formatCursor( COC_INDEX.head.lastBlock ).c_str());
+	}
+	fflush( stdout );
+	return 0;
+}
+
+/**
+ * @dev Replicate the chain to a follower file once, or keep doing so after
+ *		every append until interrupted (or until replication fails)
+ */
+int replicateChain( string toPath, bool continuous )
+{
+	int result = replicateOnce( toPath );
+	if( continuous && (0 == result) )
+	{
+		int notifyFd = watchChainFolder();
+		if( notifyFd < 0 )
+		{
+			printf("Unable to watch the blockchain folder\n");
+			return 1;
+		}
+		while( 0 == result )
+		{
+			waitForChainChange( notifyFd );
+			//only wake the follower when the chain actually grew
+			if( itemIndexSync() && (COC_INDEX.head.chainEnd != fileSize( toPath )) )
+			{
+				result = replicateOnce( toPath );
+			}
+		}
+		close( notifyFd );
+	}
+	return result;
+}
+
+/**
+ * @dev Merkle accumulator of one chain copy held in memory. diff builds it
+ *		straight from the copy's blocks: a cached ".mmr" only checks its last
+ *		leaf, so on a damaged backup it can be stale, and a comparison of two
+ *		copies must not write files next to them either.
+ */
+struct MerkleMemory
+{
+	vector<unsigned char> nodes;	//MERKLE_NODE_SIZE bytes per node, in MMR position order
+	vector<uint64_t> offsets;		//logical offset of every leaf's block
+	uint64_t chainEnd;				//just past the last complete block
+};
+
+/**
+ * @dev Hash every complete block of "chain" into "mmr" (same layout as ".mmr")
+ */
+void merkleMemoryBuild( ChainFile &chain, MerkleMemory &mmr )
+{
+	mmr.nodes.clear();
+	mmr.offsets.clear();
+	mmr.chainEnd = 0;
+	vector<unsigned char> wholeBlock;
+	unsigned char current[MERKLE_NODE_SIZE];
+	chainSeek( chain, 0 );
+	while( (chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain) )
+	{
+		uint64_t blockHead = chainTell( chain );
+		if( !chainReadBlock( chain, wholeBlock, chainSize(chain) ) )
+		{
+			break;
+		}
+		BlockView block( &wholeBlock[0] );
+		hashBlock( block.raw, block.size(), current );
+		uint64_t index = mmr.offsets.size();
+		mmr.nodes.insert( mmr.nodes.end(), current, current + MERKLE_NODE_SIZE );
+		//every trailing 1 bit of the leaf index completes one more subtree
+		uint64_t pos = mmrSize( index );
+		int height = 0;
+		while( index & 1 )
+		{
+			uint64_t leftPos = pos - ((1ULL << (height + 1)) - 1);
+			merkleParent( &mmr.nodes[leftPos * MERKLE_NODE_SIZE], current, current );
+			mmr.nodes.insert( mmr.nodes.end(), current, current + MERKLE_NODE_SIZE );
+			pos++;
+			height++;
+			index >>= 1;
+		}
+		mmr.offsets.push_back( blockHead );
+		mmr.chainEnd = chainTell( chain );
+	}
+}
+
+/**
+ * @dev Read the block starting at "offset" of a chain
+ * @return false if no whole block starts there
+ */
+bool diffReadBlock( ChainFile &chain, uint64_t offset, vector<unsigned char> &block )
+{
+	if( (offset + BLOCK_MIN_SIZE) > chainSize( chain ) )
+	{
+		return false;
+	}
+	chainSeek( chain, offset );
+	return chainReadBlock( chain, block, chainSize( chain ) );
+}
+
+/**
+ * @dev Print a differing block, falling back to its raw fields when a damaged
+ *		copy holds IDs that cannot be decrypted
+ */
+void diffPrintBlock( const BlockView &block, uint64_t blockHead )
+{
+	try
+	{
+		printBlock( block, blockHead );
+	}
+	catch( exception &e )
+	{
+		printf("Case (raw): %s\nItem (raw): %s\nAction (raw): %s\nTime: %llu\n\n",
+				bytesToByteString( block.caseId(), BLOCK_CASE_ID_SIZE ).c_str(),
+				bytesToByteString( block.itemId(), BLOCK_ITEM_ID_SIZE ).c_str(),
+				bytesToByteString( block.stateField(), BLOCK_STATE_SIZE ).c_str(),
+				(unsigned long long)block.time );
+	}
+}
+
+/**
+ * @dev Find the first block where two copies of a chain differ. A Merkle
+ *		accumulator is built in memory from each copy's blocks, then the peaks
+ *		covering their common length are compared left to right and the search
+ *		descends into the first differing peak, one level per step. Neither
+ *		copy's cached accumulator or index is used, and nothing is written.
+ * @return 0 if the copies are identical, 1 if they differ (or cannot be read)
+ */
+int diffChains( string pathA, string pathB )
+{
+	string chainFile = COC_FILE;
+	ChainFile chainA;
+	ChainFile chainB;
+	COC_FILE = pathB;
+	bool opened = chainOpen( chainB );
+	COC_FILE = pathA;
+	opened = chainOpen( chainA ) && opened;
+	COC_FILE = chainFile;
+	if( !opened )
+	{
+		printf("File not found\n");
+		chainClose( chainA );
+		chainClose( chainB );
+		return 1;
+	}
+	MerkleMemory merkleA;
+	MerkleMemory merkleB;
+	merkleMemoryBuild( chainA, merkleA );
+	merkleMemoryBuild( chainB, merkleB );
+	
+	//descend into the first peak (then child) that differs
+	uint64_t nodeReads = 0;
+	uint64_t leavesA = merkleA.offsets.size();
+	uint64_t leavesB = merkleB.offsets.size();
+	uint64_t common = min( leavesA, leavesB );
+	uint64_t firstLeaf = common;
+	vector<int> heights;
+	vector<uint64_t> positions;
+	mmrPeaks( common, heights, positions );
+	uint64_t leafBase = 0;
+	for( size_t i = 0; i < positions.size(); i++ )
+	{
+		uint64_t pos = positions[i];
+		int height = heights[i];
+		nodeReads += 2;
+		if( 0 == memcmp( &merkleA.nodes[pos * MERKLE_NODE_SIZE], &merkleB.nodes[pos * MERKLE_NODE_SIZE], MERKLE_NODE_SIZE ) )
+		{
+			leafBase += (1ULL << height);
+			continue;
+		}
+		while( height > 0 )
+		{
+			//left child of the node at "pos" is 2^height positions back
+			uint64_t leftPos = pos - (1ULL << height);
+			nodeReads += 2;
+			height--;
+			if( 0 != memcmp( &merkleA.nodes[leftPos * MERKLE_NODE_SIZE], &merkleB.nodes[leftPos * MERKLE_NODE_SIZE], MERKLE_NODE_SIZE ) )
+			{
+				pos = leftPos;
+			}
+			else
+			{
+				pos = pos - 1;
+				leafBase += (1ULL << height);
+			}
+		}
+		firstLeaf = leafBase;
+		break;
+	}
+	
+	//the blocks before "firstLeaf" are identical, so they end at the same offset
+	uint64_t divergeAt = merkleA.chainEnd;
+	if( firstLeaf < leavesA )
+	{
+		divergeAt = merkleA.offsets[firstLeaf];
+	}
+	vector<unsigned char> blockA;
+	vector<unsigned char> blockB;
+	bool hasA = diffReadBlock( chainA, divergeAt, blockA );
+	bool hasB = diffReadBlock( chainB, divergeAt, blockB );
+	int result = 1;
+	if( (leavesA == leavesB) && (firstLeaf == common) && (chainSize( chainA ) == chainSize( chainB )) )
+	{
+		printf("Chains are identical (%llu blocks)\n", (unsigned long long)common);
+		result = 0;
+	}
+	else
+	{
+		printf("First differing block: %llu at cursor %s\n", (unsigned long long)firstLeaf, formatCursor( divergeAt ).c_str());
+		printf("\n%s:\n", pathA.c_str());
+		if( hasA )
+		{
+			diffPrintBlock( BlockView( &blockA[0] ), divergeAt );
+		}
+		else
+		{
+			printf("(end of chain)\n\n");
+		}
+		printf("%s:\n", pathB.c_str());
+		if( hasB )
+		{
+			diffPrintBlock( BlockView( &blockB[0] ), divergeAt );
+		}
+		else
+		{
+			printf("(end of chain)\n\n");
+		}
+	}
+	printf("Merkle nodes read: %llu\n", (unsigned long long)nodeReads);
+	chainClose( chainA );
+	chainClose( chainB );
+	return result;
+}
+
+/**
+ * @dev Back up the chain into a folder. Sealed segments never change, so one
+ *		already present in the backup with the right size is not copied again;
+ *		normally only the active segment and the manifest are written.
+ * @param backupFolder is the folder to copy the chain into
+ */
+int backupChain( string backupFolder )
+{
+	int result = 0;
+	if( !fileExists() )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	mkdir( backupFolder.c_str(), 0777 );
+	if( '/' != backupFolder[backupFolder.size() - 1] )
+	{
+		backupFolder += "/";
+	}
+	vector<ChainSegment> segs;
+	loadSegments( segs );
+	for( size_t i = 0; i < segs.size(); i++ )
+	{
+		string name = segs[i].path.substr( segs[i].path.find_last_of('/') + 1 );
+		string target = backupFolder + name;
+		if( segs[i].sealed && (fileSize( target ) == segs[i].length) )
+		{
+			printf("Unchanged: %s\n", name.c_str());
+			continue;
+		}
+		if( copyFile( segs[i].path, target ) )
+		{
+			printf("Copied: %s\n", name.c_str());
+		}
+		else
+		{
+			printf("Failed to copy: %s\n", name.c_str());
+			result = 1;
+		}
+	}
+	//the manifest goes last so it never names a segment that was not copied
+	string manifestFile = COC_FILE + ".manifest";
+	if( fileSize( manifestFile ) > 0 )
 	{
-		//Confirm we reached here because no blockchain file
-		//exists, and not because the file has a first block that
-		//is something other than INITIAL
-		if( !(fileExists()) )
+		string name = manifestFile.substr( manifestFile.find_last_of('/') + 1 );
+		if( copyFile( manifestFile, backupFolder + name ) )
 		{
-			//INITIAL block does not exist, create one
-			printf("Blockchain file not found. Created INITIAL block\n");
-			//create the folder per BCHOC_FILE_PATH (first check it doesnt already exist)
-			struct stat existence;
-			int idxOfNameStart = -1;
-			for( int i = strlen(COC_FILE.c_str()); i >= 0; i-- )
+			printf("Copied: %s\n", name.c_str());
+		}
+		else
+		{
+			printf("Failed to copy: %s\n", name.c_str());
+			result = 1;
+		}
+	}
+	syncParentFolder( backupFolder );
+	return result;
+}
+
+/**
+ * @dev Write the materialized chain state to "<chain>.snap" so later commands
+ *		only replay the blocks appended after it
+ */
+int snapshotChain()
+{
+	if( !fileExists() )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	//the snapshot also carries the parent digest set for verification
+	COC_STATE.trackParents = true;
+	chainStateSync( COC_STATE );
+	if( COC_STATE.corrupt )
+	{
+		printf("Blockchain corruption detected\n");
+		return 1;
+	}
+	string contents;
+	chainStateSerialize( COC_STATE, contents );
+	if( !writeFileAtomic( COC_FILE + ".snap", contents ) )
+	{
+		printf("Failed to write snapshot\n");
+		return 1;
+	}
+	printf("Snapshot of %llu blocks (%llu items, %llu cases) written: %llu bytes\n",
+			(unsigned long long)COC_STATE.blockCount, (unsigned long long)COC_STATE.items.size(),
+			(unsigned long long)COC_STATE.caseOrder.size(), (unsigned long long)contents.size());
+	return 0;
+}
+
+/**
+ * @dev Convert a hex string back into raw bytes
+ * @return false if the text is not an even number of hex digits
+ */
+bool hexToBytes( const string &hexText, string &bytes )
+{
+	bytes = "";
+	if( 0 != (hexText.size() % 2) )
+	{
+		return false;
+	}
+	for( size_t i = 0; i < hexText.size(); i += 2 )
+	{
+		if( !isxdigit( (unsigned char)hexText[i] ) || !isxdigit( (unsigned char)hexText[i+1] ) )
+		{
+			return false;
+		}
+		bytes.push_back( (char)strtoul( hexText.substr(i, 2).c_str(), NULL, 16 ) );
+	}
+	return true;
+}
+
+/**
+ * @dev Walk the sibling path from leaf "index" up to the peak holding it
+ * @param path receives the siblings, each prefixed by 'L' or 'R' for the side it sits on
+ * @param peakIndex receives which peak (left to right) the leaf belongs to
+ */
+bool merkleInclusionPath( int fd, uint64_t leaves, uint64_t index, vector<string> &path, int &peakIndex )
+{
+	vector<int> heights;
+	vector<uint64_t> positions;
+	mmrPeaks( leaves, heights, positions );
+	uint64_t leafStart = 0;
+	peakIndex = -1;
+	for( size_t i = 0; i < heights.size(); i++ )
+	{
+		if( index < (leafStart + (1ULL << heights[i])) )
+		{
+			peakIndex = i;
+			break;
+		}
+		leafStart += (1ULL << heights[i]);
+	}
+	if( -1 == peakIndex )
+	{
+		return false;
+	}
+	path.clear();
+	uint64_t local = index - leafStart;
+	uint64_t pos = mmrLeafPos( index );
+	for( int level = 0; level < heights[peakIndex]; level++ )
+	{
+		uint64_t subtreeSize = (1ULL << (level + 1)) - 1;
+		unsigned char sibling[MERKLE_NODE_SIZE];
+		string entry = "";
+		if( 0 == ((local >> level) & 1) )
+		{
+			//left child, the sibling is the right subtree
+			if( !merkleReadNode( fd, pos + subtreeSize, sibling ) )
 			{
-				//find the first instance of "/"
-				if( '/' == COC_FILE[i] )
-				{
-					idxOfNameStart = i + 1;
-					i = -1;
-				}
+				return false;
 			}
-			//FILE_PATH includes more than just filename
-			if( -1 != idxOfNameStart )
+			entry = "R";
+			pos = pos + subtreeSize + 1;
+		}
+		else
+		{
+			//right child, the sibling is the left subtree
+			if( !merkleReadNode( fd, pos - subtreeSize, sibling ) )
 			{
-				//take the substring containing the folder path
-				string folderPath = COC_FILE.substr( 0, idxOfNameStart );
-				//if it doesnt exist, create it
-				if( 0 != stat(folderPath.c_str(), &existence) )
-				{
-					mkdir( folderPath.c_str(), 0777 );
-				}
+				return false;
 			}
-			//Initialize the fields (reset 0s everything as deired)
-			resetBlockBytes();
-			//set specific fields
-			//get time of creation
-			blockTimestamp.dblTime = unixTimestamp();;
-			//case-id can remain all 0s
-			//item-id can remain all 0s
-			//set state to INITIAL
-			string setValue = "INITIAL";
-			memcpy( &blockState[0], setValue.c_str(), setValue.size() );
-			//do some ridiculous data manipulation to get the exact bytes "Initial Block\0"
-			setValue = "Initial block";
-			int valByteLen = setValue.size() + 1;
-			unsigned char dataBytes[setValue.size() + 1];
-			for( int i = 0; i < valByteLen; i++ )
+			entry = "L";
+			pos = pos + 1;
+		}
+		entry.append( bytesToByteString( sibling, MERKLE_NODE_SIZE ) );
+		path.push_back( entry );
+	}
+	return true;
+}
+
+/**
+ * @dev Print an inclusion proof for every block of an evidence item. The proof
+ *		holds each block, its leaf number, its O(log n) sibling path and the
+ *		peaks of the tree, so it can be checked against the root without the chain.
+ * @param inItemId is the item to prove
+ */
+int proveItem( string inItemId )
+{
+	if( !fileExists() || !merkleSync() )
+	{
+		printf("File not found\n");
+		return 1;
+	}
+	//encrypt the item to match the blockchain storage
+	unsigned char tmpItemId[BLOCK_ITEM_ID_SIZE];
+	memset( &tmpItemId[0], 0, BLOCK_ITEM_ID_SIZE );
+	memcpy( &tmpItemId[0], inItemId.c_str(), inItemId.size() );
+	encryptBytes( &tmpItemId[0], BLOCK_ITEM_ID_SIZE, false );
+	string itemFilter = "";
+	itemFilter.append( (const char*)&tmpItemId[0], BLOCK_ITEM_ID_SIZE );
+	
+	//find the item's blocks and their leaf numbers
+	vector<RangeFilter> filters;
+	updateRangeFilters( filters );
+	vector<uint64_t> leafList;
+	vector<uint64_t> offsetList;
+	vector<string> blockList;
+	uint64_t leaves = COC_MERKLE.head.leafCount;
+	uint64_t leafIndex = 0;
+	ChainFile chain;
+	chainOpen( chain );
+	while( (leafIndex < leaves) && ((chainTell(chain) + BLOCK_MIN_SIZE) <= chainSize(chain)) )
+	{
+		if( chainSkipUnmatched( chain, filters, "", itemFilter, &leafIndex ) )
+		{
+			continue;
+		}
+		uint64_t blockHead = chainTell( chain );
+		unsigned char header[BLOCK_MIN_SIZE];
+		chainRead( chain, header, BLOCK_MIN_SIZE );
+		BlockView block( header );
+		if( idMatch32( block.itemId(), &tmpItemId[0] ) )
+		{
+			//only the item's own blocks are copied out whole
+			string wholeBlock( (const char*)header, BLOCK_MIN_SIZE );
+			wholeBlock.resize( block.size() );
+			if( block.dataLen > 0 )
 			{
-				dataBytes[i] = '\0';
-				if( i < setValue.size() )
-				{
-					dataBytes[i] = setValue[i];
-				}
+				chainRead( chain, &wholeBlock[BLOCK_MIN_SIZE], block.dataLen );
 			}
-			setValue = "";
-			setValue.append((const char*)&dataBytes[0], valByteLen);
-			blockDataLen.intLen = valByteLen;
-			//create the INITIAL block and append it
-			string initialBlock = blockToString( setValue );
-			//make first entry in file
-			writeToFile( initialBlock );
+			leafList.push_back( leafIndex );
+			offsetList.push_back( blockHead );
+			blockList.push_back( wholeBlock );
 		}
 		else
 		{
-			//else we have a block chain with a 1st block other than an INITIAL
-			result = 1;
+			chainSkip( chain, block.dataLen );
 		}
+		leafIndex++;
 	}
-	return result;
+	chainClose( chain );
+	if( 0 == leafList.size() )
+	{
+		printf("Item not found\n");
+		return 1;
+	}
+	
+	//the peaks are shared by every block in the proof
+	vector<int> heights;
+	vector<uint64_t> positions;
+	mmrPeaks( leaves, heights, positions );
+	string peakText = "";
+	for( size_t i = 0; i < positions.size(); i++ )
+	{
+		unsigned char node[MERKLE_NODE_SIZE];
+		merkleReadNode( COC_MERKLE.fd, positions[i], node );
+		peakText.append( " " );
+		peakText.append( bytesToByteString( node, MERKLE_NODE_SIZE ) );
+	}
+	unsigned char root[MERKLE_NODE_SIZE];
+	merkleRoot( COC_MERKLE.fd, leaves, root );
+	printf("BCHOC-PROOF 1\n");
+	printf("leaves %llu\n", (unsigned long long)leaves);
+	printf("root %s\n", bytesToByteString( root, MERKLE_NODE_SIZE ).c_str());
+	printf("peaks %d%s\n", (int)positions.size(), peakText.c_str());
+	for( size_t i = 0; i < leafList.size(); i++ )
+	{
+		vector<string> path;
+		int peakIndex = 0;
+		merkleInclusionPath( COC_MERKLE.fd, leaves, leafList[i], path, peakIndex );
+		printf("block %llu %llu %s\n", (unsigned long long)leafList[i], (unsigned long long)offsetList[i],
+				bytesToByteString( (const unsigned char*)blockList[i].data(), blockList[i].size() ).c_str());
+		printf("path %d", (int)path.size());
+		for( size_t p = 0; p < path.size(); p++ )
+		{
+			printf(" %s", path[p].c_str());
+		}
+		printf("\n");
+	}
+	return 0;
 }
- 
+
 /**
- * @dev Method to add a new evidence item t othe blockchain
- * @param The case to associate to the item
- * @param The item to attempt to add
- * @param The Creator name to asosciate to the item
+ * @dev Check an inclusion proof written by "prove" without access to the chain
+ * @param proofFile is the proof to check ("-" reads standard input)
+ * @param trustedRoot (optional) is a published root the proof must match
  */
-int addItemToCase( string inCaseId, string inItemId, string inCreator )
+int checkProof( string proofFile, string trustedRoot )
 {
-	//check if method successfully added (0 = success / 1 = failure)
-	int result = 0;
-	//if we add before creating an INITIAL block, create one
-	init();
-	
-	//before attempting to add a block,
-	//clear out any existing data i nthe arrays
-	resetBlockBytes();
-	//prepare item for uniqueness check against entries in blockchain
-	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
-	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
-	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
-	
-	//encrypt the data for simple comparison in the getEvidenceState()
-	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
-	int evidenceState = getEvidenceState( &itemID[0] );
-	if( -1 == evidenceState)
+	ifstream proofStream;
+	istream* input = &cin;
+	if( 0 != proofFile.compare("-") )
 	{
-		//get the time the evidence was added
-		uint64_t timeOfEvent = unixTimestamp();
-		
-		//evidence ID is unique and should be added
-		//Capture timestamp and store
-		blockTimestamp.dblTime = timeOfEvent;
-		//copy Case Id (then encrypt the bytes)
-		memcpy( &blockCaseID[0], inCaseId.c_str(), inCaseId.size() );
-		encryptBytes( &blockCaseID[0], BLOCK_CASE_ID_SIZE, true );
-		//copy Item Id (bytes already encrypted befoer checking evidence state)
-		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
-		//set default state
-		string defaultState = "CHECKEDIN";
-		memcpy( &blockState[0], defaultState.c_str(), defaultState.size() );
-		//copy creator id
-		memcpy( &blockCreator[0], inCreator.c_str(), inCreator.size() );
-		//Owner is left in default empty state
-		//set the data length to 0 since there is no data field value
-		blockDataLen.intLen = 0;
-		
-		//BCHOC does not support comments in the data field during adds
-		string nextBlock = blockToString( "" );
-		//append new block to end
-		writeToFile( nextBlock );
-		
-		//event completed successfully, perform stdout operations
-		printf("Added item: %s\n", inItemId.c_str());
-		printf("Status: CHECKEDIN\n");
-		printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
+		proofStream.open( proofFile.c_str() );
+		if( !proofStream )
+		{
+			printf("Proof file not found\n");
+			return 1;
+		}
+		input = &proofStream;
 	}
-	else
+	bool valid = true;
+	uint64_t leaves = 0;
+	string rootText = "";
+	vector<string> peaks;
+	int blockCount = 0;
+	string line;
+	while( getline( *input, line ) )
 	{
-		printf("Evidence already exists\n");
-		result = 1;
+		stringstream ss( line );
+		string field;
+		ss >> field;
+		if( 0 == field.compare("leaves") )
+		{
+			ss >> leaves;
+		}
+		else if( 0 == field.compare("root") )
+		{
+			ss >> rootText;
+		}
+		else if( 0 == field.compare("peaks") )
+		{
+			int count = 0;
+			ss >> count;
+			peaks.clear();
+			for( int i = 0; i < count; i++ )
+			{
+				string peak;
+				string peakBytes;
+				//every peak is one whole hash
+				if( !(ss >> peak) || !hexToBytes( peak, peakBytes ) || (MERKLE_NODE_SIZE != peakBytes.size()) )
+				{
+					valid = false;
+					break;
+				}
+				peaks.push_back( peakBytes );
+			}
+		}
+		else if( 0 == field.compare("block") )
+		{
+			uint64_t leafIndex = 0;
+			uint64_t offset = 0;
+			string blockHex;
+			ss >> leafIndex >> offset >> blockHex;
+			string wholeBlock;
+			bool wellFormed = hexToBytes( blockHex, wholeBlock );
+			//the path follows on the next line
+			vector<string> path;
+			if( getline( *input, line ) )
+			{
+				stringstream pathStream( line );
+				int count = 0;
+				pathStream >> field >> count;
+				for( int i = 0; i < count; i++ )
+				{
+					string entry;
+					//each entry is a side ('L' or 'R') and a hash
+					if( !(pathStream >> entry) || (entry.size() < 1) )
+					{
+						wellFormed = false;
+						break;
+					}
+					path.push_back( entry );
+				}
+			}
+			blockCount++;
+			
+			//the shape of the path is fixed by the leaf number and tree size
+			vector<int> heights;
+			vector<uint64_t> positions;
+			mmrPeaks( leaves, heights, positions );
+			uint64_t leafStart = 0;
+			int peakIndex = -1;
+			for( size_t i = 0; i < heights.size(); i++ )
+			{
+				if( leafIndex < (leafStart + (1ULL << heights[i])) )
+				{
+					peakIndex = i;
+					break;
+				}
+				leafStart += (1ULL << heights[i]);
+			}
+			bool blockValid = wellFormed && (wholeBlock.size() >= (size_t)BLOCK_MIN_SIZE) && (-1 != peakIndex) &&
+								(peaks.size() == heights.size()) && ((int)path.size() == heights[peakIndex]);
+			if( blockValid )
+			{
+				//climb from the leaf to its peak
+				unsigned char current[MERKLE_NODE_SIZE];
+				memcpy( current, computeHash( wholeBlock ).data(), MERKLE_NODE_SIZE );
+				uint64_t local = leafIndex - leafStart;
+				for( size_t p = 0; p < path.size(); p++ )
+				{
+					string sibling;
+					char expectedSide = ((local >> p) & 1) ? 'L' : 'R';
+					if( (path[p][0] != expectedSide) || !hexToBytes( path[p].substr(1), sibling ) ||
+						(MERKLE_NODE_SIZE != sibling.size()) )
+					{
+						blockValid = false;
+						break;
+					}
+					if( 'R' == expectedSide )
+					{
+						merkleParent( current, (const unsigned char*)sibling.data(), current );
+					}
+					else
+					{
+						merkleParent( (const unsigned char*)sibling.data(), current, current );
+					}
+				}
+				if( blockValid && (0 != peaks[peakIndex].compare( string( (const char*)current, MERKLE_NODE_SIZE ) )) )
+				{
+					blockValid = false;
+				}
+			}
+			
+			//describe the block for the auditor
+			string tmpItem = "";
+			string tmpState = "";
+			uint64_t tmpTime = 0;
+			if( wellFormed && (wholeBlock.size() >= (size_t)BLOCK_MIN_SIZE) )
+			{
+				unsigned char itemBytes[BLOCK_ITEM_ID_SIZE];
+				memcpy( itemBytes, &wholeBlock[BLOCK_ITEM_ID_OFFSET], BLOCK_ITEM_ID_SIZE );
+				decryptBytes( itemBytes, BLOCK_ITEM_ID_SIZE, true );
+				tmpItem = (const char*)itemBytes;
+				tmpItem = tmpItem.substr( 0, BLOCK_ITEM_ID_SIZE );
+				tmpState.append( &wholeBlock[BLOCK_STATE_OFFSET], BLOCK_STATE_SIZE );
+				tmpState = tmpState.c_str();
+				memcpy( &tmpTime, &wholeBlock[BLOCK_TIMESTAMP_OFFSET], BLOCK_TIMESTAMP_SIZE );
+			}
+			printf("Block %llu: %s\nItem: %s\nAction: %s\nTime: %s\n\n", (unsigned long long)leafIndex,
+					blockValid ? "VALID" : "INVALID", tmpItem.c_str(), tmpState.c_str(),
+					translateTimestamp( tmpTime ).c_str() );
+			if( !blockValid )
+			{
+				valid = false;
+			}
+		}
 	}
 	
-	return result;
+	//the peaks must bag up to the claimed root
+	unsigned char root[MERKLE_NODE_SIZE];
+	merkleBagPeaks( leaves, peaks, root );
+	string computedRoot = bytesToByteString( root, MERKLE_NODE_SIZE );
+	if( (0 == blockCount) || (0 != computedRoot.compare( rootText )) )
+	{
+		valid = false;
+	}
+	if( (0 != trustedRoot.compare("")) && (0 != computedRoot.compare( trustedRoot )) )
+	{
+		printf("Proof does not match the trusted root\n");
+		valid = false;
+	}
+	printf("Root: %s (%llu blocks)\n", computedRoot.c_str(), (unsigned long long)leaves);
+	printf("State of proof: %s\n", valid ? "VALID" : "INVALID");
+	return valid ? 0 : 1;
 }
 
+/*
+ * =============
+ * Chain service
+ * =============
+ * "bchoc serve" answers queries for many chains from one long running process
+ * over a Unix socket. Every chain it hosts keeps its materialized ChainState
+ * and item index open between requests, so a query only replays the blocks
+ * appended since the last one. One epoll loop multiplexes all connections and
+ * answers cheap requests inline; heavy requests (a verify, a full history)
+ * and requests whose chain is busy go to a pool of worker threads, whose
+ * replies come back to the loop through an eventfd. A connection's replies
+ * stay in request order: its later lines wait until a handed-off one is
+ * answered. Each chain has its own lock, so requests (and the replay of new
+ * blocks) for one chain are serialized while other chains are served in
+ * parallel. The exception is "state": item states are also published in a
+ * table that is read without the lock, so a lookup is answered at once from
+ * the last published states even while the chain is replaying new blocks.
+ *
+ * With a verify rate set, a background thread re-verifies the hosted chains
+ * over and over, a slice at a time and round robin between chains. It reads
+ * no faster than the rate, keeps its CPU time under the given share of a
+ * core, and stands aside while any request is being answered. Each chain
+ * records how far the current pass has got and the result of the last one.
+ *
+ * When the estimated size of the loaded chains goes over the memory budget,
+ * the least recently used chains are unloaded; they are reloaded from their
+ * snapshot (or the chain) on their next request.
+ *
+ * Requests are single lines: "<chain> <command> [arguments]". A reply is any
+ * number of lines followed by "OK" or "ERROR <reason>". state and history end
+ * with the password the CLI asks for (see serviceAuthorize).
+ *	<chain> state <item_id> -p password			latest case, status, owner and time of an item
+ *	<chain> items <case_id>						items of a case
+ *	<chain> cases								cases in the chain
+ *	<chain> history <item_id> [n] -p password	an item's newest n entries (all by default)
+ *	<chain> verify								the verify command's report (all its checks)
+ *	<chain> verify-status						progress and last result of the background verifier
+ */
 /**
- * @dev This method will attempt to checkout an item if it is in the checkedin state
- * @param The item id to attempt to checkout
- * @param The password will set the owner based on the password used to complete the action
+ * Item states a chain has published for lock-free reads. The thread holding
+ * the chain's lock is the only writer: after every sync it copies the items
+ * the new blocks changed into an open addressing table. Each slot has its own
+ * sequence count (odd while the slot is being written), so a reader copies a
+ * slot and retries only if the count moved underneath it; readers never take
+ * a lock and never wait for the writer to finish applying a burst of blocks.
+ * A table that fills up is replaced by one twice its size; the old one stays
+ * allocated (readers may still be probing it) until the chain is unloaded,
+ * which waits for the reader count to drop to zero.
+ */
+struct ItemSlot
+{
+	atomic<uint32_t> sequence;	//0 while empty, odd while being written
+	unsigned char itemId[BLOCK_ITEM_ID_SIZE];
+	ItemState item;
+};
+
+struct ItemTable
+{
+	uint64_t capacity;			//slot count, a power of two
+	uint64_t used;				//occupied slots (only touched by the writer)
+	ItemSlot* slots;
+};
+
+struct PublishedItems
+{
+	atomic<ItemTable*> current;
+	atomic<uint32_t> readers;	//lookups in progress
+	vector<ItemTable*> retired;	//outgrown tables, freed when the chain is unloaded
+};
+
+/**
+ * @dev Allocate an empty table of "capacity" (a power of two) slots
+ */
+ItemTable* itemTableCreate( uint64_t capacity )
+{
+	ItemTable* table = new ItemTable();
+	table->capacity = capacity;
+	table->used = 0;
+	table->slots = new ItemSlot[capacity]();
+	return table;
+}
+
+/**
+ * @dev Write one item into a table (writer only)
+ */
+void itemTableWrite( ItemTable &table, const unsigned char* itemId, const ItemState &item )
+{
+	uint64_t slot = indexSlotOf( itemId, table.capacity );
+	while( (0 != table.slots[slot].sequence.load( memory_order_relaxed )) &&
+			(0 != memcmp( table.slots[slot].itemId, itemId, BLOCK_ITEM_ID_SIZE )) )
+	{
+		slot = (slot + 1) & (table.capacity - 1);
+	}
+	ItemSlot &target = table.slots[slot];
+	uint32_t sequence = target.sequence.load( memory_order_relaxed );
+	if( 0 == sequence )
+	{
+		table.used++;
+	}
+	target.sequence.store( sequence + 1, memory_order_relaxed );
+	atomic_thread_fence( memory_order_release );
+	memcpy( target.itemId, itemId, BLOCK_ITEM_ID_SIZE );
+	memcpy( &target.item, &item, sizeof(ItemState) );
+	target.sequence.store( sequence + 2, memory_order_release );
+}
+
+/**
+ * @dev Publish the latest state of one item (writer only), moving to a
+ *		bigger table once this one is half full
  */
-int checkoutItem( string inItemId, int checkoutPassword )
+void publishedItemsStore( PublishedItems &published, const string &itemKey, const ItemState &item )
 {
-	//check if method successfully added (0 = success / 1 = failure)
-	int result = 0;
-	//before attempting to checkout an item
-	//clear out any existing data in the arrays
-	resetBlockBytes();
-	//prepare item for check against entries in blockchain
-	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
-	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
-	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
-	
-	//encrypt the data for simple comparison in the getEvidenceState()
-	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
-	int evidenceState = getEvidenceState( &itemID[0] );
-	//operation only permitted if evidence is CHECKEDIN
-	if( CHECKEDIN == evidenceState)
+	ItemTable* table = published.current.load( memory_order_relaxed );
+	if( (NULL == table) || ((table->used + 1) * 2 > table->capacity) )
 	{
-		//get the time the evidence was checked out
-		uint64_t timeOfEvent = unixTimestamp();
-		
-		//evidence Id is valid and in a CHECKEDIN state, make checkout entry
-		//Capture timestamp and store
-		blockTimestamp.dblTime = timeOfEvent;
-		//--getEvidenceState() has already stored the Case Id in the blockCaseId after finding a matching Item ID
-		//Copy the Item ID (already encrypted)
-		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
-		//set checkout state
-		string checkoutState = "CHECKEDOUT";
-		memcpy( &blockState[0], checkoutState.c_str(), checkoutState.size() );
-		//--getEvidenceState() has already stored the Creator in the blockCreator after finding a matching Item ID
-		//Set the owner according to the password used
-		string Owner = "";
-		switch( checkoutPassword )
+		ItemTable* bigger = itemTableCreate( (NULL == table) ? 1024 : (table->capacity * 2) );
+		for( uint64_t i = 0; (NULL != table) && (i < table->capacity); i++ )
 		{
-			case 1: Owner = "POLICE";
-				break;
-			case 2: Owner = "LAWYER";
-				break;
-			case 3: Owner = "ANALYST";
-				break;
-			case 4: Owner = "EXECUTIVE";
-				break;
+			if( 0 != table->slots[i].sequence.load( memory_order_relaxed ) )
+			{
+				itemTableWrite( *bigger, table->slots[i].itemId, table->slots[i].item );
+			}
 		}
-		//reset any lingering data in this block before copying
-		for( int i = 0; i < BLOCK_OWNER_SIZE; i++ )
+		published.current.store( bigger, memory_order_release );
+		if( NULL != table )
 		{
-			blockOwner[i] = '\0';
+			published.retired.push_back( table );
 		}
-		memcpy( &blockOwner[0], Owner.c_str(), Owner.size() );
-		//DataLen is left as 0 and Data field is empty
-		
-		//BCHOC does not support comments in the data field during checkouts
-		string nextBlock = blockToString( "" );
-		//append new block to end
-		writeToFile( nextBlock );
-		
-		//event completed successfully, perform stdout operations
-		string tmpCaseId = "";
-		unsigned char tmpCaseIdBytes[BLOCK_CASE_ID_SIZE];
-		memcpy(&tmpCaseIdBytes[0], &blockCaseID[0], BLOCK_CASE_ID_SIZE);
-		decryptBytes( &tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE, false );
-		tmpCaseId.append((const char*)&tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE);
-		printf("Case: %s\n", tmpCaseId.c_str());
-		printf("Checked out item: %s\n", inItemId.c_str());
-		printf("Status: CHECKEDOUT\n");
-		printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
-	}
-	else
-	{
-		printf("Evidence CANNOT be Checked Out\n");
-		result = 1; //return 1 on error
+		table = bigger;
 	}
-	
-	//return result
-	return result;
+	itemTableWrite( *table, (const unsigned char*)itemKey.data(), item );
 }
 
 /**
- * @dev This item looks for an item, and if it is checked out then it will make a checkin block
- * @param The item to attempt to checkin
- * @param The password used to complete the action will set the Owner field to POLICE/LAWYER/ANALYST/EXECUTIVE
+ * @dev Bring the published table up to date with a freshly synced state
+ *		(writer only): only the items the new blocks touched are copied,
+ *		unless the state was rebuilt, in which case a new table replaces it
  */
-int checkinItem( string inItemId, int checkoutPassword )
+void publishedItemsRefresh( PublishedItems &published, ChainState &state )
 {
-	//check if method successfully added (0 = success / 1 = failure)
-	int result = 0;
-	//before attempting to checkin an item,
-	//clear out any existing data in the arrays
-	resetBlockBytes();
-	//prepare item for check against entries in blockchain
-	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
-	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
-	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
-	
-	//encrypt the data for simple comparison in the getEvidenceState()
-	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
-	int evidenceState = getEvidenceState( &itemID[0] );
-	//operation only permitted if evidence is CHECKEDOUT
-	if( CHECKEDOUT == evidenceState)
+	if( state.allTouched )
 	{
-		//get the time the evidence was checked in
-		uint64_t timeOfEvent = unixTimestamp();
-		
-		//evidence Id is valid and in a CHECKEDOUT state, make checkin entry
-		//Capture timestamp and store
-		blockTimestamp.dblTime = timeOfEvent;
-		//--getEvidenceState() has already stored the Case Id in the blockCaseId after finding a matching Item ID
-		//Copy the Item ID (already encrypted)
-		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
-		//set checkin state
-		string checkinState = "CHECKEDIN";
-		memcpy( &blockState[0], checkinState.c_str(), checkinState.size() );
-		//--getEvidenceState() has already stored the Creator in the blockCreator after finding a matching Item ID
-		//Set the owner according to the password used
-		string Owner = "";
-		switch( checkoutPassword )
+		uint64_t capacity = 1024;
+		while( (state.items.size() + 1) * 2 > capacity )
 		{
-			case 1: Owner = "POLICE";
-				break;
-			case 2: Owner = "LAWYER";
-				break;
-			case 3: Owner = "ANALYST";
-				break;
-			case 4: Owner = "EXECUTIVE";
-				break;
+			capacity *= 2;
 		}
-		//reset any lingering data in this block before copying
-		for( int i = 0; i < BLOCK_OWNER_SIZE; i++ )
+		ItemTable* table = itemTableCreate( capacity );
+		for( unordered_map<string, ItemState>::iterator it = state.items.begin(); it != state.items.end(); ++it )
 		{
-			blockOwner[i] = '\0';
+			itemTableWrite( *table, (const unsigned char*)it->first.data(), it->second );
+		}
+		ItemTable* old = published.current.exchange( table );
+		if( NULL != old )
+		{
+			published.retired.push_back( old );
 		}
-		memcpy( &blockOwner[0], Owner.c_str(), Owner.size() );
-		//DataLen is left as 0 and Data field is empty
-		
-		//BCHOC does not support comments in the data field during checkins
-		string nextBlock = blockToString( "" );
-		//append new block to end
-		writeToFile( nextBlock );
-		
-		//event completed successfully, perform stdout operations
-		string tmpCaseId = "";
-		unsigned char tmpCaseIdBytes[BLOCK_CASE_ID_SIZE];
-		memcpy(&tmpCaseIdBytes[0], &blockCaseID[0], BLOCK_CASE_ID_SIZE);
-		decryptBytes( &tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE, false );
-		tmpCaseId.append((const char*)&tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE);
-		printf("Case: %s\n", tmpCaseId.c_str());
-		printf("Checked out item: %s\n", inItemId.c_str());
-		printf("Status: CHECKEDIN\n");
-		printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
 	}
 	else
 	{
-		printf("Evidence CANNOT be Checked In\n");
-		result = 1;
+		for( size_t i = 0; i < state.touched.size(); i++ )
+		{
+			publishedItemsStore( published, state.touched[i], state.items[state.touched[i]] );
+		}
 	}
-	
-	return result;
+	state.touched.clear();
+	state.allTouched = false;
 }
 
 /**
- * @dev This method "removes" an evidence item from the Chain of Custody by updating its state
- * @param inItemId specifies which item to remove
- * @param removalType is the state change to DESTROYED/DISPOSED/RELEASED
- * @param removalReason is the string to put in the data field for the event (optional for all but RELEASED)
+ * @dev Look an item up without any lock
+ * @return 1 if found (copied into "item"), 0 if not, -1 if nothing is published
  */
-int removeItem( string inItemId, int removalType, string removalReason , int checkoutPassword )
+int publishedItemsLookup( PublishedItems &published, const unsigned char* itemId, ItemState &item )
 {
-	//check if method successfully added (0 = success / 1 = failure)
-	int result = 0;
-	//before attempting to checkin an item,
-	//clear out any existing data in the arrays
-	resetBlockBytes();
-	//prepare item for check against entries in blockchain
-	unsigned char itemID[BLOCK_ITEM_ID_SIZE];
-	memset( &itemID[0], 0, BLOCK_ITEM_ID_SIZE);
-	memcpy( &itemID[0], inItemId.c_str(), inItemId.size() );
-	
-	//encrypt the data for simple comparison in the getEvidenceState()
-	encryptBytes( &itemID[0], BLOCK_ITEM_ID_SIZE, false );
-	int evidenceState = getEvidenceState( &itemID[0] );
-	//operation only permitted if evidence is CHECKEDIN
-	if( CHECKEDIN == evidenceState)
+	int found = -1;
+	published.readers.fetch_add( 1 );
+	ItemTable* table = published.current.load();
+	for( uint64_t slot = (NULL == table) ? 0 : indexSlotOf( itemId, table->capacity ); (NULL != table) && (found < 0); slot = (slot + 1) & (table->capacity - 1) )
 	{
-		//get the time the evidence was removed
-		uint64_t timeOfEvent = unixTimestamp();
-		
-		//evidence Id is valid and in a CHECKEDIN state, make removal entry
-		//Capture timestamp and store
-		blockTimestamp.dblTime = timeOfEvent;
-		//--getEvidenceState() has already stored the Case Id in the blockCaseId after finding a matching Item ID
-		//Copy the Item ID
-		memcpy( &blockItemID[0], &itemID[0], BLOCK_ITEM_ID_SIZE );
-		//set removal state based on argument
-		string removalState = "";
-		switch( removalType )
+		//copy the slot, again if the writer was in it meanwhile
+		ItemSlot &candidate = table->slots[slot];
+		uint32_t before;
+		unsigned char candidateId[BLOCK_ITEM_ID_SIZE];
+		do
 		{
-			case 1: removalState = "DISPOSED";
-				break;
-			case 2: removalState = "DESTROYED";
-				break;
-			case 3: removalState = "RELEASED";
-				break;
+			before = candidate.sequence.load( memory_order_acquire );
+			memcpy( candidateId, candidate.itemId, BLOCK_ITEM_ID_SIZE );
+			memcpy( &item, &candidate.item, sizeof(ItemState) );
+			atomic_thread_fence( memory_order_acquire );
 		}
-		memcpy( &blockState[0], removalState.c_str(), removalState.size() );
-		//--getEvidenceState() has already stored the Creator in the blockCreator after finding a matching Item ID
-		//Leave the Owner field to the last individual to access the evidence
-		//check if a comment has been added to the data field
-		string nextBlock;
-		if( 0 != removalReason.compare("") )
+		while( (before & 1) || (before != candidate.sequence.load( memory_order_relaxed )) );
+		if( 0 == before )
 		{
-			//get the string length
-			blockDataLen.intLen = removalReason.size();
-			//create the block with this addition
-			nextBlock = blockToString( removalReason );
+			found = 0;
 		}
-		else
+		else if( 0 == memcmp( candidateId, itemId, BLOCK_ITEM_ID_SIZE ) )
 		{
-			//DataLen is left as 0 and Data field is empty
-			nextBlock = blockToString( "" );
+			found = 1;
 		}
-		//append new block to end
-		writeToFile( nextBlock );
-		
-		//event completed successfully, perform stdout operations
-		string tmpCaseId = "";
-		unsigned char tmpCaseIdBytes[BLOCK_CASE_ID_SIZE];
-		memcpy(&tmpCaseIdBytes[0], &blockCaseID[0], BLOCK_CASE_ID_SIZE);
-		decryptBytes( &tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE, false );
-		tmpCaseId.append((const char*)&tmpCaseIdBytes[0], BLOCK_CASE_ID_SIZE);
-		printf("Case: %s\n", tmpCaseId.c_str() );
-		printf("Checked out item: %s\n", inItemId.c_str() );
-		printf("Status: %s\n", removalState.c_str() );
-		printf("Time of Action: %s\n", translateTimestamp(timeOfEvent).c_str() );
 	}
-	else
+	published.readers.fetch_sub( 1 );
+	return found;
+}
+
+/**
+ * @dev Withdraw and free every table (writer only), once no reader can hold one
+ */
+void publishedItemsClear( PublishedItems &published )
+{
+	ItemTable* table = published.current.exchange( NULL );
+	while( 0 != published.readers.load() )
 	{
-		printf("Evidence CANNOT be Removed\n");
-		result = 1;
+		this_thread::yield();
 	}
-	
-	return result;
+	if( NULL != table )
+	{
+		published.retired.push_back( table );
+	}
+	for( size_t i = 0; i < published.retired.size(); i++ )
+	{
+		delete[] published.retired[i]->slots;
+		delete published.retired[i];
+	}
+	published.retired.clear();
 }
 
 /**
- * @dev Method that shows all unique cases in the blockchain
+ * @dev Bytes held by the published tables
  */
-void showCases()
+size_t publishedItemsFootprint( PublishedItems &published )
 {
-	//track the list of unique Case IDs
-	vector<string> caseIdList;
-	//confirm the file exists before attempting to read it
-	if( fileExists() )
+	size_t footprint = 0;
+	ItemTable* table = published.current.load( memory_order_relaxed );
+	if( NULL != table )
 	{
-		//store the reads of data
-		unsigned char readCaseId[BLOCK_CASE_ID_SIZE];
-		unsigned int sizeOfBlock = 0;
-		union
-		{
-			unsigned int intLen;
-			unsigned char byteLen[4];
-		} readDataLen;
-		
-		//get the current contents of the blockchain
-		FILE* fPtr;
-		fPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( fPtr, 0, SEEK_SET );
-		//store the end of the file location
-		FILE* endPtr;
-		endPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( endPtr, 0, SEEK_END );
-		
-		//get the state of the first block (SEEK_SET = start of file)
-		fseek( fPtr, BLOCK_DATA_LEN_OFFSET, SEEK_SET );
-		//Compute the offset to read the length of this data field
-		fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-		//advance from the DataLen field to the end of the data field
-		//(recall the "fread" advances the fPtr)
-		fseek( fPtr, readDataLen.intLen, SEEK_CUR );
-		//we need to sequentially check every block to determine the latest
-		//state of this evidence item
-		while( (ftell(fPtr) + BLOCK_MIN_SIZE) <= ftell(endPtr) )
-		{
-			//notice, this method does no verification of blockchain integrity
-			//offset computational support
-			int offsetToNextField = 0;
-			string tmpString = "";
-			
-			//advance from the head of the block to the Case ID field
-			offsetToNextField = BLOCK_CASE_ID_OFFSET;
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readCaseId, sizeof(char), BLOCK_CASE_ID_SIZE, fPtr);
-			//convert the caseId bytes to a string
-			tmpString.append((const char*)&readCaseId[0], BLOCK_CASE_ID_SIZE);
-			//check to see if it should be appended to the list of unique cases
-			bool newCase = true;
-			for( int i = 0; i < caseIdList.size(); i++ )
-			{
-				if( 0 == tmpString.compare( caseIdList[i] ) )
-				{
-					//case id already listed, do not add again
-					newCase = false;
-				}
-			}
-			if( newCase )
-			{
-				caseIdList.push_back(tmpString);
-			}
-			
-			//advance from the end of the case id to the Data Length field
-			offsetToNextField = BLOCK_DATA_LEN_OFFSET - (BLOCK_CASE_ID_OFFSET + BLOCK_CASE_ID_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			//Compute the offset to read the length of this data field
-			fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-			//advance from the DataLen field to the end of the data field
-			//(recall the "fread" advances the fPtr)
-			fseek( fPtr, readDataLen.intLen, SEEK_CUR );
-		}
-		fclose(fPtr);
+		footprint += table->capacity * sizeof(ItemSlot);
 	}
-	
-	//print all found cases
-	for( int i = 0; i < caseIdList.size(); i++ )
+	for( size_t i = 0; i < published.retired.size(); i++ )
 	{
-		//decrypt the data for human readable output
-		decryptBytes( (unsigned char*)caseIdList[i].c_str(), BLOCK_CASE_ID_SIZE, false );
-		caseIdList[i].insert(20, "-");
-		caseIdList[i].insert(16, "-");
-		caseIdList[i].insert(12, "-");
-		caseIdList[i].insert(8, "-");
-		printf("%s\n", caseIdList[i].c_str() );
+		footprint += published.retired[i]->capacity * sizeof(ItemSlot);
 	}
+	return footprint;
 }
 
+//bytes the background verifier checks before it pauses
+const uint64_t VERIFY_SLICE_BYTES = 64 * 1024;
+
+struct ServedChain
+{
+	string path;
+	mutex lock;					//held while the chain is synced or queried
+	ChainState state;
+	ItemIndex index;
+	uint64_t lastUsed;			//service clock at the last request
+	size_t footprint;			//estimated bytes held by the loaded state
+	PublishedItems published;	//item states for lock-free lookups
+	//background verification (the run belongs to the verifier thread, the
+	//rest is guarded by the service lock)
+	VerifyRun background;
+	uint64_t verifyTarget;		//where the chain ended when the current pass started
+	uint64_t verifyOffset;		//how far the current pass has got
+	uint64_t verifyPasses;		//completed passes
+	uint64_t verifyTime;		//when the last pass completed (0 before the first)
+	int verifyBlocks;			//blocks checked by the last pass
+	bool verifyClean;
+	string verifyFailure;		//first failure of the last pass
+};
+
+struct ChainService
+{
+	mutex lock;					//guards the registry, clock and memory total
+	map<string, ServedChain*> chains;
+	string folder;				//chains not named on the command line are looked up here
+	size_t budget;				//bytes the loaded chains may use
+	uint64_t clock;
+	size_t footprint;			//sum of the loaded chains' footprints
+	//requests handed to the workers and their replies, by connection id
+	mutex queueLock;
+	condition_variable queued;
+	deque<pair<uint64_t, string> > jobs;
+	deque<pair<uint64_t, string> > replies;
+	int wakeFd;					//eventfd the workers signal the loop with
+	//background verifier budget and the requests it stands aside for
+	uint64_t verifyRate;		//bytes per second (0 turns the verifier off)
+	int verifyCpu;				//percent of one core
+	atomic<uint32_t> inFlight;	//requests being answered
+};
+
+struct ServiceClient
+{
+	int fd;
+	string input;				//received bytes not yet answered
+	string output;				//replies not yet sent
+	bool waiting;				//a worker is answering this client's oldest line
+	bool closing;				//the client hung up or the socket failed
+};
+
 /**
- * @dev This method prints all Evidence items associated to the specified case
- * @param the case to find all items for
+ * @dev Rough number of bytes held by a materialized chain state
  */
-void showItems( string inCaseId )
+size_t chainStateFootprint( ChainState &state )
 {
-	//track the list of unique item IDs for this case
-	vector<string> itemIdList;
-	//translate input to a full length string for proper comparisons
-	//This is because when reading from the byte array the string will always
-	//be of length 32 (even if it is only "1234"). We need to translate the
-	//input to be length 32 otherwise comparison will flag false by string
-	//length even if its contents are matching
-	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
-	memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
-	memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
-	//then we need to encrypt the bytes to match the blockchain sotrage
-	encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
-	inCaseId = "";
-	inCaseId.append((const char*)&tmpCaseId[0], BLOCK_CASE_ID_SIZE);
-	//confirm the file exists before attempting to read it
-	if( fileExists() )
+	return state.items.size() * (sizeof(ItemState) + 2 * BLOCK_ITEM_ID_SIZE + 64) +
+			state.caseItemSeen.size() * (BLOCK_CASE_ID_SIZE + BLOCK_ITEM_ID_SIZE + 32) +
+			state.caseOrder.size() * (2 * BLOCK_CASE_ID_SIZE + 64) +
+			state.parentDigests.size() * 32;
+}
+
+/**
+ * @dev Find (or register) the chain a request names
+ * @return NULL if the service does not host it
+ */
+ServedChain* serviceChain( ChainService &service, const string &name )
+{
+	lock_guard<mutex> guard( service.lock );
+	map<string, ServedChain*>::iterator found = service.chains.find( name );
+	if( found != service.chains.end() )
 	{
-		//store the reads of data
-		unsigned char readCaseId[BLOCK_CASE_ID_SIZE];
-		unsigned char readItemId[BLOCK_ITEM_ID_SIZE];
-		unsigned int sizeOfBlock = 0;
-		union
-		{
-			unsigned int intLen;
-			unsigned char byteLen[4];
-		} readDataLen;
-		
-		//get the current contents of the blockchain
-		FILE* fPtr;
-		fPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( fPtr, 0, SEEK_SET );
-		//store the end of the file location
-		FILE* endPtr;
-		endPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( endPtr, 0, SEEK_END );
-		
-		//get the state of the first block (SEEK_SET = start of file)
-		fseek( fPtr, BLOCK_DATA_LEN_OFFSET, SEEK_SET );
-		//Compute the offset to read the length of this data field
-		fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-		//advance from the DataLen field to the end of the data field
-		//(recall the "fread" advances the fPtr)
-		fseek( fPtr, readDataLen.intLen, SEEK_CUR );
-		//we need to sequentially check every block to determine the latest
-		//state of this evidence item
-		while( (ftell(fPtr) + BLOCK_MIN_SIZE) <= ftell(endPtr) )
+		return found->second;
+	}
+	//only plain file names inside the folder may be served
+	if( (0 == service.folder.size()) || (0 == name.size()) || ('.' == name[0]) ||
+		(string::npos != name.find('/')) || !fileSize( service.folder + name ) )
+	{
+		return NULL;
+	}
+	ServedChain* chain = new ServedChain();
+	chain->path = service.folder + name;
+	chain->state.loaded = false;
+	chain->index.fd = -1;
+	chain->index.headFd = -1;
+	chain->index.checked = false;
+	chain->state.trackTouched = true;
+	chain->lastUsed = 0;
+	chain->footprint = 0;
+	chain->background.started = false;
+	chain->verifyTarget = 0;
+	chain->verifyOffset = 0;
+	chain->verifyPasses = 0;
+	service.chains[name] = chain;
+	return chain;
+}
+
+/**
+ * @dev Unload the least recently used chains until the loaded ones fit the budget
+ *		(chains busy with a request are left alone)
+ */
+void serviceEvict( ChainService &service )
+{
+	lock_guard<mutex> guard( service.lock );
+	while( service.footprint > service.budget )
+	{
+		ServedChain* coldest = NULL;
+		for( map<string, ServedChain*>::iterator it = service.chains.begin(); it != service.chains.end(); it++ )
 		{
-			//notice, this method does no verification of blockchain integrity
-			//offset computational support
-			int offsetToNextField = 0;
-			string tmpCase = "";
-			string tmpItem = "";
-			
-			//advance from the head of the block to the Case ID field
-			offsetToNextField = BLOCK_CASE_ID_OFFSET;
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readCaseId, sizeof(char), BLOCK_CASE_ID_SIZE, fPtr);
-			//convert the caseId bytes to a string
-			tmpCase.append((const char*)&readCaseId[0], BLOCK_CASE_ID_SIZE);
-			//advance from the Case ID to the Item ID field
-			offsetToNextField = BLOCK_ITEM_ID_OFFSET - (BLOCK_CASE_ID_OFFSET + BLOCK_CASE_ID_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readItemId, sizeof(char), BLOCK_ITEM_ID_SIZE, fPtr);
-			//convert the caseId bytes to a string
-			tmpItem.append((const char*)&readItemId[0], BLOCK_ITEM_ID_SIZE);
-			//check to see if it should be appended to the list of unique items
-			bool newItem = true;
-			for( int i = 0; i < itemIdList.size(); i++ )
-			{
-				if( 0 == tmpItem.compare( itemIdList[i] ) )
-				{
-					//case id already listed, do not add again
-					newItem = false;
-				}
-			}
-			//confirm its a new item for the proper case
-			if( (newItem) && (0 == tmpCase.compare(inCaseId)) )
+			if( (it->second->footprint > 0) && ((NULL == coldest) || (it->second->lastUsed < coldest->lastUsed)) )
 			{
-				itemIdList.push_back(tmpItem);
+				coldest = it->second;
 			}
-			
-			//advance from the end of the item id to the Data Length field
-			offsetToNextField = BLOCK_DATA_LEN_OFFSET - (BLOCK_ITEM_ID_OFFSET + BLOCK_ITEM_ID_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			//Compute the offset to read the length of this data field
-			fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-			//advance from the DataLen field to the end of the data field
-			//(recall the "fread" advances the fPtr)
-			fseek( fPtr, readDataLen.intLen, SEEK_CUR );
 		}
-		fclose(fPtr);
-	}
-	
-	//print all found cases
-	for( int i = 0; i < itemIdList.size(); i++ )
-	{
-		//decrypt the data for human readable output
-		decryptBytes( (unsigned char*)itemIdList[i].c_str(), BLOCK_ITEM_ID_SIZE, true );
-		printf("%s\n", itemIdList[i].c_str() );
+		if( (NULL == coldest) || !coldest->lock.try_lock() )
+		{
+			return;
+		}
+		chainStateReset( coldest->state );
+		coldest->state.loaded = false;
+		publishedItemsClear( coldest->published );
+		if( coldest->index.fd >= 0 )
+		{
+			close( coldest->index.fd );
+			close( coldest->index.headFd );
+		}
+		coldest->index.fd = -1;
+		coldest->index.headFd = -1;
+		coldest->index.checked = false;
+		service.footprint -= coldest->footprint;
+		coldest->footprint = 0;
+		coldest->lock.unlock();
 	}
 }
 
 /**
- * @dev Show's the individual blocks in the blockchain
- * @param inCaseId is an argument to filter the history by a specific Case ("" applies no filter)
- * @param inItemId is an argument to filter the history by a specific item ("" applies no filter)
- * @param numEntries defines how many entries to print (-1 prints all)
- * @param By default it prints oldest to newest, but reverse=true prints newest to oldest
+ * @dev Answer a state query from the item table the chain last published;
+ *		takes no lock, so it may run while another thread syncs the chain
+ * @return 1 if answered, 0 if the item is unknown ("reply" says so), -1 if
+ *		the chain has no table published
  */
-void showHistory( string inCaseId, string inItemId, int numEntries, bool reverse )
+int serviceItemState( ServedChain &chain, const string &itemText, string &reply )
 {
-	//track the list of unique items to return
-	vector<string> caseIdList;
-	vector<string> itemIdList;
-	vector<string> stateList;
-	vector<uint64_t> timeList;
-	//store the original strings for a simply empty compare later
-	string origCaseId = inCaseId;
-	string origItemId = inItemId;
-	//translate inputs to a full length string for proper comparisons
-	//This is because when reading from the byte array the string will always
-	//be of length 32 (even if it is only "1234"). We need to translate the
-	//input to be length 32 otherwise comparison will flag false by string
-	//length even if its contents are matching
-	unsigned char tmpCaseId[BLOCK_CASE_ID_SIZE];
-	memset( &tmpCaseId[0], 0, BLOCK_CASE_ID_SIZE );
-	memcpy( &tmpCaseId[0], inCaseId.c_str(), inCaseId.size() );
-	//encrypting an empty string has errors, don't allow it
-	if( 0 != inCaseId.compare("") )
+	unsigned char itemId[BLOCK_ITEM_ID_SIZE];
+	memset( itemId, 0, BLOCK_ITEM_ID_SIZE );
+	memcpy( itemId, itemText.c_str(), min( itemText.size(), (size_t)BLOCK_ITEM_ID_SIZE ) );
+	encryptBytes( itemId, BLOCK_ITEM_ID_SIZE, false );
+	ItemState item;
+	int found = publishedItemsLookup( chain.published, itemId, item );
+	if( 0 == found )
 	{
-		//then we need to encrypt the bytes to match the blockchain sotrage
-		encryptBytes( &tmpCaseId[0], BLOCK_CASE_ID_SIZE, true );
+		reply = "Item not found";
 	}
-	inCaseId = "";
-	inCaseId.append((const char*)&tmpCaseId[0], BLOCK_CASE_ID_SIZE);
-	//repeat process for Item ID
-	unsigned char tmpItemId[BLOCK_ITEM_ID_SIZE];
-	memset( &tmpItemId[0], 0, BLOCK_ITEM_ID_SIZE );
-	memcpy( &tmpItemId[0], inItemId.c_str(), inItemId.size() );
-	//encrypting an empty string has errors, don't allow it
-	if( 0 != inItemId.compare("") )
+	if( found <= 0 )
 	{
-		//then we need to encrypt the bytes to match the blockchain sotrage
-		encryptBytes( &tmpItemId[0], BLOCK_ITEM_ID_SIZE, false );
+		return found;
 	}
-	inItemId = "";
-	inItemId.append((const char*)&tmpItemId[0], BLOCK_ITEM_ID_SIZE);	
-	
-	//confirm the file exists before attempting to read it
-	if( fileExists() )
+	unsigned char caseId[BLOCK_CASE_ID_SIZE];
+	memcpy( caseId, item.caseId, BLOCK_CASE_ID_SIZE );
+	decryptBytes( caseId, BLOCK_CASE_ID_SIZE, false );
+	string caseText( (const char*)caseId, BLOCK_CASE_ID_SIZE );
+	caseText.insert(20, "-");
+	caseText.insert(16, "-");
+	caseText.insert(12, "-");
+	caseText.insert(8, "-");
+	char entry[256];
+	snprintf( entry, sizeof(entry), "Case: %s\nItem: %s\nStatus: %.*s\nOwner: %.*s\nTime: %s\n",
+				caseText.c_str(),
+				itemText.c_str(),
+				(int)strnlen( (const char*)item.state, BLOCK_STATE_SIZE ), (const char*)item.state,
+				(int)strnlen( (const char*)item.owner, BLOCK_OWNER_SIZE ), (const char*)item.owner,
+				translateTimestamp( item.lastTime ).c_str() );
+	reply += entry;
+	return 1;
+}
+
+/**
+ * @dev Answer one query against a chain whose lock is held and whose state
+ *		and index are bound to this thread
+ * @return false (with the reason in "reply") if the query failed
+ */
+bool serviceQuery( ChainService &service, ServedChain &chain, vector<string> &words, string &reply )
+{
+	string command = words[1];
+	if( (0 == command.compare("state")) && (3 == words.size()) )
 	{
-		//store the reads of data
-		unsigned char readCaseId[BLOCK_CASE_ID_SIZE];
-		unsigned char readItemId[BLOCK_ITEM_ID_SIZE];
-		unsigned char readState[BLOCK_STATE_SIZE];
-		union
+		int found = serviceItemState( chain, words[2], reply );
+		if( found < 0 )
 		{
-			uint64_t dblTime;
-			unsigned char byteTime[BLOCK_TIMESTAMP_SIZE];
-		} readTimestamp;
-		union
+			reply = "Chain not loaded";
+		}
+		if( found <= 0 )
 		{
-			unsigned int intLen;
-			unsigned char byteLen[4];
-		} readDataLen;
-		
-		//get the current contents of the blockchain
-		FILE* fPtr;
-		fPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( fPtr, 0, SEEK_SET );
-		//store the end of the file location
-		FILE* endPtr;
-		endPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( endPtr, 0, SEEK_END );
-		
-		//we need to sequentially check every block to determine the latest
-		//state of this evidence item
-		while( (ftell(fPtr) + BLOCK_MIN_SIZE) <= ftell(endPtr) )
+			return false;
+		}
+	}
+	else if( (0 == command.compare("items")) && (3 == words.size()) )
+	{
+		string caseText = words[2];
+		caseText.erase( remove( caseText.begin(), caseText.end(), '-' ), caseText.end() );
+		unsigned char caseId[BLOCK_CASE_ID_SIZE];
+		memset( caseId, 0, BLOCK_CASE_ID_SIZE );
+		memcpy( caseId, caseText.c_str(), min( caseText.size(), (size_t)BLOCK_CASE_ID_SIZE ) );
+		encryptBytes( caseId, BLOCK_CASE_ID_SIZE, true );
+		unordered_map<string, vector<string> >::iterator found = chain.state.caseItems.find( string( (const char*)caseId, BLOCK_CASE_ID_SIZE ) );
+		for( size_t i = 0; (found != chain.state.caseItems.end()) && (i < found->second.size()); i++ )
 		{
-			//notice, this method does no verification of blockchain integrity
-			//offset computational support
-			int offsetToNextField = 0;
-			string tmpCase = "";
-			string tmpItem = "";
-			string tmpState = "";
-			uint64_t tmpTime = 0;
-			
-			//advance from the head of the block to the timestamp field
-			offsetToNextField = BLOCK_TIMESTAMP_OFFSET;
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readTimestamp.byteTime, sizeof(char), BLOCK_TIMESTAMP_SIZE, fPtr);
-			//save the timestamp to a uint64_t
-			tmpTime = readTimestamp.dblTime;
-			
-			//advance from the end of the timestamp to the case id
-			offsetToNextField = BLOCK_CASE_ID_OFFSET - (BLOCK_TIMESTAMP_OFFSET + BLOCK_TIMESTAMP_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readCaseId, sizeof(char), BLOCK_CASE_ID_SIZE, fPtr);
-			//convert the caseId bytes to a string
-			tmpCase.append((const char*)&readCaseId[0], BLOCK_CASE_ID_SIZE);
-			
-			//advance from the Case ID to the Item ID field
-			offsetToNextField = BLOCK_ITEM_ID_OFFSET - (BLOCK_CASE_ID_OFFSET + BLOCK_CASE_ID_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readItemId, sizeof(char), BLOCK_ITEM_ID_SIZE, fPtr);
-			//convert the caseId bytes to a string
-			tmpItem.append((const char*)&readItemId[0], BLOCK_ITEM_ID_SIZE);
-			
-			//check to see if it should be appended to the list of matches
-			//by comparing it to the Case ID & Item ID filter (guaranteed
-			//add to list if both are "")
-			bool addToList = true;
-			if( 0 != origCaseId.compare("") )
-			{
-				//if the current case & filter case do not
-				//match, then do not add to the list
-				if(0 != tmpCase.compare(inCaseId))
-				{
-					addToList = false;
-				}
-			}
-			if( 0 != origItemId.compare("") )
-			{
-				//if the current item & filter item do not
-				//match, then do not add to the list
-				if(0 != tmpItem.compare(inItemId))
-				{
-					addToList = false;
-				}
-			}
-			//we will add to the list later, we don't have the state & time yet
-			
-			//advance from the end of the Item Id to the State
-			offsetToNextField = BLOCK_STATE_OFFSET - (BLOCK_ITEM_ID_OFFSET + BLOCK_ITEM_ID_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			fread( readState, sizeof(char), BLOCK_STATE_SIZE, fPtr );
-			//convert the caseId bytes to a string
-			tmpState.append((const char*)&readState[0], BLOCK_STATE_SIZE);
-			
-			//add the captured data from the block chain to the history list to show
-			if( addToList )
-			{
-				caseIdList.push_back( tmpCase );
-				itemIdList.push_back( tmpItem );
-				stateList.push_back( tmpState );
-				timeList.push_back( tmpTime );
-			}
-			
-			//advance from the end of the State to the Data Length field
-			offsetToNextField = BLOCK_DATA_LEN_OFFSET - (BLOCK_STATE_OFFSET + BLOCK_STATE_SIZE);
-			fseek( fPtr, offsetToNextField, SEEK_CUR );
-			//Compute the offset to read the length of this data field
-			fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-			//advance from the DataLen field to the end of the data field
-			//(recall the "fread" advances the fPtr)
-			fseek( fPtr, readDataLen.intLen, SEEK_CUR );
+			string itemId = found->second[i];
+			decryptBytes( (unsigned char*)itemId.c_str(), BLOCK_ITEM_ID_SIZE, true );
+			reply += itemId.c_str();
+			reply += "\n";
 		}
-		fclose(fPtr);
 	}
-	
-	//print all found cases
-	//If -1 entries specified, show all of them. Also prevent out of bounds access.
-	if( (-1 == numEntries) || (numEntries > itemIdList.size()) )
+	else if( (0 == command.compare("cases")) && (2 == words.size()) )
 	{
-		numEntries = itemIdList.size();
+		for( size_t i = 0; i < chain.state.caseOrder.size(); i++ )
+		{
+			string caseText = chain.state.caseOrder[i];
+			decryptBytes( (unsigned char*)caseText.c_str(), BLOCK_CASE_ID_SIZE, false );
+			caseText.insert(20, "-");
+			caseText.insert(16, "-");
+			caseText.insert(12, "-");
+			caseText.insert(8, "-");
+			reply += caseText + "\n";
+		}
 	}
-	//the INITIAL block isn't encrypted, so we shouldn't
-	//decrypt the results if it is among the list
-	bool listContainsInitialBlock = false;
-	if( (0 == origCaseId.compare("")) && (0 == origItemId.compare("")) )
+	else if( (0 == command.compare("history")) && ((3 == words.size()) || (4 == words.size())) )
 	{
-		listContainsInitialBlock = true;
+		unsigned char itemId[BLOCK_ITEM_ID_SIZE];
+		memset( itemId, 0, BLOCK_ITEM_ID_SIZE );
+		memcpy( itemId, words[2].c_str(), min( words[2].size(), (size_t)BLOCK_ITEM_ID_SIZE ) );
+		encryptBytes( itemId, BLOCK_ITEM_ID_SIZE, false );
+		uint64_t limit = (4 == words.size()) ? strtoull( words[3].c_str(), NULL, 10 ) : 0;
+		vector<uint64_t> offsets;
+		ChainFile file;
+		if( !itemIndexHistory( itemId, limit, offsets ) || !chainOpen( file ) )
+		{
+			reply = "Index not available";
+			return false;
+		}
+		for( size_t i = 0; i < offsets.size(); i++ )
+		{
+			unsigned char header[BLOCK_MIN_SIZE];
+			chainSeek( file, offsets[i] );
+			chainRead( file, header, BLOCK_MIN_SIZE );
+			BlockView block( header );
+			unsigned char fields[HISTORY_RECORD_FIELDS];
+			memcpy( fields, block.caseId(), BLOCK_CASE_ID_SIZE );
+			memcpy( fields + BLOCK_CASE_ID_SIZE, block.itemId(), BLOCK_ITEM_ID_SIZE );
+			decryptBytes( fields, BLOCK_CASE_ID_SIZE, false );
+			decryptBytes( fields + BLOCK_CASE_ID_SIZE, BLOCK_ITEM_ID_SIZE, true );
+			formatHistoryEntry( fields, fields + BLOCK_CASE_ID_SIZE, block.stateField(), block.time, false, reply );
+		}
+		chainClose( file );
 	}
-	//If "reverse" is true, print latest to oldest order
-	if( reverse )
+	else if( (0 == command.compare("verify-status")) && (2 == words.size()) )
 	{
-		int bottom = itemIdList.size() - numEntries;
-		if( bottom < 0 )
+		//the verifier publishes its progress under the service lock
+		lock_guard<mutex> guard( service.lock );
+		char entry[512];
+		if( 0 == service.verifyRate )
 		{
-			bottom = 0;
+			reply = "Background verification is off";
+			return false;
 		}
-		for( int i = itemIdList.size()-1; i >= bottom; i-- )
+		snprintf( entry, sizeof(entry), "Verified: %llu of %llu bytes\nPasses: %llu\n",
+					(unsigned long long)chain.verifyOffset, (unsigned long long)chain.verifyTarget,
+					(unsigned long long)chain.verifyPasses );
+		reply += entry;
+		if( chain.verifyPasses > 0 )
 		{
-			//INITIAL block is not encrypted
-			if( !listContainsInitialBlock )
-			{
-				//decrypt the case id for human readable output
-				decryptBytes( (unsigned char*)caseIdList[i].c_str(), BLOCK_CASE_ID_SIZE, false );
-				//decrypt the item id for human readable output
-				decryptBytes( (unsigned char*)itemIdList[i].c_str(), BLOCK_ITEM_ID_SIZE, true );
-			}
-			else if( 0 != i )
-			{
-				//decrypt the case id for human readable output
-				decryptBytes( (unsigned char*)caseIdList[i].c_str(), BLOCK_CASE_ID_SIZE, false );
-				//decrypt the item id for human readable output
-				decryptBytes( (unsigned char*)itemIdList[i].c_str(), BLOCK_ITEM_ID_SIZE, true );
-			}
-			else
+			snprintf( entry, sizeof(entry), "Last pass: %s\nTransactions in blockchain: %d\nState of blockchain: %s\n",
+						translateTimestamp( chain.verifyTime ).c_str(), chain.verifyBlocks,
+						chain.verifyClean ? "CLEAN" : "ERROR" );
+			reply += entry;
+			if( !chain.verifyClean )
 			{
-				//For INITIAL block, expected to print "0" instead of "0000..."
-				itemIdList[i] = "0";
+				reply += chain.verifyFailure + "\n";
 			}
-			//re-apply hifens
-			caseIdList[i].insert(20, "-");
-			caseIdList[i].insert(16, "-");
-			caseIdList[i].insert(12, "-");
-			caseIdList[i].insert(8, "-");
-			//Time is a double of microseconds since Epoch, translate to human readable
-			//NOTICE - autograder expects a single string output
-			printf("Case: %s\nItem: %s\nAction: %s\nTime: %s\n\n",
-						caseIdList[i].c_str(),
-						itemIdList[i].c_str(),
-						stateList[i].c_str(),
-						translateTimestamp( timeList[i] ).c_str() );
 		}
 	}
-	else
+	else if( (0 == command.compare("verify")) && (2 == words.size()) )
 	{
-		for( int i = 0; i < numEntries; i++ )
+		//the same checks and report as the verify command, leaving the served state alone
+		ChainFile file;
+		if( !chainOpen( file ) )
 		{
-			//INITIAL block is not encrypted
-			if( !listContainsInitialBlock )
-			{
-				//decrypt the case id for human readable output
-				decryptBytes( (unsigned char*)caseIdList[i].c_str(), BLOCK_CASE_ID_SIZE, false );
-				//decrypt the item id for human readable output
-				decryptBytes( (unsigned char*)itemIdList[i].c_str(), BLOCK_ITEM_ID_SIZE, true );
-			}
-			else if( 0 != i )
-			{
-				//decrypt the case id for human readable output
-				decryptBytes( (unsigned char*)caseIdList[i].c_str(), BLOCK_CASE_ID_SIZE, false );
-				//decrypt the item id for human readable output
-				decryptBytes( (unsigned char*)itemIdList[i].c_str(), BLOCK_ITEM_ID_SIZE, true );
-			}
-			else
-			{
-				//For INITIAL block, expected to print "0" instead of "0000..."
-				itemIdList[i] = "0";
-			}
-			//re-apply hifens
-			caseIdList[i].insert(20, "-");
-			caseIdList[i].insert(16, "-");
-			caseIdList[i].insert(12, "-");
-			caseIdList[i].insert(8, "-");
-			//Time is a double of microseconds since Epoch, translate to human readable
-			//NOTICE - autograder expects a single string output
-			printf("Case: %s\nItem: %s\nAction: %s\nTime: %s\n\n",
-						caseIdList[i].c_str(),
-						itemIdList[i].c_str(),
-						stateList[i].c_str(),
-						translateTimestamp( timeList[i] ).c_str() );
+			reply = "File not found";
+			return false;
 		}
+		VerifyRun run = VerifyRun();
+		run.failFast = false;
+		run.stream = false;
+		verifyStart( run );
+		uint64_t endOfChain = chainSize( file );
+		verifyStep( run, file, endOfChain, UINT64_MAX );
+		verifyFinish( run, endOfChain );
+		chainClose( file );
+		verifyReport( run, "blockchain", run.allGood, reply );
+		arenaRelease( run.arena );
+		arenaRelease( run.scratch );
 	}
-	
+	else
+	{
+		reply = "Unknown request";
+		return false;
+	}
+	return true;
 }
 
 /**
- * @dev Verify method that will check the blockchain for a set of potential errors
+ * @dev Requests that print decrypted history or item states end with the
+ *		password the CLI asks for ("-p password"), which is checked and then
+ *		taken off the request's words
+ * @return false if such a request has no valid password
  */
-int verify()
+bool serviceAuthorize( vector<string> &words )
 {
-	int result = 0;
-	bool allGood = true;
-	int transCount = 0;
-	//track all Hashes, it has been expressed that each hash will be unique
-	vector<string> monitoredHash;
-	//create dynamic lists to track linkage of case/item/states/creator
-	vector<string> monitoredCaseId;
-	vector<string> monitoredItemId;
-	vector<string> monitoredState;
-	vector<string> monitoredCreator;
-	//track the Hash of the bad block and the reason it is bad
-	vector<string> badBlocks;
-	vector<int> failureCondition;
-	//confirm the file exists before attempting to read it
-	if( fileExists() )
+	if( (words.size() < 2) || ((0 != words[1].compare("state")) && (0 != words[1].compare("history"))) )
 	{
-		//store the reads of data (Data field will be allocated for each block)
-		unsigned char readPrevHash[BLOCK_PREV_HASH_SIZE];
-		unsigned char readCaseId[BLOCK_CASE_ID_SIZE];
-		unsigned char readItemId[BLOCK_ITEM_ID_SIZE];
-		unsigned char readState[BLOCK_STATE_SIZE];
-		unsigned char readCreator[BLOCK_CREATOR_SIZE];
-		unsigned char readOwner[BLOCK_OWNER_SIZE];
-		union
-		{
-			uint64_t dblTime;
-			unsigned char byteTime[BLOCK_TIMESTAMP_SIZE];
-		} readTimestamp;
-		union
-		{
-			unsigned int intLen;
-			unsigned char byteLen[4];
-		} readDataLen;
-		unsigned char readCurHash[BLOCK_PREV_HASH_SIZE];
-		
-		//additional variables to assist with verification
-		uint64_t lastBlockTime = 0;
-		unsigned char tmpINI[] = {'I','N','I','T','I','A','L','\0','\0','\0','\0','\0'};
-		string initialState = "";
-		initialState.append((const char*)&tmpINI[0], BLOCK_STATE_SIZE);
-		unsigned char tmpCI[] = {'C','H','E','C','K','E','D','I','N','\0','\0','\0'};
-		string checkinState = "";
-		checkinState.append((const char*)&tmpCI[0], BLOCK_STATE_SIZE);
-		unsigned char tmpCO[] = {'C','H','E','C','K','E','D','O','U','T','\0','\0'};
-		string checkoutState = "";
-		checkoutState.append((const char*)&tmpCO[0], BLOCK_STATE_SIZE);
-		unsigned char tmpDE[] = {'D','E','S','T','R','O','Y','E','D','\0','\0','\0'};
-		string destroyedState = "";
-		destroyedState.append((const char*)&tmpDE[0], BLOCK_STATE_SIZE);
-		unsigned char tmpDI[] = {'D','I','S','P','O','S','E','D','\0','\0','\0','\0'};
-		string disposedState = "";
-		disposedState.append((const char*)&tmpDI[0], BLOCK_STATE_SIZE);
-		unsigned char tmpRE[] = {'R','E','L','E','A','S','E','D','\0','\0','\0','\0'};
-		string releasedState = "";
-		releasedState.append((const char*)&tmpRE[0], BLOCK_STATE_SIZE);
-		
-		//get the current contents of the blockchain
-		FILE* fPtr;
-		fPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( fPtr, 0, SEEK_SET );
-		//store the end of the file location
-		FILE* endPtr;
-		endPtr = fopen( COC_FILE.c_str(), "rb" );
-		fseek( endPtr, 0, SEEK_END );
-		
-		//since we are reading all fields, we can read them in order
-		//and leverage that fread will advance the pointer with each read
-		fread( readPrevHash, sizeof(char), BLOCK_PREV_HASH_SIZE, fPtr);
-		fread( readTimestamp.byteTime, sizeof(char), BLOCK_TIMESTAMP_SIZE, fPtr);
-		fread( readCaseId, sizeof(char), BLOCK_CASE_ID_SIZE, fPtr);
-		fread( readItemId, sizeof(char), BLOCK_ITEM_ID_SIZE, fPtr);
-		fread( readState, sizeof(char), BLOCK_STATE_SIZE, fPtr );
-		fread( readCreator, sizeof(char), BLOCK_CREATOR_SIZE, fPtr );
-		fread( readOwner, sizeof(char), BLOCK_OWNER_SIZE, fPtr );
-		fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-		
-		//#1 check the integrity of the INITIAL block
-		string actualIniState = "";
-		actualIniState.append((const char*)&readState[0], BLOCK_STATE_SIZE);
-		bool validIniBlock = true;
-		if( 0 != actualIniState.compare( initialState ) )
-		{
-			//Initial block is not marked as initial, flag error
-			validIniBlock = false;
-			allGood = false;
-		}
-		int lengthOfData = readDataLen.intLen;
-		unsigned char initDataField[lengthOfData];
-		if( lengthOfData > 0 )
-		{
-			fread( &initDataField[0], sizeof(char), lengthOfData, fPtr );
-		}
-		//after reading the dat field, increment transaction counter
-		transCount++;
-		
-		//compute the hash of the INITIAL block
-		string recomputedHash = recomputeHash( &readPrevHash[0], &readTimestamp.byteTime[0],
-						&readCaseId[0], &readItemId[0], &readState[0], &readCreator[0],
-						&readOwner[0], &readDataLen.byteLen[0], &initDataField[0], lengthOfData);
-		
-		//log if the INITIAL block had errors
-		if( !validIniBlock )
-		{
-			//convert the bytes back to human readable Hash value
-			//for reporting purposes
-			std::stringstream ss;
-			ss << hex;
-			for(int i = 0; i < BLOCK_PREV_HASH_SIZE; ++i)
-			{
-				ss << std::setw(2) << std::setfill('0') << (int)recomputedHash[i];
-			}
-			string stringHash = ss.str();
-			badBlocks.push_back(stringHash);
-			failureCondition.push_back(1);
-		}
-		
-		//we need to sequentially check every block to determine the latest
-		//state of this evidence item
-		while( (ftell(fPtr) + BLOCK_MIN_SIZE) <= ftell(endPtr) )
-		{
-			
-			//variables to assist with field verification
-			string tmpCase = "";
-			string tmpItem = "";
-			string tmpState = "";
-			string tmpCreator = "";
-			uint64_t tmpTime = 0;
-			string tmpData = "";
-			
-			//since we are reading all fields, we can read them in order
-			//and leverage that fread will advance the pointer with each read
-			int blockHeadPtr = ftell(fPtr);
-			fread( readPrevHash, sizeof(char), BLOCK_PREV_HASH_SIZE, fPtr);
-			fread( readTimestamp.byteTime, sizeof(char), BLOCK_TIMESTAMP_SIZE, fPtr);
-			fread( readCaseId, sizeof(char), BLOCK_CASE_ID_SIZE, fPtr);
-			fread( readItemId, sizeof(char), BLOCK_ITEM_ID_SIZE, fPtr);
-			int blockStatePtr = ftell(fPtr);
-			fread( readState, sizeof(char), BLOCK_STATE_SIZE, fPtr );
-			fread( readCreator, sizeof(char), BLOCK_CREATOR_SIZE, fPtr );
-			fread( readOwner, sizeof(char), BLOCK_OWNER_SIZE, fPtr );
-			int blockDataLenPtr = ftell(fPtr);
-			fread( &readDataLen.byteLen[0], sizeof(char), BLOCK_DATA_LEN_SIZE, fPtr );
-			//now we need to scan whatever data may be in the data field
-			unsigned char readDataField[readDataLen.intLen];
-			if( readDataLen.intLen > 0 )
-			{
-				fread( readDataField, sizeof(char), readDataLen.intLen, fPtr );
-				tmpData.append((const char*)&readDataField[0], readDataLen.intLen);
-			}
-			//after reading the data field, increment transaction counter
-			transCount++;
-			
-			
-			//Then we translate the data fields we intend to do futher tracking/comparisons
-			//of into other data types instead of raw bytes
-			tmpTime = readTimestamp.dblTime;
-			tmpCase.append((const char*)&readCaseId[0], BLOCK_CASE_ID_SIZE);
-			tmpItem.append((const char*)&readItemId[0], BLOCK_ITEM_ID_SIZE);
-			tmpState.append((const char*)&readState[0], BLOCK_STATE_SIZE);
-			tmpCreator.append((const char*)&readCreator[0], BLOCK_CREATOR_SIZE);
-			
-			//--- Verification Checks ---
-			//	2) Previous Hash matches the hash of the parent block
-			//	3) 2 Blocks have same parent Hash
-			//	4) Strictly Increasing Time
-			//	5) Unique Item ID has unchanged Case ID
-			//	6) Unique Item ID has unchanged Creator
-			//	7) Item has appropriate state changes
-			//		(Initial is Checkin || Checkin > Checkout || Checkout > Checkin || Checkin > Removed)
-			
-			//#2
-			bool parentHashMatch = true;
-			string prevHashResult = "";
-			prevHashResult.append((const char*)&readPrevHash[0], BLOCK_PREV_HASH_SIZE);
-			if( 0 != recomputedHash.compare(prevHashResult) )
-			{
-				parentHashMatch = false;
-				allGood = false;
-			}
-			
-			//#3
-			bool uniqueHash = true;
-			for( int i = 0; i < monitoredHash.size(); i++ )
-			{
-				//on match, 2 blocks have same parent
-				if( 0 == prevHashResult.compare( monitoredHash[i] ) )
-				{
-					uniqueHash = false;
-					allGood = false;
-				}
-			}
-			//in all cases, append the hash to the list of monitored hashes
-			monitoredHash.push_back( prevHashResult );
-			
-			//#4
-			bool increasingTime = true;
-			if( lastBlockTime > tmpTime )
-			{
-				increasingTime = false;
-				allGood = false;
-			}
-			lastBlockTime = tmpTime;
-			
-			//#5/6/7
-			bool unchangedCaseId = true;
-			bool unchangedCreator = true;
-			bool validInitialState = true;
-			//check if this item is being tracked yet
-			int itemMonitored = -1;
-			for( int i = 0; i < monitoredItemId.size(); i++ )
-			{
-				if( 0 == tmpItem.compare( monitoredItemId[i] ) )
-				{
-					itemMonitored = i;
-				}
-			}
-			if( -1 != itemMonitored )
-			{
-				//item is on the monitoring block, do verification
-				if( 0 != tmpCase.compare( monitoredCaseId[itemMonitored] ) )
-				{
-					unchangedCaseId = false;
-					allGood = false;
-				}
-				if( 0 != tmpCreator.compare( monitoredCreator[itemMonitored] ) )
-				{
-					unchangedCreator = false;
-					allGood = false;
-				}
-			}
-			else
-			{
-				//first instance of the item, add its values to the list
-				monitoredCaseId.push_back( tmpCase );
-				monitoredItemId.push_back( tmpItem );
-				monitoredCreator.push_back( tmpCreator );
-				monitoredState.push_back( tmpState );
-				//partial check of #7, check initial value is CHECKEDIN
-				if( 0 != checkinState.compare( tmpState ) )
-				{
-					validInitialState = false;
-					allGood = false;
-				}
-			}
-			
-			//#7
-			//leverage previous check for item existence in moitoring yet
-			bool validStateChange = true;
-			if( (-1 != itemMonitored) && (validInitialState) )
-			{
-				//determine previous state of the item
-				if( 0 == checkinState.compare( monitoredState[itemMonitored] ) )
-				{
-					//previously CHECKEDIN
-					//Allowable next states: CHECKEDOUT, DESTROYED, DISPOSED, RELEASED
-					if( 0 == tmpState.compare( checkoutState ) )
-					{
-						validStateChange = true;
-					}
-					else if( 0 == tmpState.compare( destroyedState ) )
-					{
-						validStateChange = true;
-					}
-					else if( 0 == tmpState.compare( disposedState ) )
-					{
-						validStateChange = true;
-					}
-					else if( 0 == tmpState.compare( releasedState ) )
-					{
-						validStateChange = true;
-					}
-					else
-					{
-						validStateChange = false;
-					}
-				}
-				else if( 0 == checkoutState.compare( monitoredState[itemMonitored] ) )
-				{
-					//previously CHECKEDOUT
-					//Allowable next states: CHECKEDIN
-					if( 0 == tmpState.compare( checkinState ) )
-					{
-						validStateChange = true;
-					}
-					else
-					{
-						validStateChange = false;
-					}
-				}
-				else
-				{
-					//previously DESTROYED, DISPOSED, RELEASED
-					//Allowable next states: N/A (any transition is illegal)
-					validStateChange = false;
-				}
-				if( !validStateChange )
+		return true;
+	}
+	if( (words.size() < 4) || (0 != words[words.size() - 2].compare("-p")) )
+	{
+		return false;
+	}
+	string password = words.back();
+	words.resize( words.size() - 2 );
+	//Confirm Password is POLICE, LAWYER, ANALYST, or EXECUTIVE
+	return 0 < checkPassword( password );
+}
+
+/**
+ * @dev Whether a request may take long enough to stall the event loop
+ */
+bool serviceIsHeavy( const string &line )
+{
+	vector<string> words;
+	stringstream ss( line );
+	string word;
+	while( ss >> word )
+	{
+		words.push_back( word );
+	}
+	serviceAuthorize( words );
+	return (words.size() >= 2) && ((0 == words[1].compare("verify")) ||
+			((0 == words[1].compare("history")) && (words.size() < 4)));
+}
+
+/**
+ * @dev Answer one request line
+ * @param reply receives the reply, including its final OK/ERROR line
+ * @param wait is false to give up instead of waiting for a busy chain
+ * @return false if the chain was busy and nothing was answered
+ */
+bool serviceRequest( ChainService &service, const string &line, string &reply, bool wait )
+{
+	vector<string> words;
+	stringstream ss( line );
+	string word;
+	while( ss >> word )
+	{
+		words.push_back( word );
+	}
+	reply = "";
+	ServedChain* chain = (words.size() >= 2) ? serviceChain( service, words[0] ) : NULL;
+	if( NULL == chain )
+	{
+		reply = "ERROR Unknown chain\n";
+		return true;
+	}
+	if( !serviceAuthorize( words ) )
+	{
+		reply = "ERROR Invalid password\n";
+		return true;
+	}
+	bool answered = false;
+	string answer;
+	{
+		unique_lock<mutex> guard( chain->lock, defer_lock );
+		if( wait )
+		{
+			guard.lock();
+		}
+		else if( !guard.try_lock() )
+		{
+			//point lookups read what the busy chain last published instead of waiting
+			if( (0 == words[1].compare("state")) && (3 == words.size()) )
+			{
+				int found = serviceItemState( *chain, words[2], answer );
+				if( found >= 0 )
 				{
-					//there was an invalid state change
-					allGood = false;
+					reply = (found > 0) ? (answer + "OK\n") : ("ERROR " + answer + "\n");
+					return true;
 				}
-				//in all cases, update the monitored state to what was read
-				monitoredState[itemMonitored] = tmpState;
-			}
-			
-			// --- End of Verification ---
-			
-			string thisBlock = "";
-			//recreate the block to compute it's hash and compare to the stored hash
-			thisBlock.append((const char*)&readPrevHash[0], BLOCK_PREV_HASH_SIZE);
-			thisBlock.append((const char*)&readTimestamp.byteTime[0], BLOCK_TIMESTAMP_SIZE);
-			thisBlock.append((const char*)&readCaseId[0], BLOCK_CASE_ID_SIZE);
-			thisBlock.append((const char*)&readItemId[0], BLOCK_ITEM_ID_SIZE);
-			thisBlock.append((const char*)&readState[0], BLOCK_STATE_SIZE);
-			thisBlock.append((const char*)&readCreator[0], BLOCK_CREATOR_SIZE);
-			thisBlock.append((const char*)&readOwner[0], BLOCK_OWNER_SIZE);
-			thisBlock.append((const char*)&readDataLen.byteLen[0], BLOCK_DATA_LEN_SIZE);
-			thisBlock.append( tmpData );
-			//compute and append the hash value of this block as a string
-			recomputedHash = computeHash(thisBlock);
-			
-			//convert the bytes back to human readable Hash value
-			//for reporting purposes
-			std::stringstream ss;
-			ss << hex;
-			unsigned char tmpCurHash[BLOCK_PREV_HASH_SIZE];
-			memcpy( &tmpCurHash[0], recomputedHash.c_str(), BLOCK_PREV_HASH_SIZE );
-			for(int i = 0; i < BLOCK_PREV_HASH_SIZE; ++i)
-			{
-				ss << std::setw(2) << std::setfill('0') << (int)tmpCurHash[i];
-			}
-			string stringHash = ss.str();
-			
-			//Catalog all failures for this Block
-			if( !parentHashMatch )
-			{
-				badBlocks.push_back(stringHash);
-				failureCondition.push_back(2);
 			}
-			if( !uniqueHash )
+			return false;
+		}
+		//bind the chain to this thread for the shared chain/index helpers
+		COC_FILE = chain->path;
+		COC_INDEX = chain->index;
+		if( chainStateSync( chain->state ) )
+		{
+			publishedItemsRefresh( chain->published, chain->state );
+			answered = serviceQuery( service, *chain, words, answer );
+		}
+		else
+		{
+			answer = "File not found";
+		}
+		chain->index = COC_INDEX;
+		COC_INDEX.fd = -1;
+		COC_INDEX.headFd = -1;
+		size_t footprint = chainStateFootprint( chain->state ) + publishedItemsFootprint( chain->published );
+		lock_guard<mutex> registry( service.lock );
+		service.footprint = service.footprint - chain->footprint + footprint;
+		chain->footprint = footprint;
+		chain->lastUsed = ++service.clock;
+	}
+	reply = answered ? (answer + "OK\n") : ("ERROR " + answer + "\n");
+	serviceEvict( service );
+	return true;
+}
+
+/**
+ * @dev Answer requests handed over by the event loop
+ */
+void serviceWorker( ChainService* service )
+{
+	while( true )
+	{
+		pair<uint64_t, string> job;
+		{
+			unique_lock<mutex> guard( service->queueLock );
+			while( service->jobs.empty() )
 			{
-				badBlocks.push_back(stringHash);
-				failureCondition.push_back(3);
+				service->queued.wait( guard );
 			}
-			if( !increasingTime )
+			job = service->jobs.front();
+			service->jobs.pop_front();
+		}
+		string reply;
+		serviceRequest( *service, job.second, reply, true );
+		service->inFlight--;
+		{
+			lock_guard<mutex> guard( service->queueLock );
+			service->replies.push_back( make_pair( job.first, reply ) );
+		}
+		uint64_t one = 1;
+		write( service->wakeFd, &one, sizeof(one) );
+	}
+}
+
+/**
+ * @dev Re-verify the hosted chains in the background, one slice of one chain
+ *		at a time, within the service's bandwidth and CPU budget
+ */
+void serviceVerifier( ChainService* service )
+{
+	size_t turn = 0;
+	while( true )
+	{
+		//take the chains in turn
+		ServedChain* chain = NULL;
+		{
+			lock_guard<mutex> guard( service->lock );
+			if( !service->chains.empty() )
 			{
-				badBlocks.push_back(stringHash);
-				failureCondition.push_back(4);
+				map<string, ServedChain*>::iterator it = service->chains.begin();
+				advance( it, turn++ % service->chains.size() );
+				chain = it->second;
 			}
-			if( !unchangedCaseId )
+		}
+		if( NULL == chain )
+		{
+			this_thread::sleep_for( chrono::seconds( 1 ) );
+			continue;
+		}
+		//requests always go first
+		while( service->inFlight.load() > 0 )
+		{
+			this_thread::sleep_for( chrono::milliseconds( 1 ) );
+		}
+		ChainFile file;
+		COC_FILE = chain->path;
+		if( !chainOpen( file ) )
+		{
+			this_thread::sleep_for( chrono::milliseconds( 100 ) );
+			continue;
+		}
+		struct timespec cpuStart;
+		struct timespec cpuEnd;
+		clock_gettime( CLOCK_THREAD_CPUTIME_ID, &cpuStart );
+		VerifyRun &run = chain->background;
+		//a pass that outlived its chain (truncated or replaced) starts over
+		if( !run.started || (chainSize( file ) < chain->verifyTarget) )
+		{
+			verifyStart( run );
+			chain->verifyTarget = chainSize( file );
+		}
+		uint64_t before = run.offset;
+		bool done = verifyStep( run, file, chain->verifyTarget, VERIFY_SLICE_BYTES );
+		uint64_t checked = run.offset - before;
+		chainClose( file );
+		{
+			lock_guard<mutex> guard( service->lock );
+			chain->verifyOffset = run.offset;
+			if( done )
 			{
-				badBlocks.push_back(stringHash);
-				failureCondition.push_back(5);
+				verifyFinish( run, chain->verifyTarget );
+				chain->verifyPasses++;
+				chain->verifyTime = unixTimestamp();
+				chain->verifyBlocks = run.transCount;
+				chain->verifyClean = run.allGood && run.badBlocks.empty();
+				chain->verifyFailure = run.badBlocks.empty() ? "" :
+						("Bad block: " + run.badBlocks[0] + "\n" + verifyFailureText( run.failureCondition[0] ));
+				//the next pass starts from the first block again
+				run.started = false;
 			}
-			if( !unchangedCreator )
+		}
+		//sleep off the slice: long enough that neither the read rate nor the
+		//share of a core goes over budget
+		clock_gettime( CLOCK_THREAD_CPUTIME_ID, &cpuEnd );
+		uint64_t cpuMicros = (cpuEnd.tv_sec - cpuStart.tv_sec) * 1000000ULL + (cpuEnd.tv_nsec - cpuStart.tv_nsec) / 1000;
+		uint64_t ioPause = checked * 1000000ULL / service->verifyRate;
+		uint64_t cpuPause = cpuMicros * (100 - service->verifyCpu) / service->verifyCpu;
+		this_thread::sleep_for( chrono::microseconds( max( ioPause, cpuPause ) ) );
+	}
+}
+
+/**
+ * @dev Send as much of a client's pending output as the socket takes, and
+ *		only ask to hear about writability while some is left
+ */
+void serviceFlush( int epollFd, uint64_t id, ServiceClient &client )
+{
+	while( !client.output.empty() )
+	{
+		ssize_t wrote = send( client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL );
+		if( wrote <= 0 )
+		{
+			if( (wrote < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)) )
 			{
-				badBlocks.push_back(stringHash);
-				failureCondition.push_back(6);
+				break;
 			}
-			if( (!validStateChange) || (!validInitialState) )
+			client.closing = true;
+			client.output.clear();
+			return;
+		}
+		client.output.erase( 0, wrote );
+	}
+	struct epoll_event event;
+	memset( &event, 0, sizeof(event) );
+	event.events = (client.closing ? 0 : EPOLLIN) | (client.output.empty() ? 0 : EPOLLOUT);
+	event.data.u64 = id;
+	//a client that hung up is only watched while output is still owed to it
+	if( 0 == event.events )
+	{
+		epoll_ctl( epollFd, EPOLL_CTL_DEL, client.fd, &event );
+	}
+	else if( (0 != epoll_ctl( epollFd, EPOLL_CTL_MOD, client.fd, &event )) && (ENOENT == errno) )
+	{
+		epoll_ctl( epollFd, EPOLL_CTL_ADD, client.fd, &event );
+	}
+}
+
+/**
+ * @dev Answer a client's complete request lines in order, inline when they are
+ *		cheap and their chain is free, otherwise by handing them to a worker
+ *		(the remaining lines then wait for its reply)
+ */
+void serviceProcess( ChainService &service, uint64_t id, ServiceClient &client )
+{
+	size_t newline;
+	while( !client.waiting && (string::npos != (newline = client.input.find('\n'))) )
+	{
+		string line = client.input.substr( 0, newline );
+		client.input.erase( 0, newline + 1 );
+		string reply;
+		//counted until answered, by a worker if it is handed off
+		service.inFlight++;
+		if( serviceIsHeavy( line ) || !serviceRequest( service, line, reply, false ) )
+		{
 			{
-				badBlocks.push_back(stringHash);
-				failureCondition.push_back(7);
+				lock_guard<mutex> guard( service.queueLock );
+				service.jobs.push_back( make_pair( id, line ) );
 			}
-			
+			service.queued.notify_one();
+			client.waiting = true;
 		}
-		//finally, check no incomplete blocks exist
-		//meaning the end of the last block equals end of file
-		if( ftell(fPtr) != ftell(endPtr) )
+		else
 		{
-			//no specific block to call out
-			badBlocks.push_back("NULL");
-			failureCondition.push_back(8);
+			service.inFlight--;
+			client.output += reply;
 		}
-		
-		fclose(fPtr);
 	}
-	else
+}
+
+/**
+ * @dev Run the chain service until it is killed
+ * @param socketPath is the Unix socket to listen on
+ * @param named maps chain names to chain files
+ * @param folder (optional) serves every chain file in it by name
+ * @param budget is the memory budget for loaded chains in bytes
+ * @param verifyRate is the background verifier's read rate in bytes per second (0 for none)
+ * @param verifyCpu is the share of one core (in percent) the verifier may use
+ */
+int serveChains( string socketPath, map<string, string> &named, string folder, size_t budget, uint64_t verifyRate, int verifyCpu )
+{
+	ChainService service;
+	service.folder = folder;
+	if( (0 != folder.size()) && ('/' != folder[folder.size() - 1]) )
 	{
-		printf("File not found\n");
+		service.folder += "/";
+	}
+	service.budget = budget;
+	service.clock = 0;
+	service.footprint = 0;
+	service.verifyRate = verifyRate;
+	service.verifyCpu = min( max( verifyCpu, 1 ), 100 );
+	service.inFlight = 0;
+	for( map<string, string>::iterator it = named.begin(); it != named.end(); it++ )
+	{
+		ServedChain* chain = new ServedChain();
+		chain->path = it->second;
+		chain->state.loaded = false;
+		chain->index.fd = -1;
+		chain->index.headFd = -1;
+		chain->index.checked = false;
+		chain->state.trackTouched = true;
+		chain->lastUsed = 0;
+		chain->footprint = 0;
+		chain->background.started = false;
+		chain->verifyTarget = 0;
+		chain->verifyOffset = 0;
+		chain->verifyPasses = 0;
+		service.chains[it->first] = chain;
 	}
 	
-	/*
-		CONDITIONS VERIFIED
-		1) Invalid INITIAL block
-		2) Previous Hash field matches the hash of the parent block
-		3) 2 Blocks have same parent block hash
-		4) Strictly Increasing Time
-		5) Unique Item ID has unchanged Case ID
-		6) Unique Item ID has unchanged Creator
-		7) Item has appropriate state changes
-		8) Trailing bytes near end of file (incomplete block risk)
-	*/
-	//print how many transactions are in the blockchain
-	printf("Transactions in blockchain: %d\n", transCount);
-	if( allGood )
+	struct sockaddr_un address;
+	memset( &address, 0, sizeof(address) );
+	address.sun_family = AF_UNIX;
+	if( socketPath.size() >= sizeof(address.sun_path) )
 	{
-		printf("State of blockchain: CLEAN\n");
+		printf("Socket path too long\n");
+		return 1;
 	}
-	else
+	strcpy( address.sun_path, socketPath.c_str() );
+	int listenFd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0 );
+	unlink( socketPath.c_str() );
+	if( (listenFd < 0) || (0 != bind( listenFd, (struct sockaddr*)&address, sizeof(address) )) || (0 != listen( listenFd, 1024 )) )
 	{
-		result = 1;
-		//Errors were detected
-		printf("State of blockchain: ERROR\n");
-		for( int i = 0; i < badBlocks.size(); i++ )
+		printf("Unable to listen on %s\n", socketPath.c_str());
+		return 1;
+	}
+	//ids 0 and 1 stand for the listening socket and the wake-up eventfd
+	const uint64_t LISTEN_ID = 0;
+	const uint64_t WAKE_ID = 1;
+	uint64_t nextId = 2;
+	map<uint64_t, ServiceClient> clients;
+	int epollFd = epoll_create1( 0 );
+	service.wakeFd = eventfd( 0, EFD_NONBLOCK );
+	struct epoll_event event;
+	memset( &event, 0, sizeof(event) );
+	event.events = EPOLLIN;
+	event.data.u64 = LISTEN_ID;
+	epoll_ctl( epollFd, EPOLL_CTL_ADD, listenFd, &event );
+	event.data.u64 = WAKE_ID;
+	epoll_ctl( epollFd, EPOLL_CTL_ADD, service.wakeFd, &event );
+	
+	unsigned int threads = thread::hardware_concurrency();
+	if( (NULL != getenv("BCHOC_THREADS")) && (atoi( getenv("BCHOC_THREADS") ) > 0) )
+	{
+		threads = atoi( getenv("BCHOC_THREADS") );
+	}
+	for( unsigned int i = 0; i < max( threads, 1u ); i++ )
+	{
+		thread( serviceWorker, &service ).detach();
+	}
+	if( verifyRate > 0 )
+	{
+		thread( serviceVerifier, &service ).detach();
+	}
+	printf("Serving on %s\n", socketPath.c_str());
+	fflush( stdout );
+	
+	struct epoll_event events[64];
+	while( true )
+	{
+		int ready = epoll_wait( epollFd, events, 64, -1 );
+		for( int e = 0; e < ready; e++ )
 		{
-			//print the hash of the block with the error
-			printf("Bad block: %s\n", badBlocks[i].c_str());
-			//print a description of the identified error
-			switch( failureCondition[i] )
+			uint64_t id = events[e].data.u64;
+			if( LISTEN_ID == id )
 			{
-				case 1:
-						printf("Invalid INITIAL block fields\n");
-					break;
-				case 2:
-						printf("Previous Hash block content does not match parent block hash\n");
-					break;
-				case 3:
-						printf("2 Blocks have same parent Hash\n");
-					break;
-				case 4:
-						printf("Time not strictly increasing block chain events\n");
-					break;
-				case 5:
-						printf("Case ID changed for Evidence Item\n");
-					break;
-				case 6:
-						printf("Creator changed for Evidence Item\n");
-					break;
-				case 7:
-						printf("Evidence Item had invalid State Change\n");
-					break;
-				case 8:
-						printf("Incomplete block detected at end of file\n");
-					break;
+				int clientFd;
+				while( (clientFd = accept4( listenFd, NULL, NULL, SOCK_NONBLOCK )) >= 0 )
+				{
+					ServiceClient &client = clients[nextId];
+					client.fd = clientFd;
+					client.waiting = false;
+					client.closing = false;
+					event.events = EPOLLIN;
+					event.data.u64 = nextId++;
+					epoll_ctl( epollFd, EPOLL_CTL_ADD, clientFd, &event );
+				}
+				continue;
+			}
+			vector<uint64_t> touched;
+			if( WAKE_ID == id )
+			{
+				//hand the workers' replies to their connections
+				uint64_t count;
+				read( service.wakeFd, &count, sizeof(count) );
+				deque<pair<uint64_t, string> > replies;
+				{
+					lock_guard<mutex> guard( service.queueLock );
+					replies.swap( service.replies );
+				}
+				for( size_t i = 0; i < replies.size(); i++ )
+				{
+					map<uint64_t, ServiceClient>::iterator found = clients.find( replies[i].first );
+					if( found != clients.end() )
+					{
+						found->second.output += replies[i].second;
+						found->second.waiting = false;
+						touched.push_back( replies[i].first );
+					}
+				}
+			}
+			else if( clients.count( id ) )
+			{
+				ServiceClient &client = clients[id];
+				if( events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR) )
+				{
+					char buffer[4096];
+					ssize_t got;
+					while( (got = recv( client.fd, buffer, sizeof(buffer), 0 )) > 0 )
+					{
+						client.input.append( buffer, got );
+					}
+					if( (0 == got) || ((got < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno)) )
+					{
+						client.closing = true;
+					}
+				}
+				touched.push_back( id );
+			}
+			for( size_t i = 0; i < touched.size(); i++ )
+			{
+				ServiceClient &client = clients[touched[i]];
+				serviceProcess( service, touched[i], client );
+				serviceFlush( epollFd, touched[i], client );
+				//a client that hung up is dropped once nothing is owed to it
+				if( client.closing && !client.waiting && client.output.empty() )
+				{
+					close( client.fd );
+					clients.erase( touched[i] );
+				}
 			}
-			printf("\n");
 		}
 	}
-	
-	return result;
+	return 0;
 }
 
 /*
@@ -2022,6 +7985,12 @@ int main( int argc, char* argv[] )
 	{
 		printf("Failure using getenv()\n");
 	}
+	//read the durability policy for appends
+	loadSyncPolicy();
+	//read the segment size (0 keeps the chain in a single file)
+	loadSegmentSize();
+	//pick the ID compare for this CPU
+	selectScanKernel();
 	
 	/*
 		Parse the command line arguments. Valid Options are:
@@ -2029,16 +7998,36 @@ int main( int argc, char* argv[] )
 			checkout -i item_id -p password
 			checkin -i item_id -p password
 			show cases 
-			show items -c case_id
-			show history [-c case_id] [-i item_id] [-n num_entries] [-r] -p password
+			show items -c case_id [--after cursor] [--limit N]
+			show history [-c case_id] [-i item_id] [-n num_entries] [-r] [--after cursor] [--limit N] -p password
+			show custody [-o owner] [-c case_id] -p password
+			show state -c case_id [--as-of time] -p password
+			show block N -p password
 			remove -i item_id -y reason -p password(creator’s)
 			init
-			verify
+			verify [--from time|cursor] [--to time|cursor] [--fail-fast] [--stream] | [--segment n] | [--sample K]
+			follow [-c case_id] [-i item_id] [--from cursor] -p password
+			replicate --to path [--continuous]
+			diff chainA chainB
+			serve --socket path [--dir folder] [--chain name=path ...] [--memory bytes] [--verify-rate bytes] [--verify-cpu percent]
+			backup folder
+			snapshot
+			prove -i item_id
+			check-proof proof_file [--root root_hash]
 	*/
 	//Get the first CLI argument and navigate to the correct method
 	if( argc > 1 )
 	{
 		inputCommand = argv[1];
+		//commands that append blocks open the chain up front so a torn
+		//block left by a crash is cut off before anything reads the chain
+		if( ( (0 == inputCommand.compare("add")) || (0 == inputCommand.compare("checkout")) ||
+			(0 == inputCommand.compare("checkin")) || (0 == inputCommand.compare("remove")) ) &&
+			fileExists() && !openChainForAppend() )
+		{
+			//a damaged chain is left as it is for verify to report
+			return 1;
+		}
 		//determine what the first (case sensitive) command word on the CLI is
 		if( 0 == inputCommand.compare("add") )
 		{
@@ -2330,71 +8319,179 @@ int main( int argc, char* argv[] )
 					//the other 2 can have it filled out optionally
 					else if( 0 == cmdRemovalType.compare("DISPOSED") )
 					{
-						mainResult = removeItem( cmdItemId, 1, cmdReason, usedPassword );
+						mainResult = removeItem( cmdItemId, 1, cmdReason, usedPassword );
+					}
+					else if( 0 == cmdRemovalType.compare("DESTROYED") )
+					{
+						mainResult = removeItem( cmdItemId, 2, cmdReason, usedPassword );
+					}
+					else
+					{
+						//printf("Uknown Removal command\n");
+						mainResult = 1;
+					}
+				}
+				if( 0 == cmdItemId.compare("") )
+				{
+					//printf("No Item ID provided\n");
+					mainResult = 1;
+				}
+			}
+			else
+			{
+				//printf("Invalid Password\n");
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("show") )
+		{
+			if( argc > 2 )
+			{
+				inputCommand = argv[2];
+				if( 0 == inputCommand.compare("cases") )
+				{
+					/*
+					 * ==== SHOW CASES OPERATION ====
+					 */
+					showCases();
+				}
+				else if( 0 == inputCommand.compare("items") )
+				{
+					/*
+					 * ==== SHOW ITEMS OPERATION ====
+					 */
+					string cmdCaseId = "";
+					string cmdAfter = ""; //optional
+					int cmdLimit = -1; //optional
+					bool paged = false;
+					bool validArgs = true;
+					for( int arg = 0; arg < argc - 1; arg++ )
+					{
+						if( 0 == strcmp("--after", argv[arg]) )
+						{
+							cmdAfter = argv[arg+1];
+							paged = true;
+						}
+						if( 0 == strcmp("--limit", argv[arg]) )
+						{
+							//a page holds at least one item
+							validArgs = validArgs && parseCount( argv[arg+1], cmdLimit ) && (cmdLimit > 0);
+							paged = true;
+						}
+					}
+					//Find the Cae ID
+					for( int arg = 0; arg < argc; arg++ )
+					{
+						if( 0 == strcmp("-c", argv[arg]) )
+						{
+							cmdCaseId = argv[arg+1];
+							//trim out hifens before comparing
+							cmdCaseId.erase(23, 1);
+							cmdCaseId.erase(18, 1);
+							cmdCaseId.erase(13, 1);
+							cmdCaseId.erase(8, 1);
+							//do not exceed 32char length
+							if( cmdCaseId.size() > 32 )
+							{
+								//printf("Case ID longer than 32 characters. Trimming input.\n");
+								cmdCaseId = cmdCaseId.substr(0, 32);
+							}
+							mainResult = validArgs ? showItems( cmdCaseId, paged, cmdAfter, cmdLimit ) : 1;
+						}
+					}
+					if( 0 == cmdCaseId.compare("") )
+					{
+						//printf("No Case ID provided\n");
+						mainResult = 1;
+					}
+				}
+				else if( 0 == inputCommand.compare("state") )
+				{
+					/*
+					 * ==== SHOW STATE OPERATION ====
+					 */
+					string cmdCaseId = "";
+					string cmdAsOf = "";
+					string cmdPassword = ""; //NOT optional
+					for( int arg = 0; arg < argc - 1; arg++ )
+					{
+						if( 0 == strcmp("-p", argv[arg]) )
+						{
+							cmdPassword = argv[arg+1];
+						}
+						if( 0 == strcmp("-c", argv[arg]) )
+						{
+							cmdCaseId = argv[arg+1];
+							//trim out hifens before comparing
+							cmdCaseId.erase( remove( cmdCaseId.begin(), cmdCaseId.end(), '-' ), cmdCaseId.end() );
+							//do not exceed 32char length
+							if( cmdCaseId.size() > 32 )
+							{
+								cmdCaseId = cmdCaseId.substr(0, 32);
+							}
+						}
+						if( 0 == strcmp("--as-of", argv[arg]) )
+						{
+							cmdAsOf = argv[arg+1];
+						}
+					}
+					//without --as-of, report the current state
+					uint64_t asOf = UINT64_MAX;
+					if( (0 == cmdCaseId.compare("")) ||
+						((0 != cmdAsOf.compare("")) && !parseTimestamp( cmdAsOf, asOf )) )
+					{
+						//printf("No Case ID or invalid time provided\n");
+						mainResult = 1;
 					}
-					else if( 0 == cmdRemovalType.compare("DESTROYED") )
+					//Confirm Password is POLICE, LAWYER, ANALYST, or EXECUTIVE
+					else if( 0 >= checkPassword( cmdPassword ) )
 					{
-						mainResult = removeItem( cmdItemId, 2, cmdReason, usedPassword );
+						//printf("Invalid Password\n");
+						mainResult = 1;
 					}
 					else
 					{
-						//printf("Uknown Removal command\n");
-						mainResult = 1;
+						mainResult = showStateAsOf( cmdCaseId, asOf );
 					}
 				}
-				if( 0 == cmdItemId.compare("") )
-				{
-					//printf("No Item ID provided\n");
-					mainResult = 1;
-				}
-			}
-			else
-			{
-				//printf("Invalid Password\n");
-				mainResult = 1;
-			}
-		}
-		else if( 0 == inputCommand.compare("show") )
-		{
-			if( argc > 2 )
-			{
-				inputCommand = argv[2];
-				if( 0 == inputCommand.compare("cases") )
-				{
-					/*
-					 * ==== SHOW CASES OPERATION ====
-					 */
-					showCases();
-				}
-				else if( 0 == inputCommand.compare("items") )
+				else if( 0 == inputCommand.compare("custody") )
 				{
 					/*
-					 * ==== SHOW ITEMS OPERATION ====
+					 * ==== SHOW CUSTODY OPERATION ====
 					 */
-					string cmdCaseId = "";
-					//Find the Cae ID
-					for( int arg = 0; arg < argc; arg++ )
+					string cmdOwner = ""; //optional
+					string cmdCaseId = ""; //optional
+					string cmdPassword = ""; //NOT optional
+					for( int arg = 0; arg < argc - 1; arg++ )
 					{
+						if( 0 == strcmp("-o", argv[arg]) )
+						{
+							cmdOwner = argv[arg+1];
+						}
+						if( 0 == strcmp("-p", argv[arg]) )
+						{
+							cmdPassword = argv[arg+1];
+						}
 						if( 0 == strcmp("-c", argv[arg]) )
 						{
 							cmdCaseId = argv[arg+1];
 							//trim out hifens before comparing
-							cmdCaseId.erase(23, 1);
-							cmdCaseId.erase(18, 1);
-							cmdCaseId.erase(13, 1);
-							cmdCaseId.erase(8, 1);
+							cmdCaseId.erase( remove( cmdCaseId.begin(), cmdCaseId.end(), '-' ), cmdCaseId.end() );
 							//do not exceed 32char length
 							if( cmdCaseId.size() > 32 )
 							{
-								//printf("Case ID longer than 32 characters. Trimming input.\n");
 								cmdCaseId = cmdCaseId.substr(0, 32);
 							}
-							showItems( cmdCaseId );
 						}
 					}
-					if( 0 == cmdCaseId.compare("") )
+					//Confirm Password is POLICE, LAWYER, ANALYST, or EXECUTIVE
+					if( 0 < checkPassword( cmdPassword ) )
 					{
-						//printf("No Case ID provided\n");
+						showCustody( cmdOwner, cmdCaseId );
+					}
+					else
+					{
+						//printf("Invalid Password\n");
 						mainResult = 1;
 					}
 				}
@@ -2409,6 +8506,8 @@ int main( int argc, char* argv[] )
 					string cmdPassword = ""; //NOT optional
 					int numEntry = -1; //optional
 					bool reverse = false; //optional
+					string cmdAfter = ""; //optional
+					bool paged = false;
 					
 					//Find the Case
 					for( int arg = 0; arg < argc; arg++ )
@@ -2452,11 +8551,14 @@ int main( int argc, char* argv[] )
 						}
 					}
 					//Find the Number of Entries to print
-					for( int arg = 0; arg < argc; arg++ )
+					bool validArgs = true;
+					bool hasCount = false;
+					for( int arg = 0; arg < argc - 1; arg++ )
 					{
 						if( 0 == strcmp("-n", argv[arg]) )
 						{
-							numEntry = stoi(argv[arg+1]);
+							validArgs = validArgs && parseCount( argv[arg+1], numEntry );
+							hasCount = true;
 						}
 					}
 					//Find the Reverse Flag
@@ -2467,13 +8569,33 @@ int main( int argc, char* argv[] )
 							reverse = true;
 						}
 					}
+					//Find the page to print (--limit is the page size)
+					for( int arg = 0; arg < argc - 1; arg++ )
+					{
+						if( 0 == strcmp("--after", argv[arg]) )
+						{
+							cmdAfter = argv[arg+1];
+							paged = true;
+						}
+						if( 0 == strcmp("--limit", argv[arg]) )
+						{
+							//the page size, which -n cannot also set; a page holds at least one entry
+							validArgs = validArgs && !hasCount && parseCount( argv[arg+1], numEntry ) && (numEntry > 0);
+							paged = true;
+						}
+					}
 					
 					
 					//Confirm Password is POLICE, LAWYER, ANALYST, or EXECUTIVE
 					int passwordId = checkPassword( cmdPassword );
-					if( 0 < passwordId )
+					if( !validArgs )
+					{
+						//printf("Invalid -n or --limit\n");
+						mainResult = 1;
+					}
+					else if( 0 < passwordId )
 					{
-						showHistory( cmdCaseId, cmdItemId, numEntry, reverse );
+						mainResult = showHistory( cmdCaseId, cmdItemId, numEntry, reverse, paged, cmdAfter );
 					}
 					else
 					{
@@ -2481,6 +8603,34 @@ int main( int argc, char* argv[] )
 						mainResult = 1;
 					}
 				}
+				else if( 0 == inputCommand.compare("block") )
+				{
+					/*
+					 * ==== SHOW BLOCK OPERATION ====
+					 */
+					string cmdPassword = ""; //NOT optional
+					for( int arg = 0; arg < argc - 1; arg++ )
+					{
+						if( 0 == strcmp("-p", argv[arg]) )
+						{
+							cmdPassword = argv[arg+1];
+						}
+					}
+					//the block number must be a plain decimal number
+					string cmdBlock = (argc > 3) ? argv[3] : "";
+					bool validBlock = (0 != cmdBlock.size()) && (cmdBlock.size() <= 19) &&
+										(string::npos == cmdBlock.find_first_not_of("0123456789"));
+					//Confirm Password is POLICE, LAWYER, ANALYST, or EXECUTIVE
+					if( validBlock && (0 < checkPassword( cmdPassword )) )
+					{
+						mainResult = showBlock( strtoull( cmdBlock.c_str(), NULL, 10 ) );
+					}
+					else
+					{
+						//printf("Invalid block number or password\n");
+						mainResult = 1;
+					}
+				}
 			}
 		}
 		else if( 0 == inputCommand.compare("init") )
@@ -2503,9 +8653,45 @@ int main( int argc, char* argv[] )
 			/*
 			 * ==== VERIFY OPERATION ====
 			 */
-			if( 2 == argc )
+			bool cmdFailFast = false; //optional
+			bool cmdStream = false; //optional
+			string cmdFrom = ""; //optional
+			string cmdTo = ""; //optional
+			bool cmdValid = true;
+			for( int arg = 2; arg < argc; arg++ )
+			{
+				if( (0 == strcmp("--from", argv[arg])) && (arg + 1 < argc) )
+				{
+					cmdFrom = argv[++arg];
+				}
+				else if( (0 == strcmp("--to", argv[arg])) && (arg + 1 < argc) )
+				{
+					cmdTo = argv[++arg];
+				}
+				else if( 0 == strcmp("--fail-fast", argv[arg]) )
+				{
+					cmdFailFast = true;
+				}
+				else if( 0 == strcmp("--stream", argv[arg]) )
+				{
+					cmdStream = true;
+				}
+				else
+				{
+					cmdValid = false;
+				}
+			}
+			if( cmdValid )
+			{
+				mainResult = verify( cmdFailFast, cmdStream, cmdFrom, cmdTo );
+			}
+			else if( (4 == argc) && (0 == strcmp("--segment", argv[2])) )
+			{
+				mainResult = verifySegment( atoi(argv[3]) );
+			}
+			else if( (4 == argc) && (0 == strcmp("--sample", argv[2])) )
 			{
-				mainResult = verify();
+				mainResult = verifySample( strtoull( argv[3], NULL, 10 ) );
 			}
 			else
 			{
@@ -2513,6 +8699,236 @@ int main( int argc, char* argv[] )
 				mainResult = 1;
 			}
 		}
+		else if( 0 == inputCommand.compare("snapshot") )
+		{
+			/*
+			 * ==== SNAPSHOT OPERATION ====
+			 */
+			if( 2 == argc )
+			{
+				mainResult = snapshotChain();
+			}
+			else
+			{
+				//snapshot should reject any additional arguments
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("prove") )
+		{
+			/*
+			 * ==== PROVE OPERATION ====
+			 */
+			string cmdItemId = "";
+			for( int arg = 0; arg < argc - 1; arg++ )
+			{
+				if( 0 == strcmp("-i", argv[arg]) )
+				{
+					cmdItemId = argv[arg+1];
+					//do not exceed 32char length
+					if( cmdItemId.size() > 32 )
+					{
+						cmdItemId = cmdItemId.substr(0, 32);
+					}
+				}
+			}
+			if( 0 != cmdItemId.compare("") )
+			{
+				mainResult = proveItem( cmdItemId );
+			}
+			else
+			{
+				//printf("No Item ID provided\n");
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("check-proof") )
+		{
+			/*
+			 * ==== CHECK PROOF OPERATION ====
+			 */
+			string cmdProofFile = "";
+			string cmdRoot = "";
+			for( int arg = 2; arg < argc; arg++ )
+			{
+				if( (0 == strcmp("--root", argv[arg])) && (arg + 1 < argc) )
+				{
+					cmdRoot = argv[arg+1];
+					arg++;
+				}
+				else
+				{
+					cmdProofFile = argv[arg];
+				}
+			}
+			if( 0 != cmdProofFile.compare("") )
+			{
+				mainResult = checkProof( cmdProofFile, cmdRoot );
+			}
+			else
+			{
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("follow") )
+		{
+			/*
+			 * ==== FOLLOW OPERATION ====
+			 */
+			string cmdCaseId = ""; //optional
+			string cmdItemId = ""; //optional
+			string cmdCursor = ""; //optional
+			string cmdPassword = ""; //NOT optional
+			for( int arg = 2; arg < argc - 1; arg++ )
+			{
+				if( 0 == strcmp("-p", argv[arg]) )
+				{
+					cmdPassword = argv[arg+1];
+				}
+				if( 0 == strcmp("-c", argv[arg]) )
+				{
+					cmdCaseId = argv[arg+1];
+					//trim out hifens before comparing
+					cmdCaseId.erase( remove( cmdCaseId.begin(), cmdCaseId.end(), '-' ), cmdCaseId.end() );
+					//do not exceed 32char length
+					if( cmdCaseId.size() > 32 )
+					{
+						cmdCaseId = cmdCaseId.substr(0, 32);
+					}
+				}
+				if( 0 == strcmp("-i", argv[arg]) )
+				{
+					cmdItemId = argv[arg+1];
+					//do not exceed 32char length
+					if( cmdItemId.size() > 32 )
+					{
+						cmdItemId = cmdItemId.substr(0, 32);
+					}
+				}
+				if( 0 == strcmp("--from", argv[arg]) )
+				{
+					cmdCursor = argv[arg+1];
+				}
+			}
+			//Confirm Password is POLICE, LAWYER, ANALYST, or EXECUTIVE
+			if( 0 < checkPassword( cmdPassword ) )
+			{
+				mainResult = followChain( cmdCaseId, cmdItemId, cmdCursor );
+			}
+			else
+			{
+				//printf("Invalid Password\n");
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("serve") )
+		{
+			/*
+			 * ==== SERVE OPERATION ====
+			 */
+			string cmdSocket = "";
+			string cmdFolder = ""; //optional
+			map<string, string> cmdChains; //optional
+			size_t cmdBudget = 256 << 20; //optional
+			uint64_t cmdVerifyRate = 0; //optional
+			int cmdVerifyCpu = 10; //optional
+			for( int arg = 2; arg < argc - 1; arg++ )
+			{
+				if( 0 == strcmp("--socket", argv[arg]) )
+				{
+					cmdSocket = argv[arg+1];
+				}
+				else if( 0 == strcmp("--dir", argv[arg]) )
+				{
+					cmdFolder = argv[arg+1];
+				}
+				else if( 0 == strcmp("--memory", argv[arg]) )
+				{
+					cmdBudget = parseByteSize( argv[arg+1] );
+				}
+				else if( 0 == strcmp("--verify-rate", argv[arg]) )
+				{
+					cmdVerifyRate = parseByteSize( argv[arg+1] );
+				}
+				else if( 0 == strcmp("--verify-cpu", argv[arg]) )
+				{
+					cmdVerifyCpu = atoi( argv[arg+1] );
+				}
+				else if( (0 == strcmp("--chain", argv[arg])) && (NULL != strchr( argv[arg+1], '=' )) )
+				{
+					string named = argv[arg+1];
+					cmdChains[named.substr( 0, named.find('=') )] = named.substr( named.find('=') + 1 );
+				}
+			}
+			if( (0 != cmdSocket.compare("")) && ((0 != cmdFolder.compare("")) || !cmdChains.empty()) )
+			{
+				mainResult = serveChains( cmdSocket, cmdChains, cmdFolder, cmdBudget, cmdVerifyRate, cmdVerifyCpu );
+			}
+			else
+			{
+				//serve needs a socket and at least one chain
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("diff") )
+		{
+			/*
+			 * ==== DIFF OPERATION ====
+			 */
+			if( argc >= 4 )
+			{
+				mainResult = diffChains( argv[2], argv[3] );
+			}
+			else
+			{
+				//diff needs two chains to compare
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("replicate") )
+		{
+			/*
+			 * ==== REPLICATE OPERATION ====
+			 */
+			string cmdTarget = "";
+			bool continuous = false;
+			for( int arg = 2; arg < argc; arg++ )
+			{
+				if( (0 == strcmp("--to", argv[arg])) && (arg + 1 < argc) )
+				{
+					cmdTarget = argv[arg+1];
+					arg++;
+				}
+				else if( 0 == strcmp("--continuous", argv[arg]) )
+				{
+					continuous = true;
+				}
+			}
+			if( 0 != cmdTarget.compare("") )
+			{
+				mainResult = replicateChain( cmdTarget, continuous );
+			}
+			else
+			{
+				//replicate needs a follower to write to
+				mainResult = 1;
+			}
+		}
+		else if( 0 == inputCommand.compare("backup") )
+		{
+			/*
+			 * ==== BACKUP OPERATION ====
+			 */
+			if( 3 == argc )
+			{
+				mainResult = backupChain( argv[2] );
+			}
+			else
+			{
+				//backup needs exactly one destination folder
+				mainResult = 1;
+			}
+		}
 		else
 		{
 			//User passed in unspoort/unknown inputs. Alert them
@@ -2522,14 +8938,30 @@ int main( int argc, char* argv[] )
 			printf("\tcheckout -i item_id -p password\n" );
 			printf("\tcheckin -i item_id -p password\n" );
 			printf("\tshow cases \n" );
-			printf("\tshow items -c case_id\n" );
-			printf("\tshow history [-c case_id] [-i item_id] [-n num_entries] [-r] -p password\n" );
+			printf("\tshow items -c case_id [--after cursor] [--limit N]\n" );
+			printf("\tshow history [-c case_id] [-i item_id] [-n num_entries] [-r] [--after cursor] [--limit N] -p password\n" );
+			printf("\tshow custody [-o owner] [-c case_id] -p password\n" );
+			printf("\tshow state -c case_id [--as-of time] -p password\n" );
+			printf("\tshow block N -p password\n" );
 			printf("\tremove -i item_id -y reason -p password(creator’s)\n" );
 			printf("\tinit\n" );
-			printf("\tverify\n" );
+			printf("\tverify [--from time|cursor] [--to time|cursor] [--fail-fast] [--stream] | [--segment n] | [--sample K]\n" );
+			printf("\tfollow [-c case_id] [-i item_id] [--from cursor] -p password\n" );
+			printf("\treplicate --to path [--continuous]\n" );
+			printf("\tdiff chainA chainB\n" );
+			printf("\tserve --socket path [--dir folder] [--chain name=path ...] [--memory bytes] [--verify-rate bytes] [--verify-cpu percent]\n" );
+			printf("\tbackup folder\n" );
+			printf("\tsnapshot\n" );
+			printf("\tprove -i item_id\n" );
+			printf("\tcheck-proof proof_file [--root root_hash]\n" );
 		}
 	}
 	
+	//make sure any queued blocks reach the disk before exiting
+	if( !closeChain() )
+	{
+		mainResult = 1;
+	}
 	//exit accordingly
 	return mainResult;
 }
\ No newline at end of file